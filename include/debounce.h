@@ -0,0 +1,65 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+#include <stdint.h>
+#include "enums.h"
+
+#define DEBOUNCE_COUNTER_BITS 4
+#define DEBOUNCE_MAX_MILLIS   ((1 << DEBOUNCE_COUNTER_BITS) - 1)
+
+/**
+ * @brief Debounces all 30 GPIO pins at once using bit-sliced (vertical) counters.
+ *
+ * Bit N of each counter/window word belongs to GPIO N, so every pin is counted with a handful of
+ * word operations per millisecond regardless of how many pins are in use.
+ */
+class GamepadDebouncer
+{
+public:
+	void setup(DebounceMode mode, uint32_t values, uint32_t millis);
+	void setWindow(uint8_t pin, uint8_t millis);
+	uint32_t update(uint32_t values, uint32_t millis);
+
+	DebounceMode mode = DEBOUNCE_MODE_EAGER;
+	uint32_t state = 0;
+
+protected:
+	inline void increment(uint32_t mask)
+	{
+		uint32_t carry = mask;
+		for (int i = 0; i < DEBOUNCE_COUNTER_BITS; i++)
+		{
+			uint32_t next = counter[i] & carry;
+			counter[i] ^= carry;
+			carry = next;
+		}
+	}
+
+	inline void clear(uint32_t mask)
+	{
+		for (int i = 0; i < DEBOUNCE_COUNTER_BITS; i++)
+			counter[i] &= ~mask;
+	}
+
+	inline uint32_t expired()
+	{
+		uint32_t equal = ~0U;
+		for (int i = 0; i < DEBOUNCE_COUNTER_BITS; i++)
+			equal &= ~(counter[i] ^ window[i]);
+
+		return equal;
+	}
+
+	uint32_t counter[DEBOUNCE_COUNTER_BITS] = { };
+	uint32_t window[DEBOUNCE_COUNTER_BITS] = { };
+	uint32_t immediate = ~0U; // Pins with a zero window pass straight through
+	uint32_t active = 0;      // Deferred: pins waiting to settle, eager: pins locked out
+	uint32_t lastMillis = 0;
+};
+
+#endif
@@ -62,6 +62,8 @@ public:
 	void setup();
 	void loop();
 	void process(Gamepad *gamepad);
+	void suspend();
+	void resume();
 };
 
 #endif
@@ -0,0 +1,48 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef EDGECAPTURE_H_
+#define EDGECAPTURE_H_
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "RingBuffer.h"
+
+#define EDGE_CAPTURE_BUFFER_SIZE 64
+
+struct InputEdge
+{
+	uint64_t timestamp; // time_us_64() when the IRQ fired
+	uint32_t values;    // Inverted GPIO word sampled in the IRQ
+	uint8_t pin;
+	uint8_t events;     // GPIO_IRQ_EDGE_FALL (press) and/or GPIO_IRQ_EDGE_RISE (release)
+};
+
+/**
+ * @brief Timestamps button edges with GPIO interrupts.
+ *
+ * The IRQ handler only pushes the edge into a lock-free ring; drain() is called from Gamepad::read()
+ * on core0 to empty it and find when the first of the queued edges happened.
+ */
+class EdgeCapture
+{
+public:
+	void start(uint32_t pinMask);
+	void stop();
+	uint32_t drain();
+
+	inline bool pending() { return !edges.isEmpty(); }
+
+	uint64_t edgeTime = 0;         // Time of the first edge found by the last drain()
+	volatile uint32_t dropped = 0; // Edges lost because the ring was full
+	RingBuffer<InputEdge, EDGE_CAPTURE_BUFFER_SIZE> edges;
+
+private:
+	uint32_t pinMask = 0;
+};
+
+extern EdgeCapture edgeCapture;
+
+#endif
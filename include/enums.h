@@ -13,4 +13,17 @@ typedef enum
 	BUTTON_LAYOUT_WASD,
 } ButtonLayout;
 
+typedef enum
+{
+	DEBOUNCE_MODE_DEFERRED, // Report a change once the pin has held its new level for the whole window
+	DEBOUNCE_MODE_EAGER,    // Report the first edge immediately, then ignore the pin for the window
+} DebounceMode;
+
+typedef enum
+{
+	INPUT_SOURCE_GPIO,     // Poll gpio_get_all() on every read
+	INPUT_SOURCE_GPIO_IRQ, // Poll on every read, plus edge IRQs for timestamps and immediate reports
+	INPUT_SOURCE_PIO,      // Read the newest sample from a PIO state machine sampling in the background
+} InputSource;
+
 #endif
@@ -6,12 +6,46 @@
 #include <MPGS.h>
 #include "pico/stdlib.h"
 #include "storage.h"
+#include "debounce.h"
+#include "edgecapture.h"
+#include "inputsampler.h"
+#include "inputtrace.h"
+#include "latency.h"
+#include "seqlock.h"
+#include "usb_driver.h"
 
 #define GAMEPAD_FEATURE_REPORT_SIZE 32
 
+#ifndef GAMEPAD_DEBOUNCE_MILLIS
+#define GAMEPAD_DEBOUNCE_MILLIS 5
+#endif
+
+#ifndef GAMEPAD_DEBOUNCE_MODE
+#define GAMEPAD_DEBOUNCE_MODE DEBOUNCE_MODE_EAGER
+#endif
+
+#ifndef GAMEPAD_INPUT_SOURCE
+#define GAMEPAD_INPUT_SOURCE INPUT_SOURCE_GPIO
+#endif
+
+// Players on one board, each gets its own interface in a composite HID device
+#ifndef GAMEPAD_PLAYERS
+#define GAMEPAD_PLAYERS 1
+#endif
+
+#define GAMEPAD_PLAYERS_MAX 2
+
+static_assert(GAMEPAD_PLAYERS >= 1 && GAMEPAD_PLAYERS <= GAMEPAD_PLAYERS_MAX, "GAMEPAD_PLAYERS must be 1 or 2");
+
+// The 30 GPIO pins are gathered through one 256-entry lookup table per byte of gpio_get_all()
+#define GAMEPAD_PIN_LOOKUP_SLICES 4
+#define GAMEPAD_PIN_LOOKUP_SIZE   256
+#define GAMEPAD_LOOKUP_DPAD_SHIFT 16
+#define GAMEPAD_LOOKUP_AUX_SHIFT  24
+
 struct GamepadButtonMapping
 {
-	GamepadButtonMapping(uint8_t p, uint16_t bm) : pin(p), pinMask((1 << p)), buttonMask(bm) {}
+	GamepadButtonMapping(uint8_t p, uint16_t bm) : pin(p), pinMask(maskOf(p)), buttonMask(bm) {}
 
 	uint8_t pin;
 	uint32_t pinMask;
@@ -20,23 +54,80 @@ struct GamepadButtonMapping
 	inline void setPin(uint8_t p)
 	{
 		pin = p;
-		pinMask = 1 << p;
+		pinMask = maskOf(p);
+	}
+
+	// Unmapped pins are out of range and have no mask
+	static inline uint32_t maskOf(uint8_t p)
+	{
+		return (p < NUM_BANK0_GPIOS) ? (1U << p) : 0;
 	}
 };
 
+// The processed gamepad state handed to core1, see GamepadChannel
+struct InputFrame
+{
+	uint32_t optionsGeneration; // Bumped whenever the gamepad options change
+	uint16_t buttons;
+	uint16_t aux;
+	uint16_t lx;
+	uint16_t ly;
+	uint16_t rx;
+	uint16_t ry;
+	uint8_t dpad;
+	uint8_t lt;
+	uint8_t rt;
+};
+
+/**
+ * @brief One player's pin map, options and state.
+ *
+ * The first player owns the input path: it samples the pins, traces and debounces them for every player.
+ * The players after it are built with the first as their primary, and only map its last debounced read
+ * through their own lookup tables, so another player adds four loads and its own process() to a cycle.
+ */
 class Gamepad : public MPGS
 {
 public:
-	Gamepad(int debounceMS = 5, GamepadStorage *storage = &GamepadStore)
-			: MPGS(debounceMS, storage) {}
+	Gamepad(int debounceMS = 5, GamepadStorage *storage = &GamepadStore, uint8_t player = 0, Gamepad *primary = nullptr)
+			: MPGS(debounceMS, storage), player(player), primary(primary ? primary : this) {}
 
 	void setup();
 	void read();
+	void map();
+	void mapPins();
+	void load();
+	void save();
+	void setInputSource(InputSource source);
+	GamepadHotkey hotkey();
+	void applyDebounceOptions(const DebounceOptions &options);
+	void getFrame(InputFrame &frame);
+	void setFrame(const InputFrame &frame);
+
+	// True when an edge IRQ has fired since the last read()
+	inline bool hasPendingInput()
+	{
+		return inputSource == INPUT_SOURCE_GPIO_IRQ && edgeCapture.pending();
+	}
 
 	void process()
 	{
 		memcpy(&rawState, &state, sizeof(GamepadState));
-		MPGS::process();
+
+		// A keyboard has no sticks, so keyboard mode sends the D-pad as its keys whatever the D-pad mode
+		if (options.inputMode == INPUT_MODE_KEYBOARD && options.dpadMode != DPAD_MODE_DIGITAL)
+		{
+			DpadMode dpadMode = options.dpadMode;
+			options.dpadMode = DPAD_MODE_DIGITAL;
+			MPGS::process();
+			options.dpadMode = dpadMode;
+		}
+		else
+		{
+			MPGS::process();
+		}
+
+		latencyTracer.mark(LATENCY_STAGE_PROCESS, time_us_64());
 	}
 
 	inline bool __attribute__((always_inline)) pressedF1()
@@ -70,6 +161,49 @@ public:
 	GamepadButtonMapping *mapButtonA2;
 
 	GamepadButtonMapping **gamepadMappings;
+
+	GamepadDebouncer debouncer;
+	DebounceOptions debounceOptions;
+	InputSource inputSource = INPUT_SOURCE_GPIO;
+	InputSourceOptions inputSourceOptions; // The source picked, inputSource falls back to polling without a free PIO
+	uint32_t pinMask = 0;   // All GPIO pins used by the mappings
+	uint32_t inputMask = 0; // All GPIO pins read by the primary, for every player
+	const uint8_t player;
+	Gamepad * const primary;
+
+protected:
+	void setPlayerPins(uint8_t index, uint32_t mask);
+
+	uint32_t playerPinMasks[GAMEPAD_PLAYERS_MAX] = { };
+	uint32_t rawValues = 0;       // GPIO word from the last read(), before debouncing
+	uint32_t debouncedValues = 0; // GPIO word from the last read(), after debouncing
+	uint32_t (*pinLookup)[GAMEPAD_PIN_LOOKUP_SIZE] = nullptr;
+};
+
+/**
+ * @brief Hands the latest gamepad state from core0 to core1 without locks or queues.
+ *
+ * core0 publishes a compact InputFrame after every process(), and core1 applies the newest frame to
+ * its own Gamepad instance. The options only cross over when their generation changes.
+ */
+class GamepadChannel
+{
+public:
+	void publish(Gamepad &gamepad); // core0 only
+	bool receive(Gamepad &gamepad); // core1 only, returns true when a new frame was applied
+
+protected:
+	SeqLock<InputFrame> frames;
+	SeqLock<GamepadOptions> options;
+
+	// Writer side
+	GamepadOptions publishedOptions = { };
+	uint32_t generation = 0;
+
+	// Reader side
+	uint32_t frameSequence = 0;
+	uint32_t optionsSequence = 0;
+	uint32_t appliedGeneration = 0;
 };
 
 #endif
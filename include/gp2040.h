@@ -38,6 +38,8 @@ public:
 	virtual void setup() = 0;
 	virtual void loop() = 0;
 	virtual void process(Gamepad *gamepad) = 0;
+	virtual void suspend() { } // Blank the outputs while the USB bus is suspended, core1 parks after
+	virtual void resume() { }
 	absolute_time_t nextRunTime;
 	const uint32_t intervalMS = 10;
 	inline bool isEnabled() { return enabled; }
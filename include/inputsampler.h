@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef INPUTSAMPLER_H_
+#define INPUTSAMPLER_H_
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+#ifndef INPUT_SAMPLER_RATE_HZ
+#define INPUT_SAMPLER_RATE_HZ 100000
+#endif
+
+#define INPUT_SAMPLER_RING_BITS 8 // 256 samples, 2.56ms at 100kHz
+#define INPUT_SAMPLER_RING_SIZE (1 << INPUT_SAMPLER_RING_BITS)
+#define INPUT_SAMPLER_RING_MASK (INPUT_SAMPLER_RING_SIZE - 1)
+
+/**
+ * @brief Samples the GPIO bank in the background with a PIO state machine.
+ *
+ * The state machine pushes one GPIO word per sample period and DMA writes them into a RAM ring,
+ * with a second DMA channel re-arming the first so it never stops. read() only has to look at the
+ * samples written since the previous call to pick up the newest word and the time of the first edge.
+ */
+class InputSampler
+{
+public:
+	bool start(uint32_t pinMask, uint32_t rateHz = INPUT_SAMPLER_RATE_HZ);
+	void stop();
+	void retime(); // clk_sys changed speed, keeps the sample rate
+	uint32_t read(uint64_t now);
+
+	inline bool isRunning() { return running; }
+	inline void setPinMask(uint32_t pinMask) { this->pinMask = pinMask; }
+
+	uint32_t edgeMask = 0; // Pins that changed in the samples scanned by the last read()
+	uint64_t edgeTime = 0; // Time of the first edge found by the last read()
+	uint32_t overruns = 0; // Reads that came too late to scan every sample
+
+protected:
+	PIO pio = pio1;
+	int sm = -1;
+	uint offset = 0;
+	int dataChannel = -1;
+	int reloadChannel = -1;
+	bool running = false;
+
+	uint32_t pinMask = 0;
+	uint32_t rateHz = 0;
+	uint32_t periodNs = 0;
+	uint32_t ringUs = 0;
+	uint32_t readIndex = 0;
+	uint32_t previous = 0;
+	uint64_t lastRead = 0;
+};
+
+extern InputSampler inputSampler;
+
+#endif
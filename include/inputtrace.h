@@ -0,0 +1,98 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef INPUTTRACE_H_
+#define INPUTTRACE_H_
+
+#include <stdint.h>
+
+#ifndef INPUT_TRACE_RECORDS
+#define INPUT_TRACE_RECORDS 1024 // 8KB of RAM
+#endif
+
+#define INPUT_TRACE_MAGIC   0x54495047 // "GPIT"
+#define INPUT_TRACE_VERSION 1
+#define INPUT_TRACE_PINS    18         // One per gamepad mapping, in gamepadMappings order
+#define INPUT_TRACE_NO_PIN  0xFF
+
+class Gamepad;
+
+struct InputTraceRecord
+{
+	uint32_t timeUs; // Low 32 bits of time_us_64() at the read that saw the change
+	uint32_t values; // Raw GPIO word masked to the mapped pins, 1 = pressed
+};
+
+// The settings the trace was recorded with, everything needed to replay the raw words
+struct InputTraceConfig
+{
+	uint8_t pins[INPUT_TRACE_PINS];
+	uint8_t debounceWindows[INPUT_TRACE_PINS];
+	uint8_t debounceMode;
+	uint8_t dpadMode;
+	uint8_t socdMode;
+	uint8_t invertXAxis;
+	uint8_t invertYAxis;
+	uint8_t inputSource;
+	uint8_t settingsPin;
+	uint8_t reserved;
+};
+
+/**
+ * Also the binary dump format: little endian, no padding.
+ */
+struct InputTraceDump
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t capacity; // Number of records in the ring
+	uint32_t written;  // Records written since the trace started, the ring holds the newest of them
+	uint32_t head;     // Index the next record goes to, the oldest record when the ring has wrapped
+	InputTraceConfig config;
+	InputTraceRecord records[INPUT_TRACE_RECORDS];
+};
+
+/**
+ * @brief Records every change of the raw button pins into a RAM ring for replay on the host.
+ *
+ * read() hands over the masked GPIO word whenever it differs from the previous read, so recording
+ * costs two stores per button change. Like the latency stats, the ring is kept in uninitialized RAM
+ * so it survives the soft reboot into the web configurator, where it can be downloaded.
+ */
+class InputTrace
+{
+public:
+	void setup(Gamepad &gamepad);
+	void reset();
+
+	inline void start() { recording = true; }
+	inline void stop() { recording = false; }
+
+	inline void record(uint64_t now, uint32_t values)
+	{
+		if (!recording)
+			return;
+
+		InputTraceRecord &record = dump->records[dump->head];
+		record.timeUs = now;
+		record.values = values;
+		if (++dump->head == INPUT_TRACE_RECORDS)
+			dump->head = 0;
+		dump->written++;
+	}
+
+	static void captureConfig(Gamepad &gamepad, InputTraceConfig &config);
+	static void applyConfig(Gamepad &gamepad, const InputTraceConfig &config);
+
+	InputTraceDump *dump;
+
+protected:
+	Gamepad *gamepad = nullptr;
+	bool recording = false;
+};
+
+extern InputTrace inputTrace;
+
+#endif
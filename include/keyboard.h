@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef KEYBOARD_H_
+#define KEYBOARD_H_
+
+#include <stdint.h>
+#include "gamepad.h"
+#include "storage.h"
+#include "keyboard_descriptors.h"
+
+// The D-pad and button bits are joined into one word, then looked up a nibble at a time
+#define KEYBOARD_INPUT_BUTTON_SHIFT 4
+#define KEYBOARD_INPUT_COUNT        (KEYBOARD_INPUT_BUTTON_SHIFT + 14)
+#define KEYBOARD_LOOKUP_BITS        4
+#define KEYBOARD_LOOKUP_SLICES      ((KEYBOARD_INPUT_COUNT + KEYBOARD_LOOKUP_BITS - 1) / KEYBOARD_LOOKUP_BITS)
+#define KEYBOARD_LOOKUP_SIZE        (1 << KEYBOARD_LOOKUP_BITS)
+#define KEYBOARD_REPORT_WORDS       (sizeof(KeyboardReport) / sizeof(uint32_t))
+
+/**
+ * @brief Builds the keyboard mode's NKRO report from the processed gamepad state.
+ *
+ * The key mapping is folded into lookup tables once at setup: each nibble of the input word indexes
+ * the report its buttons press, so a report is five lookups ORed together a word at a time, with no
+ * per-button branches. That costs about what the gamepad modes' report builders do, for 1.25KB of RAM.
+ */
+class KeyboardMapper
+{
+public:
+	void setup(const KeyboardMapping &mapping);
+
+	inline KeyboardReport *build(Gamepad &gamepad)
+	{
+		uint32_t inputs = (gamepad.state.buttons << KEYBOARD_INPUT_BUTTON_SHIFT) | (gamepad.state.dpad & 0x0F);
+
+		for (uint8_t i = 0; i < KEYBOARD_REPORT_WORDS; i++)
+			report.words[i] = 0;
+
+		for (uint8_t slice = 0; slice < KEYBOARD_LOOKUP_SLICES; slice++)
+		{
+			const uint32_t *keys = lookup[slice][(inputs >> (slice * KEYBOARD_LOOKUP_BITS)) & (KEYBOARD_LOOKUP_SIZE - 1)];
+			for (uint8_t i = 0; i < KEYBOARD_REPORT_WORDS; i++)
+				report.words[i] |= keys[i];
+		}
+
+		return &report.keyboard;
+	}
+
+protected:
+	uint32_t lookup[KEYBOARD_LOOKUP_SLICES][KEYBOARD_LOOKUP_SIZE][KEYBOARD_REPORT_WORDS];
+
+	union
+	{
+		KeyboardReport keyboard;
+		uint32_t words[KEYBOARD_REPORT_WORDS];
+	} report;
+};
+
+extern KeyboardMapper keyboardMapper;
+
+#endif
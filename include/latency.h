@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+#define LATENCY_STATS_MAGIC      0x544C5047 // "GPLT"
+#define LATENCY_STATS_VERSION    1
+#define LATENCY_BUCKET_SUB_BITS  3          // 8 buckets per power of two, ~12% resolution
+#define LATENCY_BUCKET_COUNT     128        // Covers 0 to ~262ms
+#define LATENCY_TRACE_TIMEOUT_US 100000     // Give up on an event that never reaches the host
+
+// Left in watchdog scratch[0] to boot straight into the web configurator with the stats intact
+#define LATENCY_CONFIG_REBOOT_MAGIC 0x43464730 // "0GFC"
+
+typedef enum
+{
+	LATENCY_STAGE_READ,     // read() sampled the changed pin
+	LATENCY_STAGE_DEBOUNCE, // The change made it through the debouncer
+	LATENCY_STAGE_PROCESS,  // process() finished with the new state
+	LATENCY_STAGE_SEND,     // The changed report was queued on the IN endpoint
+	LATENCY_STAGE_COMPLETE, // The host collected the report
+	LATENCY_STAGE_COUNT,
+} LatencyStage;
+
+// All latencies are in microseconds from the pin edge
+struct LatencyStageStats
+{
+	uint32_t count;
+	uint32_t minUs;
+	uint32_t maxUs;
+	uint32_t buckets[LATENCY_BUCKET_COUNT];
+};
+
+/**
+ * Also the binary dump format: little endian, no padding.
+ */
+struct LatencyStats
+{
+	uint32_t magic;
+	uint16_t version;
+	uint8_t stageCount;
+	uint8_t bucketCount;
+	uint32_t traces;    // Input events traced to completion
+	uint32_t abandoned; // Input events that timed out or never changed the report
+	LatencyStageStats stages[LATENCY_STAGE_COUNT];
+};
+
+/**
+ * @brief Follows one input event at a time from the pin edge to the host collecting the report.
+ *
+ * begin() starts a trace at the edge time, then each stage is marked in order as the event moves
+ * through the main loop. Marks for any other stage are ignored, so the hooks can be left in the hot
+ * path and cost a compare while no trace is running. The stats are kept in uninitialized RAM so
+ * they survive a soft reboot into the web configurator.
+ */
+class LatencyTracer
+{
+public:
+	void setup();
+	void reset();
+	void begin(uint64_t origin);
+	uint32_t percentile(LatencyStage stage, uint16_t permille);
+
+	inline void mark(LatencyStage stage, uint64_t now)
+	{
+		if (stage == nextStage)
+			record(stage, now);
+	}
+
+	// Shared with the other histograms kept in the same format
+	static void add(LatencyStageStats &stageStats, uint32_t us);
+	static uint32_t percentile(const LatencyStageStats &stageStats, uint16_t permille);
+
+	inline bool active() { return nextStage < LATENCY_STAGE_COUNT; }
+
+	static uint8_t bucketIndex(uint32_t us);
+	static uint32_t bucketLowerBound(uint8_t index);
+
+	LatencyStats *stats;
+
+protected:
+	void record(LatencyStage stage, uint64_t now);
+
+	uint64_t origin = 0;
+	uint8_t nextStage = LATENCY_STAGE_COUNT;
+};
+
+extern LatencyTracer latencyTracer;
+
+#endif
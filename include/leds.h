@@ -149,6 +149,8 @@ public:
 	void setup();
 	void loop();
 	void process(Gamepad *gamepad);
+	void suspend();
+	void resume();
 	void trySave();
 	void configureLEDs();
 	uint32_t frame[100];
@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef MODESWITCH_H_
+#define MODESWITCH_H_
+
+#include <stdint.h>
+#include "gamepad.h"
+
+#ifndef USB_DETACH_MS
+#define USB_DETACH_MS 20 // How long the device stays off the bus when switching input modes
+#endif
+
+struct InputModeSwitchStats
+{
+	uint32_t switches;  // Input mode switches made in play
+	uint32_t completed; // Switches the host has collected a report in the new mode for
+	uint32_t lastUs;    // Hotkey to the first report collected in the new mode
+	uint32_t maxUs;
+};
+
+/**
+ * @brief Switches input modes in play by re-enumerating, with no reboot.
+ *
+ * The device drops off the bus long enough for the host to notice it has gone, saves the new mode, then
+ * comes back with the new mode's descriptors and class driver. The time from the hotkey to the first
+ * report the host collects in the new mode is measured from the report completion hook.
+ */
+class InputModeSwitch
+{
+public:
+	InputMode hotkey(Gamepad &gamepad, InputMode current);
+	bool run(Gamepad &gamepad, InputMode mode);
+
+	inline void complete(uint64_t now)
+	{
+		if (waiting)
+			finish(now);
+	}
+
+	InputModeSwitchStats stats = { };
+
+protected:
+	void finish(uint64_t now);
+
+	uint64_t startUs = 0;
+	volatile bool waiting = false;
+};
+
+extern InputModeSwitch inputModeSwitch;
+
+#endif
@@ -12,8 +12,6 @@
 #include "PlayerLEDs.h"
 #include "gp2040.h"
 
-#define PLED_REPORT_SIZE 32
-
 #ifndef PLED1_PIN
 #define PLED1_PIN -1
 #endif
@@ -57,7 +55,6 @@ public:
 	void setup();
 	void loop();
 	void process(Gamepad *gamepad);
-	queue_t featureQueue;
 protected:
 	PLEDType type;
 	PlayerLEDs *pleds = nullptr;
@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef POLLSTATS_H_
+#define POLLSTATS_H_
+
+#include <stdint.h>
+#include "latency.h"
+
+#define POLL_STATS_MAGIC         0x4C505047 // "GPPL"
+#define POLL_STATS_VERSION       1
+#define POLL_INTERVAL_FRAMES_MAX 8          // Intervals this long or longer share the last intervalFrames[] slot
+#define POLL_FRAME_MASK          0x7FF      // Frame numbers are 11 bits
+#define POLL_FRAME_US            1000
+#define POLL_FRAME_GAP_MAX       16         // Longer gaps between SOFs are the bus going quiet, not the loop falling behind
+
+typedef enum
+{
+	POLL_HISTOGRAM_INTERVAL,  // Time between completions with the endpoint armed the whole time, the host's real polling interval
+	POLL_HISTOGRAM_JITTER,    // How far each of those intervals is off the SOF grid, |interval - frames * 1ms|
+	POLL_HISTOGRAM_STALENESS, // Age of the report's input sample when the host collected it
+	POLL_HISTOGRAM_COUNT,
+} PollHistogram;
+
+/**
+ * Also the binary dump format: little endian, no padding. The histograms use the latency buckets.
+ */
+struct PollStats
+{
+	uint32_t magic;
+	uint16_t version;
+	uint8_t histogramCount;
+	uint8_t bucketCount;
+	uint32_t frames;        // SOFs counted by the main loop from the frame number
+	uint32_t framesSkipped; // SOFs that went by while the main loop was busy, a firmware bottleneck
+	uint32_t completions;   // Reports collected by the host
+	uint32_t intervals;     // Completions that measured the polling interval
+	uint32_t intervalFrames[POLL_INTERVAL_FRAMES_MAX + 1]; // Measured intervals by whole frames, [1] is 1000Hz
+	LatencyStageStats histograms[POLL_HISTOGRAM_COUNT];
+};
+
+/**
+ * @brief Measures how often the host really polls the gamepad IN endpoint, and how old the reports are when it does.
+ *
+ * The polling interval can only be read off two completions when the endpoint was armed in between,
+ * so an interval is only counted when the report was queued in the same frame the previous one was
+ * collected. Completions are timestamped in the class drivers' transfer callbacks, which run as soon
+ * as the USB interrupt fires with USB_SERVICE_IRQ and from the next tud_task() otherwise. Like the
+ * latency stats, the stats are kept in uninitialized RAM so they survive a soft reboot into the web
+ * configurator.
+ */
+class PollTracker
+{
+public:
+	void setup();
+	void reset();
+	void frame(uint16_t frame);
+	void queued(uint64_t sampleUs, uint16_t frame);
+	void complete(uint64_t now, uint16_t frame);
+
+	inline uint32_t percentile(PollHistogram histogram, uint16_t permille)
+	{
+		return LatencyTracer::percentile(stats->histograms[histogram], permille);
+	}
+
+	PollStats *stats;
+
+protected:
+	bool framed = false;
+	bool completed = false;
+	bool armed = false;        // A report has been on the endpoint since the last completion's frame
+	uint16_t lastFrame = 0;
+	uint16_t completeFrame = 0;
+	uint64_t completeUs = 0;
+	uint64_t sampleUs = 0;     // Input sample time of the report on the endpoint
+};
+
+extern PollTracker pollTracker;
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+	POWER_ACTIVE,
+	POWER_SUSPENDING, // Waiting for core1 to blank the outputs and park
+	POWER_SUSPENDED,  // Outputs blanked, core1 parked and clk_sys lowered
+} PowerState;
+
+struct PowerStats
+{
+	uint32_t suspends;     // Bus suspends handled
+	uint32_t wakeups;      // Remote wakeups signalled on an input change
+	uint32_t lastResumeUs; // Resume callback to full speed with core1 running again
+	uint32_t maxResumeUs;
+};
+
+/**
+ * @brief Follows USB suspend and resume, so an idle controller draws as little as it can.
+ *
+ * The USB callbacks only leave requests, so they are safe from the service IRQ. The main loop acts
+ * on them in task(): on suspend core1 blanks its outputs and parks, then clk_sys drops to the USB
+ * PLL's 48MHz and the system PLL stops. The loop keeps reading the buttons at the lower clock, with
+ * the PIO sampler re-divided to keep its rate, and only a report that changed signals a remote
+ * wakeup. On resume the system PLL comes back with the settings it had, and clk_sys and clk_peri go
+ * back to their sources and speeds, so the UART and SPI baud rates hold. That is done before core1
+ * is released, well within a frame.
+ */
+class PowerManager
+{
+public:
+	void suspend(bool remoteWakeup); // USB context
+	void resume();                   // USB context
+	void task();                     // core0
+	void wake();                     // core0, a changed report while suspended
+	void park();                     // core1, returns once the bus has resumed
+
+	inline bool isSuspended() { return state != POWER_ACTIVE; }
+
+	PowerStats stats = { };
+
+protected:
+	void lowerClock();
+	void restoreClock();
+
+	volatile PowerState state = POWER_ACTIVE;
+	volatile bool suspendRequested = false;
+	volatile bool core1Parked = false;
+	bool remoteWakeupEnabled = false;
+	bool wakeSignalled = false;
+	uint32_t sysClockHz = 0;   // clk_sys before the suspend
+	uint32_t sysPllVcoHz = 0;  // System PLL settings before the suspend
+	uint8_t sysPllRefDiv = 0;
+	uint8_t sysPllPostDiv1 = 0;
+	uint8_t sysPllPostDiv2 = 0;
+	uint32_t periClockHz = 0;  // clk_peri and its source before the suspend
+	uint32_t periAuxSrc = 0;
+	uint64_t resumeUs = 0;
+};
+
+extern PowerManager powerManager;
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef REPORTPIPELINE_H_
+#define REPORTPIPELINE_H_
+
+#include <stddef.h>
+#include <string.h>
+#include "tusb.h"
+#include "gamepad.h"
+#include "pollstats.h"
+#include "power.h"
+#include "usb_driver.h"
+#include "hid_driver.h"
+#include "keyboard.h"
+#include "xinput_driver.h"
+
+#ifndef USB_SERVICE_IRQ
+#define USB_SERVICE_IRQ 0 // Service TinyUSB from a low priority IRQ instead of polling it from the loop
+#endif
+
+/**
+ * @brief Per input mode report type, builder, sender and the byte range that can change between reports.
+ *
+ * The sender takes the player's interface instance, only HID mode has more than one.
+ */
+template <InputMode Mode>
+struct ReportTraits;
+
+template <>
+struct ReportTraits<INPUT_MODE_XINPUT>
+{
+	typedef XInputReport Report;
+
+	// Skip report_id/report_size and the reserved tail
+	static const size_t diffStart = offsetof(XInputReport, buttons1);
+	static const size_t diffEnd   = offsetof(XInputReport, _reserved);
+
+	static inline Report *build(Gamepad &gamepad) { return gamepad.getXInputReport(); }
+	static inline bool send(uint8_t instance, Report *report) { (void)instance; return send_xinput_report(report, sizeof(Report)); }
+};
+
+template <>
+struct ReportTraits<INPUT_MODE_SWITCH>
+{
+	typedef SwitchReport Report;
+
+	// The vendor byte is constant
+	static const size_t diffStart = 0;
+	static const size_t diffEnd   = offsetof(SwitchReport, vendor);
+
+	static inline Report *build(Gamepad &gamepad) { return gamepad.getSwitchReport(); }
+	static inline bool send(uint8_t instance, Report *report) { return send_hid_report_n(instance, 0, report, sizeof(Report)); }
+};
+
+template <>
+struct ReportTraits<INPUT_MODE_HID>
+{
+	typedef HIDReport Report;
+
+	// The analog button bytes follow the digital buttons, so the whole report can change
+	static const size_t diffStart = 0;
+	static const size_t diffEnd   = sizeof(HIDReport);
+
+	static inline Report *build(Gamepad &gamepad) { return gamepad.getHIDReport(); }
+	static inline bool send(uint8_t instance, Report *report) { return send_hid_report_n(instance, 0, report, sizeof(Report)); }
+};
+
+template <>
+struct ReportTraits<INPUT_MODE_KEYBOARD>
+{
+	typedef KeyboardReport Report;
+
+	// Every byte is key bits
+	static const size_t diffStart = 0;
+	static const size_t diffEnd   = sizeof(KeyboardReport);
+
+	static inline Report *build(Gamepad &gamepad) { return keyboardMapper.build(gamepad); }
+	static inline bool send(uint8_t instance, Report *report) { return send_hid_report_n(instance, 0, report, sizeof(Report)); }
+};
+
+/**
+ * @brief Builds, diffs and sends the report for one input mode, with no per-frame mode dispatch.
+ *
+ * Reports live in a ping-pong pair of buffers of the exact report type. The one last handed to the
+ * IN endpoint stays untouched while the host may still be reading it, and doubles as the baseline
+ * the next report is diffed against, over only the bytes that can change. A changed report goes
+ * into the other buffer, which is handed straight to the endpoint, then the two swap roles.
+ *
+ * A changed report that finds the endpoint busy waits in the free buffer, replaced by anything
+ * newer, until flush() gets it onto the endpoint. flush() runs on every cycle, so sending never
+ * blocks. With USB_SERVICE_IRQ it also runs from the service IRQ when the host collects a report
+ * while the loop is behind schedule, so a stalled loop doesn't hold a waiting report back.
+ *
+ * Each player has its own pipeline, sending on the interface instance set before the first run().
+ * Only the first player's reports feed the polling stats.
+ */
+template <InputMode Mode>
+class ReportPipeline
+{
+public:
+	typedef ReportTraits<Mode> Traits;
+	typedef typename Traits::Report Report;
+
+	inline void run(Gamepad &gamepad, uint64_t sampleUs)
+	{
+		Report *report = Traits::build(gamepad);
+
+		usb_service_lock();
+
+		// A report that changed back to what the host already has no longer needs to go out
+		pending = unsent || memcmp((uint8_t *)report + Traits::diffStart, (uint8_t *)&buffers[sentIndex] + Traits::diffStart, Traits::diffEnd - Traits::diffStart) != 0;
+		if (pending)
+		{
+			memcpy(&buffers[sentIndex ^ 1], report, sizeof(Report));
+			waitingSampleUs = sampleUs;
+
+			// Only a debounced input change wakes the host, not every cycle of an idle controller
+			if (tud_suspended())
+				powerManager.wake();
+		}
+
+		flush();
+
+		usb_service_unlock();
+	}
+
+	inline void flush()
+	{
+		if (pending && Traits::send(instance, &buffers[sentIndex ^ 1]))
+		{
+			sentIndex ^= 1;
+			pending = false;
+			unsent = false;
+			if (instance == 0)
+				pollTracker.queued(waitingSampleUs, get_usb_frame());
+			report_queued_cb(instance);
+		}
+	}
+
+	// Start over for a new connection, the host has no report until the first one goes out
+	inline void reset()
+	{
+		memset(buffers, 0, sizeof(buffers));
+		sentIndex = 0;
+		pending = false;
+		unsent = true;
+	}
+
+	uint8_t instance = 0;
+
+protected:
+	Report buffers[2] = { };
+	uint8_t sentIndex = 0; // Last handed to the endpoint, the other buffer is free
+	uint64_t waitingSampleUs = 0;
+	volatile bool pending = false;
+	bool unsent = true;    // Nothing has gone out since reset(), so the next report does whatever it holds
+};
+
+#endif
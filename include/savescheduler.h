@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SAVESCHEDULER_H_
+#define SAVESCHEDULER_H_
+
+#include <stdint.h>
+
+#ifndef SAVE_IDLE_MS
+#define SAVE_IDLE_MS 500 // How long the inputs must be left alone before a settings save is written
+#endif
+
+/**
+ * @brief Holds settings saves back until the player has stopped, as the write gate for FlashPROM.
+ *
+ * A report is only queued when the inputs changed, so the time of the last one is the time of the last
+ * input change. A flash operation is allowed once that is SAVE_IDLE_MS ago and no report is waiting for
+ * the host to collect it. A page program must also fit before the next input/report cycle starts, a
+ * sector erase can't fit in a frame so it waits for the idle time with every button released instead,
+ * as a button held down sends no reports but is still being played. FlashPROM writes at its deadline
+ * whatever the gate says, so a player who never stops still gets their settings saved.
+ */
+class SaveScheduler
+{
+public:
+	void setup(uint32_t idleMs = SAVE_IDLE_MS);
+	bool allows(uint32_t us); // Write alarm
+
+	inline void queued(uint8_t instance, uint64_t now)
+	{
+		lastInputUs = static_cast<uint32_t>(now);
+		inFlight |= 1u << instance;
+	}
+
+	inline void complete(uint8_t instance) { inFlight &= ~(1u << instance); }
+
+	// The primary's debounced pins after each read, set bits are held down
+	inline void pressed(uint32_t pins) { pressedPins = pins; }
+
+	// A new connection has nothing in flight
+	inline void reset() { inFlight = 0; }
+
+protected:
+	uint32_t idleUs = SAVE_IDLE_MS * 1000;
+	volatile uint32_t lastInputUs = 0; // Low word of the time, read in one load by the write alarm
+	volatile uint32_t inFlight = 0; // One bit per report instance queued and not yet collected
+	volatile uint32_t pressedPins = 0;
+};
+
+extern SaveScheduler saveScheduler;
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#define SCHEDULER_FRAME_US       1000 // Full speed USB frame length
+#define SCHEDULER_SOF_TIMEOUT_US 3000 // Free-run on the timer when no SOF has been seen for this long
+
+#ifndef SCHEDULER_LEAD_US
+#define SCHEDULER_LEAD_US 250 // Sample inputs and build the report this long before the next SOF
+#endif
+
+struct SchedulerStats
+{
+	uint32_t cycles;      // Completed input/report cycles
+	uint32_t missed;      // Cycles that completed after their target SOF
+	uint32_t unlocked;    // Cycles run from the free-running timer instead of the SOF
+	uint32_t lastRunUs;   // Duration of the last cycle
+	uint32_t maxRunUs;    // Longest cycle
+	int32_t lastSlackUs;  // Time left before the target SOF when the last cycle completed
+	int32_t minSlackUs;   // Smallest slack seen, negative when a deadline was missed
+	uint64_t totalSlackUs;
+};
+
+/**
+ * @brief Paces the core0 input/report cycle against the USB start-of-frame.
+ *
+ * The main loop feeds every SOF it sees through onFrame(), and runs a cycle whenever ready() returns
+ * true. Cycles are placed leadUs before the next expected SOF, so the report is queued just before
+ * the host's next IN poll with the freshest inputs possible.
+ */
+class Scheduler
+{
+public:
+	void setup(uint32_t leadUs = SCHEDULER_LEAD_US);
+	void onFrame(uint64_t now);
+	bool ready(uint64_t now);
+	void begin(uint64_t now);
+	void complete(uint64_t now);
+
+	inline bool isLocked(uint64_t now) { return locked && (now - lastSof) < SCHEDULER_SOF_TIMEOUT_US; }
+	inline uint64_t nextFrame() { return lastSof + SCHEDULER_FRAME_US; }
+
+	// The SOF the next cycle targets went by without the cycle running
+	inline bool isBehind(uint64_t now) { return now >= nextRun + leadUs; }
+
+	// A cycle is running, or the next one is due within us
+	inline bool isBusy(uint64_t now, uint32_t us) { return running || now + us > nextRun; }
+
+	uint32_t leadUs = SCHEDULER_LEAD_US;
+	SchedulerStats stats = { };
+
+protected:
+	bool locked = false;
+	uint64_t lastSof = 0;   // Filtered time of the latest SOF
+	uint64_t nextRun = 0;   // When the next cycle should start
+	uint64_t deadline = 0;  // The SOF the running cycle is targeting
+	uint64_t cycleStart = 0;
+	volatile bool running = false;
+};
+
+extern Scheduler scheduler;
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Single-writer sequence lock for handing the latest value of a small struct to the other core.
+ *
+ * The writer never waits. The sequence is odd while a write is in progress, so a reader retries the
+ * copy if the sequence was odd or changed underneath it. Readers only ever see the newest value, so
+ * intermediate writes are skipped rather than queued.
+ */
+template <typename T>
+class SeqLock
+{
+public:
+	void write(const T &value)
+	{
+		uint32_t next = sequence + 1;
+		sequence = next;
+		__dmb();
+		data = value;
+		__dmb();
+		sequence = next + 1;
+	}
+
+	// Copies the value if it changed since lastSequence, which is updated on success
+	bool read(T &value, uint32_t &lastSequence)
+	{
+		while (true)
+		{
+			uint32_t start = sequence;
+			if (start == lastSequence)
+				return false;
+
+			if (start & 1)
+				continue;
+
+			__dmb();
+			value = data;
+			__dmb();
+
+			if (sequence == start)
+			{
+				lastSequence = start;
+				return true;
+			}
+		}
+	}
+
+protected:
+	volatile uint32_t sequence = 0;
+	T data;
+};
+
+#endif
@@ -9,11 +9,17 @@
 #include <stdint.h>
 #include "NeoPico.hpp"
 #include "enums.h"
+#include <GamepadState.h>
+#include <GamepadStorage.h>
 
-#define GAMEPAD_STORAGE_INDEX      0 // 1024 bytes for gamepad options
-#define BOARD_STORAGE_INDEX     1024 //  512 bytes for hardware options
-#define LED_STORAGE_INDEX       1536 //  512 bytes for LED configuration
-#define ANIMATION_STORAGE_INDEX 2048 // ???? bytes for LED animations
+#define GAMEPAD_STORAGE_INDEX         0 // 1024 bytes for gamepad options
+#define BOARD_STORAGE_INDEX        1024 //  512 bytes for hardware options
+#define LED_STORAGE_INDEX          1536 //  512 bytes for LED configuration
+#define ANIMATION_STORAGE_INDEX    2048 // ???? bytes for LED animations
+#define DEBOUNCE_STORAGE_INDEX     3072 //  256 bytes for debounce configuration
+#define PLAYER_STORAGE_INDEX       3328 //  256 bytes for the gamepad options of the players after the first
+#define KEYBOARD_STORAGE_INDEX     3584 //  256 bytes for the keyboard mode's key mapping
+#define INPUT_SOURCE_STORAGE_INDEX 3840 //  256 bytes for the input source picked in play
 
 struct BoardOptions
 {
@@ -80,10 +86,62 @@ struct LEDOptions
 	int indexA2;
 };
 
+struct DebounceOptions
+{
+	DebounceMode debounceMode;
+	uint8_t debounceMillis[GAMEPAD_DIGITAL_INPUT_COUNT]; // Window of each input in milliseconds, in the order of Gamepad::gamepadMappings
+	uint32_t checksum;
+};
+
+// HID keyboard usages sent for each button in keyboard mode, 0 for none
+struct KeyboardMapping
+{
+	uint8_t keyDpadUp;
+	uint8_t keyDpadDown;
+	uint8_t keyDpadLeft;
+	uint8_t keyDpadRight;
+	uint8_t keyButtonB1;
+	uint8_t keyButtonB2;
+	uint8_t keyButtonB3;
+	uint8_t keyButtonB4;
+	uint8_t keyButtonL1;
+	uint8_t keyButtonR1;
+	uint8_t keyButtonL2;
+	uint8_t keyButtonR2;
+	uint8_t keyButtonS1;
+	uint8_t keyButtonS2;
+	uint8_t keyButtonL3;
+	uint8_t keyButtonR3;
+	uint8_t keyButtonA1;
+	uint8_t keyButtonA2;
+	uint32_t checksum;
+};
+
+// How the pins are read, picked with a hotkey in play
+struct InputSourceOptions
+{
+	InputSource inputSource;
+	uint32_t checksum;
+};
+
 BoardOptions getBoardOptions();
 void setBoardOptions(BoardOptions options);
 
 LEDOptions getLEDOptions();
 void setLEDOptions(LEDOptions options);
 
+DebounceOptions getDebounceOptions();
+void setDebounceOptions(DebounceOptions options);
+
+// Players after the first, their pins only come from the board configuration
+BoardOptions getPlayerBoardOptions(uint8_t player);
+GamepadOptions getPlayerOptions(uint8_t player);
+void setPlayerOptions(uint8_t player, GamepadOptions options);
+
+KeyboardMapping getKeyboardMapping();
+void setKeyboardMapping(KeyboardMapping mapping);
+
+InputSourceOptions getInputSourceOptions();
+void setInputSourceOptions(InputSourceOptions options);
+
 #endif
@@ -0,0 +1,106 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "inputtrace.h"
+
+#ifndef HAS_USB_TELEMETRY
+#define HAS_USB_TELEMETRY 0
+#endif
+
+#define TELEMETRY_METRICS_INTERVAL_US 100000  // Metrics ten times a second
+#define TELEMETRY_STATS_INTERVAL_US   1000000 // The full latency and polling histograms once a second
+#define TELEMETRY_TRACE_RECORDS       7       // Input trace records per packet
+#define TELEMETRY_STATS_CHUNK         56      // LatencyStats or PollStats bytes per packet
+
+typedef enum
+{
+	TELEMETRY_PACKET_METRICS = 1, // TelemetryMetrics
+	TELEMETRY_PACKET_TRACE   = 2, // TelemetryTrace
+	TELEMETRY_PACKET_LATENCY = 3, // TelemetryStats of LatencyStats
+	TELEMETRY_PACKET_POLL    = 4, // TelemetryStats of PollStats
+} TelemetryPacketType;
+
+/**
+ * Packets are sent one per bulk transfer, little endian, no padding.
+ */
+struct TelemetryHeader
+{
+	uint8_t type;
+	uint8_t length;    // Payload bytes after the header
+	uint16_t sequence; // Increments with every packet, so the reader can spot dropped ones
+};
+
+struct TelemetryMetrics
+{
+	uint32_t timeMs;
+	uint32_t cycles;
+	uint32_t missed;
+	uint32_t unlocked;
+	uint32_t maxRunUs;
+	int32_t minSlackUs;
+	uint32_t latencyTraces;
+	uint32_t latencyAbandoned;
+	uint32_t latencyP50Us; // Pin edge to the host collecting the report
+	uint32_t latencyP99Us;
+	uint32_t traceWritten;
+	uint32_t traceSkipped; // Trace records overwritten before they could be streamed
+	uint32_t pollIntervalP50Us; // The host's measured polling interval
+	uint32_t pollJitterP99Us;
+	uint32_t stalenessP99Us;    // Input sample to the host collecting the report
+};
+
+// New input trace records in order, record N of the trace is the Nth change since it started
+struct TelemetryTrace
+{
+	uint32_t first; // Record number of records[0]
+	InputTraceRecord records[TELEMETRY_TRACE_RECORDS];
+};
+
+// A slice of a stats struct, the reader reassembles it from offset 0 to total
+struct TelemetryStats
+{
+	uint16_t offset;
+	uint16_t total;
+	uint8_t bytes[TELEMETRY_STATS_CHUNK];
+};
+
+/**
+ * @brief Streams live metrics, input trace records and the latency and polling histograms over the vendor interface.
+ *
+ * task() runs on core0 right after a report has been queued, when there is the most time before the
+ * next cycle, and sends at most one packet while the bulk endpoint is free. The host only polls bulk
+ * endpoints with bandwidth the interrupt endpoints leave over, so the gamepad reports always go first.
+ */
+class Telemetry
+{
+public:
+	void setup();
+	void task(uint64_t now);
+
+	inline bool isEnabled() { return enabled; }
+
+protected:
+	bool sendTrace();
+	void sendMetrics(uint64_t now);
+	bool sendStats(TelemetryPacketType type, const void *stats, uint16_t size, uint32_t &offset);
+	bool send(TelemetryPacketType type, const void *payload, uint8_t length);
+
+	bool enabled = false;
+	uint16_t sequence = 0;
+	uint32_t traceSent = 0;
+	uint32_t traceSkipped = 0;
+	uint32_t latencyOffset = UINT32_MAX; // Not sending the histograms
+	uint32_t pollOffset = UINT32_MAX;
+	uint64_t nextMetrics = 0;
+	uint64_t nextStats = 0;
+};
+
+extern Telemetry telemetry;
+
+#endif
@@ -6,13 +6,115 @@
 
 #include "CRC32.h"
 
-static const uint32_t crc32_table[] = {
-	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
-	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
-	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
-	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+#if CRC32_DMA_SNIFFER
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#endif
+
+#define CRC32_POLYNOMIAL 0xedb88320 // IEEE 802.3, reflected
+
+// Slice 0 is the byte at a time table, slice n is the same byte n bytes further back
+struct CRC32Tables {
+	uint32_t slices[CRC32_SLICES][256];
+};
+
+static constexpr CRC32Tables makeTables() {
+	CRC32Tables tables = { };
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : (crc >> 1);
+		tables.slices[0][i] = crc;
+	}
+
+	for (int slice = 1; slice < CRC32_SLICES; slice++) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t previous = tables.slices[slice - 1][i];
+			tables.slices[slice][i] = (previous >> 8) ^ tables.slices[0][previous & 0xff];
+		}
+	}
+
+	return tables;
+}
+
+static constexpr CRC32Tables crc32_tables = makeTables();
+
+static inline uint32_t word(const uint8_t *data) {
+	// Byte loads, the M0+ faults on an unaligned word load
+	return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline uint32_t fold(uint32_t value, int slice) {
+	const uint32_t (&t)[CRC32_SLICES][256] = crc32_tables.slices;
+	return t[slice + 3][value & 0xff] ^ t[slice + 2][(value >> 8) & 0xff] ^ t[slice + 1][(value >> 16) & 0xff] ^ t[slice][value >> 24];
+}
+
+static uint32_t updateState(uint32_t state, const uint8_t *data, uint32_t size) {
+	for (; size >= CRC32_SLICES; size -= CRC32_SLICES, data += CRC32_SLICES) {
+#if CRC32_SLICES == 8
+		state = fold(state ^ word(data), 4) ^ fold(word(data + 4), 0);
+#else
+		state = fold(state ^ word(data), 0);
+#endif
+	}
+
+	for (; size > 0; size--, data++)
+		state = crc32_tables.slices[0][(state ^ *data) & 0xff] ^ (state >> 8);
+
+	return state;
+}
+
+#if CRC32_DMA_SNIFFER
+
+struct CRC32Sniffer {
+	CRC32Sniffer();
+
+	int channel;
+	spin_lock_t *lock;
 };
 
+static CRC32Sniffer sniffer;
+static uint8_t sniffSink;
+
+// Reads the buffer a byte per transfer into a sink the sniffer watches. CRC32R with the output
+// reversed and inverted is the reflected CRC-32 the tables work out, and the all ones seed reads
+// the same either way round.
+static uint32_t sniff(const uint8_t *data, uint32_t size) {
+	dma_channel_config config = dma_channel_get_default_config(sniffer.channel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_sniff_enable(&config, true);
+
+	uint32_t interrupts = spin_lock_blocking(sniffer.lock);
+	dma_sniffer_enable(sniffer.channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+	dma_sniffer_set_output_reverse_enabled(true);
+	dma_sniffer_set_output_invert_enabled(true);
+	dma_hw->sniff_data = 0xffffffff;
+	dma_channel_configure(sniffer.channel, &config, &sniffSink, data, size, true);
+	dma_channel_wait_for_finish_blocking(sniffer.channel);
+	uint32_t crc = dma_hw->sniff_data;
+	spin_unlock(sniffer.lock, interrupts);
+
+	return crc;
+}
+
+// The CRC-32 catalogue's check string
+static const uint8_t sniffCheck[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+// Claimed before main(), so neither core has to race the other for them. A sniffer that doesn't
+// work the check string out the same as the tables is given up on, and the tables do every buffer.
+CRC32Sniffer::CRC32Sniffer() {
+	channel = dma_claim_unused_channel(false);
+	lock = spin_lock_instance(spin_lock_claim_unused(true));
+	if (channel >= 0 && sniff(sniffCheck, sizeof(sniffCheck)) != ~updateState(~0u, sniffCheck, sizeof(sniffCheck))) {
+		dma_channel_unclaim(channel);
+		channel = -1;
+	}
+}
+
+#endif
+
 CRC32::CRC32() {
 	reset();
 }
@@ -22,16 +124,31 @@ void CRC32::reset() {
 }
 
 void CRC32::update(const uint8_t &data) {
-	// via http://forum.arduino.cc/index.php?topic=91179.0
-	uint8_t tbl_idx = 0;
+	_state = crc32_tables.slices[0][(_state ^ data) & 0xff] ^ (_state >> 8);
+}
 
-	tbl_idx = _state ^ (data >> (0 * 4));
-	_state = *(uint32_t *)(crc32_table + (tbl_idx & 0x0f)) ^ (_state >> 4);
-	tbl_idx = _state ^ (data >> (1 * 4));
-	_state = *(uint32_t *)(crc32_table + (tbl_idx & 0x0f)) ^ (_state >> 4);
+void CRC32::updateBytes(const uint8_t *data, uint32_t size) {
+	_state = updateState(_state, data, size);
 }
 
 uint32_t CRC32::finalize() const
 {
 	return ~_state;
 }
+
+bool CRC32::sniffing() {
+#if CRC32_DMA_SNIFFER
+	return sniffer.channel >= 0;
+#else
+	return false;
+#endif
+}
+
+uint32_t CRC32::calculateBytes(const uint8_t *data, uint32_t size) {
+#if CRC32_DMA_SNIFFER
+	if (size >= CRC32_DMA_MIN_BYTES && sniffer.channel >= 0)
+		return sniff(data, size);
+#endif
+
+	return ~updateState(~0u, data, size);
+}
@@ -8,6 +8,24 @@
 
 #include <stdint.h>
 
+/// \brief Table slices for buffers, 4 or 8. Each slice is a 1KB table, and the loop takes that many bytes at a time.
+#ifndef CRC32_SLICES
+#define CRC32_SLICES 4
+#endif
+
+/// \brief Hand whole buffers given to calculate() to the RP2040's DMA sniffer. It is checked against
+/// the tables before main(), and left unused if they disagree.
+#ifndef CRC32_DMA_SNIFFER
+#define CRC32_DMA_SNIFFER 1
+#endif
+
+/// \brief Smallest buffer worth setting up a DMA transfer for, shorter ones use the tables.
+#ifndef CRC32_DMA_MIN_BYTES
+#define CRC32_DMA_MIN_BYTES 32
+#endif
+
+static_assert(CRC32_SLICES == 4 || CRC32_SLICES == 8, "CRC32_SLICES must be 4 or 8");
+
 /// \brief A class for calculating the CRC32 checksum from arbitrary data.
 /// \sa http://forum.arduino.cc/index.php?topic=91179.0
 class CRC32 {
@@ -36,15 +54,14 @@ public:
 	/// \param size Size of the array to add.
 	template <typename Type>
 	void update(const Type *data, uint16_t size) {
-		uint16_t nBytes = size * sizeof(Type);
-		const uint8_t *pData = (const uint8_t *)data;
-
-		for (uint16_t i = 0; i < nBytes; i++)
-		{
-			update(pData[i]);
-		}
+		updateBytes((const uint8_t *)data, size * sizeof(Type));
 	}
 
+	/// \brief Update the current checksum caclulation with a buffer, CRC32_SLICES bytes at a time.
+	/// \param data The bytes to add to the checksum.
+	/// \param size The number of bytes to add.
+	void updateBytes(const uint8_t *data, uint32_t size);
+
 	/// \returns the caclulated checksum.
 	uint32_t finalize() const;
 
@@ -55,11 +72,19 @@ public:
 	/// \returns the calculated checksum.
 	template <typename Type>
 	static uint32_t calculate(const Type *data, uint16_t size = 1) {
-		CRC32 crc;
-		crc.update(data, size);
-		return crc.finalize();
+		return calculateBytes((const uint8_t *)data, size * sizeof(Type));
 	}
 
+	/// \brief Calculate the checksum of a whole buffer, with the DMA sniffer when it is free.
+	/// \param data The bytes to checksum.
+	/// \param size The number of bytes.
+	/// \returns the calculated checksum, the same whichever way it was worked out.
+	static uint32_t calculateBytes(const uint8_t *data, uint32_t size);
+
+	/// \returns whether calculateBytes() hands buffers to the DMA sniffer: it is built in, got a
+	/// channel and passed its check.
+	static bool sniffing();
+
 private:
 	/// \brief The internal checksum state.
 	uint32_t _state = ~0L;
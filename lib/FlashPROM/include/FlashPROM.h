@@ -17,13 +17,114 @@
 #define EEPROM_ADDRESS_START _u(0x101FF000) // The arduino-pico EEPROM lib starts here, so we'll do the same
 // Warning: If the write wait is too long it can stall other processes
 #define EEPROM_WRITE_WAIT    50             // Amount of time in ms to wait before blocking core1 and committing to flash
+#define EEPROM_OP_GAP_US     250            // Time between the erases and programs of one commit, for the rest of the firmware to run
+#define EEPROM_ERASE_US      45000          // Typical sector erase, what the write gate is asked to make room for
+#define EEPROM_PROGRAM_US    400            // Typical page program
 
+// Most time in ms a commit waits on the write gate, after that it is written whether the gate agrees or not
+#ifndef EEPROM_WRITE_DEADLINE
+#define EEPROM_WRITE_DEADLINE 5000
+#endif
+
+// Number of flash sectors the store's log is spread across, ending with the sector at EEPROM_ADDRESS_START
+#ifndef EEPROM_SECTOR_COUNT
+#define EEPROM_SECTOR_COUNT  4
+#endif
+
+#define EEPROM_REGION_START   (EEPROM_ADDRESS_START + FLASH_SECTOR_SIZE - EEPROM_SECTOR_COUNT * FLASH_SECTOR_SIZE)
+#define EEPROM_SECTOR_PAGES   (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define EEPROM_SECTOR_RECORDS (EEPROM_SECTOR_PAGES - 1) // The first page of a sector is its header
+#define EEPROM_RECORD_HEADER  16
+#define EEPROM_BLOCK_SIZE     (FLASH_PAGE_SIZE - EEPROM_RECORD_HEADER)
+#define EEPROM_BLOCK_COUNT    ((EEPROM_SIZE_BYTES + EEPROM_BLOCK_SIZE - 1) / EEPROM_BLOCK_SIZE)
+#define EEPROM_PAGE_NONE      0xFFFF
+
+static_assert(EEPROM_BLOCK_COUNT <= 32, "One dirty bit per block");
+
+// The oldest sector's current blocks are moved on before it is erased, which needs room in the others
+// for every block's committed record and one from a commit in progress
+static_assert((EEPROM_SECTOR_COUNT - 1) * EEPROM_SECTOR_RECORDS > 2 * EEPROM_BLOCK_COUNT, "Too few sectors for the store");
+
+// The end of the firmware image is only known once it is linked, FlashPROM::start() checks that side
+static_assert(EEPROM_ADDRESS_START + FLASH_SECTOR_SIZE <= XIP_BASE + PICO_FLASH_SIZE_BYTES, "The store runs past the end of flash");
+
+// Written once to the first page of a sector when the log moves into it, sequence orders the sectors at boot
+struct FlashPROMSectorHeader
+{
+	uint32_t magic;
+	uint32_t sequence;      // Counts the sectors the log has moved into
+	uint32_t sequenceCheck; // ~sequence, a half written header doesn't count
+	uint32_t reserved;
+};
+
+// One page: a copy of one block of the cache, written by the commit with this generation
+struct FlashPROMRecord
+{
+	uint32_t magic;
+	uint32_t crc; // Everything after this field
+	uint32_t generation;
+	uint16_t block;
+	uint8_t flags;
+	uint8_t reserved;
+	uint8_t data[EEPROM_BLOCK_SIZE];
+};
+
+static_assert(sizeof(FlashPROMRecord) == FLASH_PAGE_SIZE, "A record fills one flash page");
+
+struct FlashPROMStats
+{
+	uint32_t commits;     // Commits that programmed anything
+	uint32_t records;     // Pages programmed with changed blocks
+	uint32_t relocations; // Pages programmed moving current blocks out of a sector before it is erased
+	uint32_t erases;
+	uint32_t lastStallUs; // Longest time in one go core1 was locked out and interrupts were off in the last commit
+	uint32_t maxStallUs;
+	uint32_t missedFrames; // USB frames that started while interrupts were off, their interrupts came late
+	uint32_t deferred;    // Commits the write gate held back at least once
+	uint32_t forced;      // Commits written at the deadline with the gate still holding them back
+};
+
+// Asked before a commit is planned and before each of its flash operations, with how long the
+// operation will hold the firmware up. Runs from the write alarm.
+typedef bool (*FlashPROMWriteGate)(uint32_t us);
+
+/**
+ * @brief EEPROM-like store kept as a log of records across EEPROM_SECTOR_COUNT flash sectors.
+ *
+ * The cache is split into blocks that each fit a flash page along with a record header. A commit
+ * appends a record for every block that differs from its last record, so a hotkey that changes one
+ * setting programs a single page instead of erasing and rewriting the whole sector. Sectors are only
+ * erased when the log wraps around to them, which spreads the wear evenly across the region. At boot
+ * the sector headers give the order to replay the records in, the latest record of each block wins.
+ *
+ * Commits are atomic: the records of a commit only count once its last record, marked as the end of
+ * the commit, has been programmed in full, and a record is only trusted when its CRC matches. Power lost
+ * in the middle of a commit or an erase leaves the previous commit's settings in place.
+ *
+ * set() marks the blocks it touches dirty, so a commit only compares and writes those, and a commit
+ * with nothing dirty doesn't lock core1 out at all. It copies the value in and marks the blocks under
+ * the same spin lock the commit's snapshot is taken under, so neither the write alarm nor the other
+ * core sees a half written value.
+ *
+ * A commit takes a snapshot of the dirty blocks and plans its erases and programs up front, then runs
+ * them one at a time from the write alarm. core1 and this core's interrupts are only held for the
+ * erase or program itself, so a commit stalls the rest of the firmware for one page program at a
+ * time, or the 45ms of a sector erase when the log wraps. core1's code runs from flash like the rest,
+ * so it still has to be locked out for each of them, and the interrupts this core misses meanwhile,
+ * the USB ones among them, run once the operation is done.
+ *
+ * With a write gate set, a commit waits until the gate agrees before each operation, and takes its
+ * snapshot only once the gate has agreed to the first one, so changes made while it waits are merged
+ * into the same commit. No commit waits longer than EEPROM_WRITE_DEADLINE after the first change.
+ */
 class FlashPROM
 {
 	public:
 		void start();
 		void commit();
 		void reset();
+		bool isWriting(); // A commit is waiting or being written
+		void setWriteGate(FlashPROMWriteGate gate);
 
 		template<typename T>
 		T &get(uint16_t const index, T &value)
@@ -37,14 +138,18 @@ class FlashPROM
 		template<typename T>
 		void set(uint16_t const index, const T &value)
 		{
-			uint16_t size = sizeof(T);
-
-			if ((index + size) <= EEPROM_SIZE_BYTES)
-				memcpy(&cache[index], &value, sizeof(T));
+			store(index, &value, sizeof(T));
 		}
 
+		static FlashPROMStats stats;
+
 	private:
-		static uint8_t cache[EEPROM_SIZE_BYTES];
+		friend int64_t writeToFlash(alarm_id_t id, void *flashCache);
+
+		static void store(uint16_t index, const void *value, uint16_t size);
+
+		static uint8_t cache[EEPROM_BLOCK_COUNT * EEPROM_BLOCK_SIZE];
+		static volatile uint32_t dirty; // One bit per block changed since the last commit
 };
 
 static FlashPROM EEPROM;
@@ -3,24 +3,475 @@
  * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
  */
 
+#include <stddef.h>
+#include <hardware/structs/usb.h>
 #include "FlashPROM.h"
+#include "CRC32.h"
 
-uint8_t FlashPROM::cache[EEPROM_SIZE_BYTES] = { };
+#define EEPROM_SECTOR_MAGIC     0x53504730 // "0GPS"
+#define EEPROM_RECORD_MAGIC     0x52504730 // "0GPR"
+#define EEPROM_RECORD_COMMIT    0x01       // Last record of its commit, the commit's records count from here on
+#define EEPROM_RECORD_RELOCATED 0x02       // A committed block moved out of a sector before its erase, counts on its own
+#define EEPROM_ALL_BLOCKS       ((uint32_t)((1ull << EEPROM_BLOCK_COUNT) - 1))
+
+// Most a commit can plan: the log's first sector, the spare checked after boot, every block, and a
+// header and a full spare for each sector the commit moves into
+#define EEPROM_OP_COUNT (2 + (EEPROM_SECTOR_RECORDS + 1) + EEPROM_BLOCK_COUNT + EEPROM_SECTOR_COUNT * (EEPROM_SECTOR_RECORDS + 2))
+
+typedef enum
+{
+	EEPROM_OP_ERASE,
+	EEPROM_OP_HEADER,
+	EEPROM_OP_RECORD,
+} FlashPROMOpType;
+
+// One erase or page program of a planned commit
+struct FlashPROMOp
+{
+	uint8_t type;
+	uint8_t flags;
+	uint16_t page;   // Page programmed, or the first page of the sector erased
+	uint16_t block;
+	uint16_t source; // Page a relocated record is copied from, none for a block of the commit
+	uint32_t value;  // Generation of a record, sequence of a header
+};
+
+extern "C" char __flash_binary_end; // End of the firmware image in flash, from the linker script
+
+uint8_t FlashPROM::cache[EEPROM_BLOCK_COUNT * EEPROM_BLOCK_SIZE] = { };
+FlashPROMStats FlashPROM::stats = { };
+volatile uint32_t FlashPROM::dirty = 0;
 volatile static alarm_id_t flashWriteAlarm = 0;
 volatile static spin_lock_t *flashLock = nullptr;
+volatile static bool flashWriting = false;
 
-int64_t writeToFlash(alarm_id_t id, void *flashCache)
+static uint16_t blockPages[EEPROM_BLOCK_COUNT];   // Page of the latest committed record of each block, counted from the start of the region
+static uint16_t pendingPages[EEPROM_BLOCK_COUNT]; // Pages of the commit being written
+static uint16_t headPage = EEPROM_PAGE_NONE;      // Next page to program, none until the log has a sector
+static uint8_t activeSector = 0;
+static uint32_t sectorSequence = 0;
+static uint32_t generation = 0;
+static bool spareReady = false;
+static FlashPROMRecord pageBuffer;
+static uint8_t snapshot[EEPROM_BLOCK_COUNT * EEPROM_BLOCK_SIZE]; // The cache as the commit being written took it
+static FlashPROMOp ops[EEPROM_OP_COUNT];
+static uint8_t opCount = 0;
+static uint8_t opNext = 0;
+static uint32_t commitHoldUs = 0; // Longest hold of the commit being written
+static FlashPROMWriteGate writeGate = nullptr;
+static uint64_t writeDeadline = 0; // The pending changes are written from here on, gate or not
+static bool commitDeferred = false;
+static bool commitForced = false;
+
+static inline const uint8_t *pageAddress(uint16_t page)
+{
+	return reinterpret_cast<const uint8_t *>(EEPROM_REGION_START + page * FLASH_PAGE_SIZE);
+}
+
+static inline uint32_t pageOffset(uint16_t page)
+{
+	return EEPROM_REGION_START - XIP_BASE + page * FLASH_PAGE_SIZE;
+}
+
+static inline const FlashPROMRecord *recordAt(uint16_t page)
+{
+	return reinterpret_cast<const FlashPROMRecord *>(pageAddress(page));
+}
+
+static inline uint16_t firstPage(uint8_t sector)
+{
+	return sector * EEPROM_SECTOR_PAGES;
+}
+
+static inline bool inSector(uint16_t page, uint8_t sector)
+{
+	return page != EEPROM_PAGE_NONE && page / EEPROM_SECTOR_PAGES == sector;
+}
+
+static bool isErased(uint16_t page, uint16_t count)
+{
+	const uint32_t *words = reinterpret_cast<const uint32_t *>(pageAddress(page));
+	for (uint32_t i = 0; i < count * FLASH_PAGE_SIZE / sizeof(uint32_t); i++)
+	{
+		if (words[i] != 0xFFFFFFFF)
+			return false;
+	}
+
+	return true;
+}
+
+static uint32_t recordCRC(const FlashPROMRecord *record)
+{
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(record) + offsetof(FlashPROMRecord, generation);
+	return CRC32::calculate(data, sizeof(FlashPROMRecord) - offsetof(FlashPROMRecord, generation));
+}
+
+static bool isValid(const FlashPROMRecord *record)
 {
-	while (is_spin_locked(flashLock));
+	return record->magic == EEPROM_RECORD_MAGIC && record->block < EEPROM_BLOCK_COUNT && record->crc == recordCRC(record);
+}
+
+static bool isValid(const FlashPROMSectorHeader *header)
+{
+	return header->magic == EEPROM_SECTOR_MAGIC && header->sequenceCheck == ~header->sequence;
+}
+
+static void queueOp(FlashPROMOpType type, uint16_t page, uint16_t block, uint16_t source, uint8_t flags, uint32_t value)
+{
+	if (opCount >= EEPROM_OP_COUNT)
+		panic("FlashPROM commit too long");
+
+	ops[opCount++] = { static_cast<uint8_t>(type), flags, page, block, source, value };
+}
+
+static void eraseSector(uint8_t sector)
+{
+	queueOp(EEPROM_OP_ERASE, firstPage(sector), 0, EEPROM_PAGE_NONE, 0, 0);
+}
 
+static void openSector(uint8_t sector)
+{
+	queueOp(EEPROM_OP_HEADER, firstPage(sector), 0, EEPROM_PAGE_NONE, 0, sectorSequence);
+
+	sectorSequence++;
+	activeSector = sector;
+	headPage = firstPage(sector) + 1;
+}
+
+static uint16_t appendRecord(uint16_t block, uint16_t source, uint8_t flags)
+{
+	queueOp(EEPROM_OP_RECORD, headPage, block, source, flags, generation);
+	return headPage++;
+}
+
+// Keeps the sector after the active one erased for the log to move into, once the committed and
+// pending records still needed from it have been copied to the active sector. Those fit: the active
+// sector was empty when the last spare was made, and has as many pages as the spare has records.
+static void makeSpare()
+{
+	uint8_t spare = (activeSector + 1) % EEPROM_SECTOR_COUNT;
+	spareReady = true;
+	if (isErased(firstPage(spare), EEPROM_SECTOR_PAGES))
+		return;
+
+	for (uint16_t block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		if (inSector(pendingPages[block], spare))
+			pendingPages[block] = appendRecord(block, pendingPages[block], 0);
+
+		if (inSector(blockPages[block], spare))
+			blockPages[block] = appendRecord(block, blockPages[block], EEPROM_RECORD_RELOCATED);
+	}
+
+	eraseSector(spare);
+}
+
+static uint16_t writeBlock(uint16_t block, uint8_t flags)
+{
+	while (headPage >= firstPage(activeSector + 1))
+	{
+		openSector((activeSector + 1) % EEPROM_SECTOR_COUNT);
+		makeSpare();
+	}
+
+	return appendRecord(block, EEPROM_PAGE_NONE, flags);
+}
+
+static void applyRecord(uint8_t *cache, uint16_t page)
+{
+	const FlashPROMRecord *record = recordAt(page);
+	memcpy(&cache[record->block * EEPROM_BLOCK_SIZE], record->data, EEPROM_BLOCK_SIZE);
+	blockPages[record->block] = page;
+}
+
+// Replays the records of every sector with a valid header, oldest sector first. A commit's records
+// only count once its last record is found, so a commit cut short by power loss leaves the previous
+// settings as they were. Returns whether any commit was found.
+//
+// Every page is checked rather than picking the newest commit from one header: the blocks a commit
+// didn't change live in older records, relocated copies and an unfinished commit's records can follow
+// it, and the next free page is only known once the torn ones are found. Keeping a pointer to the
+// newest commit would cost a page program of its own on every commit. The scan CRCs at most
+// EEPROM_SECTOR_COUNT * EEPROM_SECTOR_RECORDS records once at boot, about a millisecond at worst.
+static bool loadLog(uint8_t *cache)
+{
+	for (uint16_t block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		blockPages[block] = EEPROM_PAGE_NONE;
+		pendingPages[block] = EEPROM_PAGE_NONE;
+	}
+
+	uint8_t order[EEPROM_SECTOR_COUNT];
+	uint8_t count = 0;
+	for (uint8_t sector = 0; sector < EEPROM_SECTOR_COUNT; sector++)
+	{
+		const FlashPROMSectorHeader *header = reinterpret_cast<const FlashPROMSectorHeader *>(pageAddress(firstPage(sector)));
+		if (!isValid(header))
+			continue;
+
+		uint8_t i = count++;
+		for (; i > 0 && reinterpret_cast<const FlashPROMSectorHeader *>(pageAddress(firstPage(order[i - 1])))->sequence > header->sequence; i--)
+			order[i] = order[i - 1];
+		order[i] = sector;
+
+		if (header->sequence >= sectorSequence)
+			sectorSequence = header->sequence + 1;
+	}
+
+	if (count == 0)
+		return false;
+
+	bool committed = false;
+	bool pending = false;
+	uint32_t pendingGeneration = 0;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t sector = order[i];
+		headPage = firstPage(sector) + 1;
+		for (uint16_t page = headPage; page < firstPage(sector + 1); page++)
+		{
+			// A torn record is skipped, but its page can't be programmed again
+			if (!isErased(page, 1))
+				headPage = page + 1;
+
+			const FlashPROMRecord *record = recordAt(page);
+			if (!isValid(record))
+				continue;
+
+			if (record->generation >= generation)
+				generation = record->generation + 1;
+
+			if (record->flags & EEPROM_RECORD_RELOCATED)
+			{
+				applyRecord(cache, page);
+				committed = true;
+				continue;
+			}
+
+			// A record from another commit means the pending one never finished
+			if (pending && record->generation != pendingGeneration)
+			{
+				for (auto &pendingPage : pendingPages)
+					pendingPage = EEPROM_PAGE_NONE;
+			}
+
+			pending = true;
+			pendingGeneration = record->generation;
+			pendingPages[record->block] = page;
+			if (record->flags & EEPROM_RECORD_COMMIT)
+			{
+				for (auto &pendingPage : pendingPages)
+				{
+					if (pendingPage != EEPROM_PAGE_NONE)
+						applyRecord(cache, pendingPage);
+					pendingPage = EEPROM_PAGE_NONE;
+				}
+
+				pending = false;
+				committed = true;
+			}
+		}
+	}
+
+	for (auto &pendingPage : pendingPages)
+		pendingPage = EEPROM_PAGE_NONE;
+
+	activeSector = order[count - 1];
+	spareReady = false; // Checked on the first commit, in case power was lost while the last spare was made
+	return committed;
+}
+
+// Plans the flash operations that write the changed blocks of the snapshot as one commit, the log's
+// state moves on as if they were done. The previous records stay current until the last of the new
+// ones, marked as the end of the commit, is programmed in full.
+static void planLog(uint32_t blocks)
+{
+	if (headPage == EEPROM_PAGE_NONE)
+	{
+		// Start the log in the first sector, the last one may still hold the settings this boot loaded
+		if (!isErased(firstPage(0), EEPROM_SECTOR_PAGES))
+			eraseSector(0);
+		openSector(0);
+	}
+
+	if (!spareReady)
+		makeSpare();
+
+	// A set() that wrote the same value back leaves nothing to write
+	uint32_t changed = 0;
+	for (uint16_t block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		const uint8_t *data = &snapshot[block * EEPROM_BLOCK_SIZE];
+		if ((blocks & (1u << block)) &&
+			(blockPages[block] == EEPROM_PAGE_NONE || memcmp(recordAt(blockPages[block])->data, data, EEPROM_BLOCK_SIZE) != 0))
+		{
+			changed |= 1u << block;
+		}
+	}
+
+	if (!changed)
+		return;
+
+	for (uint16_t block = 0; changed; block++)
+	{
+		if (!(changed & (1u << block)))
+			continue;
+
+		changed &= ~(1u << block);
+		pendingPages[block] = writeBlock(block, changed ? 0 : EEPROM_RECORD_COMMIT);
+	}
+
+	for (uint16_t block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		if (pendingPages[block] != EEPROM_PAGE_NONE)
+			blockPages[block] = pendingPages[block];
+		pendingPages[block] = EEPROM_PAGE_NONE;
+	}
+
+	generation++;
+}
+
+// Runs one operation of the commit. Only the erase or program itself holds core1 and this core's
+// interrupts, the page is put together before and both cores run between operations. The commit is
+// split up, not lockout free: core1 sits in the SDK's lockout handler for the hold, so the LEDs and
+// player LEDs keep their last frame and their animations stop for the 45ms of an erase.
+//
+// With interrupts off, the USB interrupt and the GPIO edge interrupt wait for the hold to end, so
+// having them in RAM wouldn't let them run any sooner. The USB frames that start meanwhile are counted
+// from the controller's frame number, which keeps counting through the hold.
+static void runOp(const FlashPROMOp &op)
+{
+	if (op.type == EEPROM_OP_HEADER)
+	{
+		memset(&pageBuffer, 0xFF, sizeof(pageBuffer));
+		FlashPROMSectorHeader *header = reinterpret_cast<FlashPROMSectorHeader *>(&pageBuffer);
+		header->magic = EEPROM_SECTOR_MAGIC;
+		header->sequence = op.value;
+		header->sequenceCheck = ~op.value;
+	}
+	else if (op.type == EEPROM_OP_RECORD)
+	{
+		pageBuffer.magic = EEPROM_RECORD_MAGIC;
+		pageBuffer.generation = op.value;
+		pageBuffer.block = op.block;
+		pageBuffer.flags = op.flags;
+		pageBuffer.reserved = 0;
+		if (op.source == EEPROM_PAGE_NONE)
+			memcpy(pageBuffer.data, &snapshot[op.block * EEPROM_BLOCK_SIZE], EEPROM_BLOCK_SIZE);
+		else
+			memcpy(pageBuffer.data, recordAt(op.source)->data, EEPROM_BLOCK_SIZE);
+		pageBuffer.crc = recordCRC(&pageBuffer);
+	}
+
+	uint64_t start = time_us_64();
+	uint32_t frame = usb_hw->sof_rd;
 	multicore_lockout_start_blocking();
-	uint32_t interrupts = spin_lock_blocking(flashLock);
+	uint32_t interrupts = save_and_disable_interrupts();
 
-	flash_range_erase((intptr_t)EEPROM_ADDRESS_START - (intptr_t)XIP_BASE, EEPROM_SIZE_BYTES);
-	flash_range_program((intptr_t)EEPROM_ADDRESS_START - (intptr_t)XIP_BASE, reinterpret_cast<uint8_t *>(flashCache), EEPROM_SIZE_BYTES);
+	if (op.type == EEPROM_OP_ERASE)
+		flash_range_erase(pageOffset(op.page), FLASH_SECTOR_SIZE);
+	else
+		flash_range_program(pageOffset(op.page), reinterpret_cast<const uint8_t *>(&pageBuffer), FLASH_PAGE_SIZE);
 
-	flashWriteAlarm = 0;
+	restore_interrupts(interrupts);
 	multicore_lockout_end_blocking();
+
+	uint32_t holdUs = time_us_64() - start;
+	if (holdUs > commitHoldUs)
+		commitHoldUs = holdUs;
+	FlashPROM::stats.missedFrames += (usb_hw->sof_rd - frame) & USB_SOF_RD_BITS;
+
+	if (op.type == EEPROM_OP_ERASE)
+		FlashPROM::stats.erases++;
+	else if (op.type == EEPROM_OP_RECORD && op.source == EEPROM_PAGE_NONE)
+		FlashPROM::stats.records++;
+	else if (op.type == EEPROM_OP_RECORD)
+		FlashPROM::stats.relocations++;
+}
+
+static bool mayWrite(uint32_t us)
+{
+	if (writeGate == nullptr || writeGate(us))
+		return true;
+
+	commitDeferred = true;
+	if (static_cast<int64_t>(time_us_64() - writeDeadline) < 0)
+		return false;
+
+	commitForced = true;
+	return true;
+}
+
+// Plans a commit on its first call, then runs one of its operations per call, a few hundred
+// microseconds apart so the main loop and USB keep going while it is written
+int64_t writeToFlash(alarm_id_t id, void *flashCache)
+{
+	if (!flashWriting)
+	{
+		// Keep polling until the gate lets the commit start, set() can still add to it until then
+		if (FlashPROM::dirty && !mayWrite(EEPROM_PROGRAM_US))
+			return (id == flashWriteAlarm) ? EEPROM_OP_GAP_US : 0;
+
+		// A commit() that came in as this fired has set up another alarm, that one writes
+		uint32_t interrupts = spin_lock_blocking(flashLock);
+		bool current = id == flashWriteAlarm;
+		flashWriting = current;
+		spin_unlock(flashLock, interrupts);
+		if (!current)
+			return 0;
+
+		opCount = 0;
+		opNext = 0;
+		commitHoldUs = 0;
+		if (FlashPROM::dirty)
+		{
+			// Take the dirty blocks while neither core can be half way through a set()
+			const uint8_t *cache = reinterpret_cast<const uint8_t *>(flashCache);
+			uint32_t interrupts = spin_lock_blocking(flashLock);
+			uint32_t blocks = FlashPROM::dirty;
+			FlashPROM::dirty = 0;
+			for (uint16_t block = 0; block < EEPROM_BLOCK_COUNT; block++)
+			{
+				if (blocks & (1u << block))
+					memcpy(&snapshot[block * EEPROM_BLOCK_SIZE], &cache[block * EEPROM_BLOCK_SIZE], EEPROM_BLOCK_SIZE);
+			}
+			spin_unlock(flashLock, interrupts);
+
+			planLog(blocks);
+		}
+	}
+
+	if (opNext < opCount)
+	{
+		if (!mayWrite(ops[opNext].type == EEPROM_OP_ERASE ? EEPROM_ERASE_US : EEPROM_PROGRAM_US))
+			return EEPROM_OP_GAP_US;
+
+		runOp(ops[opNext++]);
+		if (opNext < opCount)
+			return EEPROM_OP_GAP_US;
+
+		FlashPROM::stats.commits++;
+		FlashPROM::stats.lastStallUs = commitHoldUs;
+		if (commitHoldUs > FlashPROM::stats.maxStallUs)
+			FlashPROM::stats.maxStallUs = commitHoldUs;
+		if (commitDeferred)
+			FlashPROM::stats.deferred++;
+		if (commitForced)
+			FlashPROM::stats.forced++;
+	}
+
+	commitDeferred = false;
+	commitForced = false;
+
+	// Changes made while this commit was written go out with the next one
+	uint32_t interrupts = spin_lock_blocking(flashLock);
+	flashWriting = false;
+	flashWriteAlarm = 0;
+	if (FlashPROM::dirty)
+	{
+		writeDeadline = time_us_64() + EEPROM_WRITE_DEADLINE * 1000ull;
+		flashWriteAlarm = add_alarm_in_ms(EEPROM_WRITE_WAIT, writeToFlash, flashCache, true);
+	}
 	spin_unlock(flashLock, interrupts);
 
 	return 0;
@@ -28,9 +479,19 @@ int64_t writeToFlash(alarm_id_t id, void *flashCache)
 
 void FlashPROM::start()
 {
+	// A firmware image that has grown into the region would be erased as the log wraps onto it
+	if (reinterpret_cast<uintptr_t>(&__flash_binary_end) > EEPROM_REGION_START)
+		panic("The firmware runs into the settings store at 0x%08x, lower EEPROM_SECTOR_COUNT", EEPROM_REGION_START);
+
 	if (flashLock == nullptr)
 		flashLock = spin_lock_instance(spin_lock_claim_unused(true));
 
+	memset(cache, 0, sizeof(cache));
+	dirty = 0;
+	if (loadLog(cache))
+		return;
+
+	// No log yet, carry over the settings from when the store rewrote this one sector in place
 	memcpy(cache, reinterpret_cast<uint8_t *>(EEPROM_ADDRESS_START), EEPROM_SIZE_BYTES);
 
 	// When flash is new/reset, all bits are set to 1.
@@ -46,21 +507,64 @@ void FlashPROM::start()
 	}
 
 	if (reset)
+	{
 		this->reset();
+	}
+	else
+	{
+		dirty = EEPROM_ALL_BLOCKS;
+		commit();
+	}
 }
 
 /* We don't have an actual EEPROM, so we need to be extra careful about minimizing writes. Instead
 	of writing when a commit is requested, we update a time to actually commit. That way, if we receive multiple requests
-	to commit in that timeframe, we'll hold off until the user is done sending changes. */
+	to commit in that timeframe, we'll hold off until the user is done sending changes. The wait never
+	runs past the deadline set by the first change still to be written. */
 void FlashPROM::commit()
 {
-	while (is_spin_locked(flashLock));
-	cancel_alarm(flashWriteAlarm);
-	flashWriteAlarm = add_alarm_in_ms(EEPROM_WRITE_WAIT, writeToFlash, cache, true);
+	uint32_t interrupts = spin_lock_blocking(flashLock);
+	if (!flashWriting)
+	{
+		uint64_t now = time_us_64();
+		if (flashWriteAlarm == 0)
+			writeDeadline = now + EEPROM_WRITE_DEADLINE * 1000ull;
+
+		int64_t delayUs = EEPROM_WRITE_WAIT * 1000;
+		if (now + delayUs > writeDeadline)
+			delayUs = (writeDeadline > now + EEPROM_OP_GAP_US) ? writeDeadline - now : EEPROM_OP_GAP_US;
+
+		cancel_alarm(flashWriteAlarm);
+		flashWriteAlarm = add_alarm_in_us(delayUs, writeToFlash, cache, true);
+	}
+	spin_unlock(flashLock, interrupts);
+}
+
+void FlashPROM::store(uint16_t index, const void *value, uint16_t size)
+{
+	if ((index + size) > EEPROM_SIZE_BYTES)
+		return;
+
+	uint32_t interrupts = spin_lock_blocking(flashLock);
+	memcpy(&cache[index], value, size);
+	for (uint16_t block = index / EEPROM_BLOCK_SIZE; block <= (index + size - 1) / EEPROM_BLOCK_SIZE; block++)
+		dirty |= 1u << block;
+	spin_unlock(flashLock, interrupts);
+}
+
+bool FlashPROM::isWriting()
+{
+	return flashWriting || flashWriteAlarm != 0;
+}
+
+void FlashPROM::setWriteGate(FlashPROMWriteGate gate)
+{
+	writeGate = gate;
 }
 
 void FlashPROM::reset()
 {
-	memset(cache, 0, EEPROM_SIZE_BYTES);
+	memset(cache, 0, sizeof(cache));
+	dirty = EEPROM_ALL_BLOCKS;
 	commit();
 }
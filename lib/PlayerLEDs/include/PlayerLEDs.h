@@ -3,6 +3,7 @@
 
 #include <cstring>
 #include <stdint.h>
+#include "pico/time.h"
 
 #define PLED_COUNT 4
 #define PLED_MAX_BRIGHTNESS 0xFF
@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free ring buffer for exactly one producer and one consumer, which may be an IRQ
+ * handler and the main loop or the two cores. Size must be a power of two.
+ */
+template <typename T, uint32_t Size>
+class RingBuffer
+{
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0, "RingBuffer size must be a power of two");
+
+	public:
+		// Producer only
+		bool push(const T &value)
+		{
+			uint32_t h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) == Size)
+				return false;
+
+			items[h & (Size - 1)] = value;
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only
+		bool pop(T &value)
+		{
+			uint32_t t = tail.load(std::memory_order_relaxed);
+			if (t == head.load(std::memory_order_acquire))
+				return false;
+
+			value = items[t & (Size - 1)];
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only
+		void clear()
+		{
+			tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+		}
+
+		inline bool isEmpty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+		inline uint32_t count() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+		inline uint32_t capacity() const { return Size; }
+
+	private:
+		T items[Size];
+		std::atomic<uint32_t> head { 0 };
+		std::atomic<uint32_t> tail { 0 };
+};
+
+#endif
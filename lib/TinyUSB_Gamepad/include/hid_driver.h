@@ -11,4 +11,9 @@
 
 extern const usbd_class_driver_t hid_driver;
 
-bool send_hid_report(uint8_t report_id, void *report, uint8_t report_size);
+bool send_hid_report_n(uint8_t instance, uint8_t report_id, void *report, uint8_t report_size);
+
+static inline bool send_hid_report(uint8_t report_id, void *report, uint8_t report_size)
+{
+	return send_hid_report_n(0, report_id, report, report_size);
+}
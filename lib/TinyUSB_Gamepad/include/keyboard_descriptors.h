@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "tusb.h"
+
+#define KEYBOARD_KEY_MAX       0x77 // Highest key usage in the bitmap, covers every key on a full size keyboard
+#define KEYBOARD_KEY_BYTES     ((KEYBOARD_KEY_MAX + 1) / 8)
+#define KEYBOARD_MODIFIER_MIN  0xE0 // Left Control, the modifiers go in their own byte
+#define KEYBOARD_MODIFIER_MAX  0xE7 // Right GUI
+#define KEYBOARD_ENDPOINT_SIZE 16
+#define KEYBOARD_EPNUM_IN      0x81
+
+/**
+ * NKRO report, one bit per key so any number of keys can be held at once. Keys on the boot protocol's
+ * six key rollover would drop presses past the sixth, and take a slot search to build.
+ */
+typedef struct __attribute((packed, aligned(1)))
+{
+	uint8_t modifiers;
+	uint8_t keys[KEYBOARD_KEY_BYTES];
+} KeyboardReport;
+
+static_assert(sizeof(KeyboardReport) == KEYBOARD_ENDPOINT_SIZE, "The keyboard report fills one packet");
+
+static const uint8_t keyboard_string_language[]     = { 0x09, 0x04 };
+static const uint8_t keyboard_string_manufacturer[] = "Open Stick Community";
+static const uint8_t keyboard_string_product[]      = "GP2040 (Keyboard)";
+static const uint8_t keyboard_string_version[]      = "1.0";
+
+static const uint8_t keyboard_device_descriptor[] =
+{
+	0x12,       // bLength
+	0x01,       // bDescriptorType (Device)
+	0x00, 0x02, // bcdUSB 2.00
+	0x00,       // bDeviceClass (Use class information in the Interface Descriptors)
+	0x00,       // bDeviceSubClass
+	0x00,       // bDeviceProtocol
+	CFG_TUD_ENDPOINT0_SIZE, // bMaxPacketSize0
+	0xFE, 0xCA, // idVendor 0xCAFE
+	0x04, 0x40, // idProduct 0x4004, a different product than the gamepad modes so hosts don't reuse their descriptors
+	0x00, 0x01, // bcdDevice 1.00
+	0x01,       // iManufacturer (String Index)
+	0x02,       // iProduct (String Index)
+	0x03,       // iSerialNumber (String Index)
+	0x01,       // bNumConfigurations 1
+};
+
+static const uint8_t keyboard_report_descriptor[] =
+{
+	0x05, 0x01,       // Usage Page (Generic Desktop Ctrls)
+	0x09, 0x06,       // Usage (Keyboard)
+	0xA1, 0x01,       // Collection (Application)
+	0x05, 0x07,       //   Usage Page (Kbrd/Keypad)
+	0x19, 0xE0,       //   Usage Minimum (0xE0)
+	0x29, 0xE7,       //   Usage Maximum (0xE7)
+	0x15, 0x00,       //   Logical Minimum (0)
+	0x25, 0x01,       //   Logical Maximum (1)
+	0x75, 0x01,       //   Report Size (1)
+	0x95, 0x08,       //   Report Count (8)
+	0x81, 0x02,       //   Input (Data,Var,Abs)
+	0x19, 0x00,       //   Usage Minimum (0x00)
+	0x29, KEYBOARD_KEY_MAX, // Usage Maximum
+	0x95, KEYBOARD_KEY_MAX + 1, // Report Count, one bit per key
+	0x81, 0x02,       //   Input (Data,Var,Abs)
+	0xC0,             // End Collection
+};
+
+#define KEYBOARD_CONFIG_TOTAL_LEN (9 + 9 + 9 + 7)
+
+static const uint8_t keyboard_configuration_descriptor[] =
+{
+	0x09,       // bLength
+	0x02,       // bDescriptorType (Configuration)
+	KEYBOARD_CONFIG_TOTAL_LEN, 0x00, // wTotalLength
+	0x01,       // bNumInterfaces 1
+	0x01,       // bConfigurationValue
+	0x00,       // iConfiguration (String Index)
+	0xA0,       // bmAttributes Remote Wakeup
+	0xFA,       // bMaxPower 500mA
+
+	0x09,       // bLength
+	0x04,       // bDescriptorType (Interface)
+	0x00,       // bInterfaceNumber 0
+	0x00,       // bAlternateSetting
+	0x01,       // bNumEndpoints 1
+	0x03,       // bInterfaceClass
+	0x00,       // bInterfaceSubClass, no boot protocol, the BIOS can't read an NKRO report
+	0x00,       // bInterfaceProtocol
+	0x00,       // iInterface (String Index)
+
+	0x09,       // bLength
+	0x21,       // bDescriptorType (HID)
+	0x11, 0x01, // bcdHID 1.11
+	0x00,       // bCountryCode
+	0x01,       // bNumDescriptors
+	0x22,       // bDescriptorType[0] (HID)
+	sizeof(keyboard_report_descriptor), 0x00, // wDescriptorLength[0]
+
+	0x07,       // bLength
+	0x05,       // bDescriptorType (Endpoint)
+	KEYBOARD_EPNUM_IN, // bEndpointAddress (IN/D2H)
+	0x03,       // bmAttributes (Interrupt)
+	KEYBOARD_ENDPOINT_SIZE, 0x00, // wMaxPacketSize
+	0x01,       // bInterval 1 (unit depends on device speed), polled every 1ms at full speed
+};
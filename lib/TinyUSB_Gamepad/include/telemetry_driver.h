@@ -0,0 +1,30 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+
+// Vendor interface added after the gamepad interface, found by the host reader from its class codes
+#define TELEMETRY_INTERFACE_SUBCLASS 0x47 // 'G'
+#define TELEMETRY_INTERFACE_PROTOCOL 0x01
+#define TELEMETRY_EPNUM_IN           0x83 // EP1 and EP2 belong to the gamepad interfaces
+#define TELEMETRY_PACKET_SIZE        64
+
+#define TUD_TELEMETRY_DESC_LEN (9 + 7)
+
+// Interface number, endpoint IN address, endpoint size
+#define TUD_TELEMETRY_DESCRIPTOR(_itfnum, _epin, _epsize) \
+	/* Interface */\
+	9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_VENDOR_SPECIFIC, TELEMETRY_INTERFACE_SUBCLASS, TELEMETRY_INTERFACE_PROTOCOL, 0,\
+	/* Endpoint In */\
+	7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+extern const usbd_class_driver_t telemetry_driver;
+
+bool telemetry_ready(void);
+bool send_telemetry_packet(const void *packet, uint16_t size);
@@ -7,14 +7,63 @@
 
 #include "GamepadDescriptors.h"
 
+#define OUTPUT_REPORT_QUEUE_SIZE 8
+#define PLAYER_EPNUM_STRIDE      4 // Each extra player's endpoints are numbered this far past the previous player's
+
+// The gamepad library only knows the gamepad modes, the keyboard mode's reports and descriptors live here.
+// Switch on the mode as a uint8_t to give keyboard mode a case of its own.
+#define INPUT_MODE_KEYBOARD ((InputMode)3)
+
 typedef enum
 {
 	USB_MODE_HID,
 	USB_MODE_NET,
 } UsbMode;
 
+typedef enum
+{
+	OUTPUT_REPORT_LED,    // values[0] is the XInput LED pattern
+	OUTPUT_REPORT_RUMBLE, // values[0] and values[1] are the left and right motor levels
+} OutputReportType;
+
+typedef void (*usb_service_cb_t)(void);
+
+// A command from the host's OUT reports, only published when it changes
+struct OutputReport
+{
+	OutputReportType type;
+	uint8_t values[2];
+};
+
 InputMode get_input_mode(void);
-void initialize_driver(InputMode mode);
-void receive_report(uint8_t *buffer);
-void send_report(void *report, uint16_t report_size);
+bool get_telemetry_enabled(void);
+uint8_t get_player_count(void);
+uint16_t get_usb_frame(void);
+void initialize_driver(InputMode mode, bool telemetry = false, uint8_t players = 1);
+bool build_composite_descriptors(uint8_t players, bool telemetry);
+
+// Switching input modes in play: the device drops off the bus, then comes back as the new one
+bool disconnect_driver(void);
+bool reconnect_driver(InputMode mode);
+
+// TinyUSB is either polled from the loop with usb_task(), or serviced from a low priority IRQ once
+// start_usb_service_irq() succeeds, and calling it again swaps the callback. Calls into TinyUSB from
+// the loop then go between usb_service_lock() and usb_service_unlock().
+bool start_usb_service_irq(usb_service_cb_t callback);
+void usb_task(void);
+void usb_service_lock(void);
+void usb_service_unlock(void);
+
+// Output reports are parsed in the transfer-complete callback on the USB core, then handed to a
+// single consumer on the other core
+void publish_output_report(OutputReport report);
+bool receive_output_report(OutputReport *report);
+
+// Optional, invoked when a changed report is queued on a player's IN endpoint and when the host has collected it
+void report_queued_cb(uint8_t instance);
+void report_complete_cb(uint8_t instance);
+
+// Optional, invoked from tud_task() when the host suspends and resumes the bus
+void usb_suspend_cb(bool remote_wakeup_en);
+void usb_resume_cb(void);
 
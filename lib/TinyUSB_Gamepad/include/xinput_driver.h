@@ -12,6 +12,11 @@
 #include "descriptors/XInputDescriptors.h"
 
 #define XINPUT_OUT_SIZE 32
+#define XINPUT_INTERFACE_SUBCLASS 0x5D
+
+// OUT report types, the first byte of the report
+#define XINPUT_OUT_RUMBLE 0x00 // 00 08 00 <left> <right> 00 00 00
+#define XINPUT_OUT_LED    0x01 // 01 03 <pattern>
 
 typedef enum
 {
@@ -37,7 +42,6 @@ extern uint8_t endpoint_out;
 extern uint8_t xinput_out_buffer[XINPUT_OUT_SIZE];
 extern const usbd_class_driver_t xinput_driver;
 
-void receive_xinput_report(void);
 bool send_xinput_report(void *report, uint8_t report_size);
 
 #pragma once
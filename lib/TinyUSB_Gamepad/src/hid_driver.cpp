@@ -3,6 +3,8 @@
  * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
  */
 
+#include <string.h>
+
 #include "hid_driver.h"
 #include "usb_driver.h"
 
@@ -13,12 +15,59 @@
 // Magic byte sequence to enable PS button on PS3
 static const uint8_t magic_init_bytes[8] = { 0x21, 0x26, 0x01, 0x07, 0x00, 0x00, 0x00, 0x00 };
 
-bool send_hid_report(uint8_t report_id, void *report, uint8_t report_size)
+// IN endpoint of each HID instance, in the order hidd_open() took the interfaces
+static uint8_t hid_endpoint_in[CFG_TUD_HID] = { };
+static uint8_t hid_instance_count = 0;
+
+// Reports without an ID go out of the caller's buffer, which must be left alone until the report completes
+bool send_hid_report_n(uint8_t instance, uint8_t report_id, void *report, uint8_t report_size)
+{
+	if (instance >= CFG_TUD_HID || !tud_hid_n_ready(instance))
+		return false;
+
+	// TinyUSB prefixes the report ID in its own buffer
+	uint8_t endpoint = hid_endpoint_in[instance];
+	if (report_id != 0 || endpoint == 0)
+		return tud_hid_n_report(instance, report_id, report, report_size);
+
+	// The claim fails while the other core or the service IRQ has the endpoint
+	if (!usbd_edpt_claim(0, endpoint))
+		return false;
+
+	bool sent = usbd_edpt_xfer(0, endpoint, (uint8_t *)report, report_size);
+	usbd_edpt_release(0, endpoint);
+
+	return sent;
+}
+
+static void hid_device_reset(uint8_t rhport)
+{
+	memset(hid_endpoint_in, 0, sizeof(hid_endpoint_in));
+	hid_instance_count = 0;
+	hidd_reset(rhport);
+}
+
+// Notes the IN endpoint hidd_open() claimed, so reports can skip the copy into TinyUSB's buffer
+static uint16_t hid_device_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len)
 {
-	if (tud_hid_ready())
-		return tud_hid_report(report_id, report, report_size);
+	uint16_t length = hidd_open(rhport, desc_itf, max_len);
+	if (length == 0 || hid_instance_count >= CFG_TUD_HID)
+		return length;
+
+	uint8_t const *p = (uint8_t const *)desc_itf;
+	uint8_t const *end = p + length;
+	for (p = tu_desc_next(p); p < end; p = tu_desc_next(p))
+	{
+		if (tu_desc_type(p) != TUSB_DESC_ENDPOINT)
+			continue;
 
-	return false;
+		tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *)p;
+		if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN)
+			hid_endpoint_in[hid_instance_count] = desc_ep->bEndpointAddress;
+	}
+
+	hid_instance_count++;
+	return length;
 }
 
 bool hid_device_control_request(uint8_t rhport, tusb_control_request_t const * request)
@@ -38,15 +87,29 @@ bool hid_device_control_request(uint8_t rhport, tusb_control_request_t const * r
 	}
 }
 
+bool hid_device_xfer_callback(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+	if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN)
+	{
+		for (uint8_t instance = 0; instance < hid_instance_count; instance++)
+		{
+			if (hid_endpoint_in[instance] == ep_addr)
+				report_complete_cb(instance);
+		}
+	}
+
+	return hidd_xfer_cb(rhport, ep_addr, result, xferred_bytes);
+}
+
 const usbd_class_driver_t hid_driver = {
 #if CFG_TUSB_DEBUG >= 2
 	.name = "HID",
 #endif
 	.init = hidd_init,
-	.reset = hidd_reset,
-	.open = hidd_open,
+	.reset = hid_device_reset,
+	.open = hid_device_open,
 	.control_request = hid_device_control_request,
 	.control_complete = hidd_control_complete,
-	.xfer_cb = hidd_xfer_cb,
+	.xfer_cb = hid_device_xfer_callback,
 	.sof = NULL
 };
@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include "telemetry_driver.h"
+#include "usb_driver.h"
+
+static uint8_t telemetry_endpoint_in = 0;
+static uint8_t telemetry_buffer[TELEMETRY_PACKET_SIZE];
+
+// True when the bulk IN endpoint can take another packet
+bool telemetry_ready(void)
+{
+	return tud_ready() && (telemetry_endpoint_in != 0) && !usbd_edpt_busy(0, telemetry_endpoint_in);
+}
+
+// Copies the packet, so the caller can reuse its buffer straight away
+bool send_telemetry_packet(const void *packet, uint16_t size)
+{
+	if (size > TELEMETRY_PACKET_SIZE)
+		return false;
+
+	bool sent = false;
+	usb_service_lock();
+	if (telemetry_ready() && usbd_edpt_claim(0, telemetry_endpoint_in))
+	{
+		memcpy(telemetry_buffer, packet, size);
+		sent = usbd_edpt_xfer(0, telemetry_endpoint_in, telemetry_buffer, size);
+		usbd_edpt_release(0, telemetry_endpoint_in);
+	}
+	usb_service_unlock();
+
+	return sent;
+}
+
+static void telemetry_init(void)
+{
+	telemetry_endpoint_in = 0;
+}
+
+static void telemetry_reset(uint8_t rhport)
+{
+	(void)rhport;
+	telemetry_endpoint_in = 0;
+}
+
+static uint16_t telemetry_open(uint8_t rhport, tusb_desc_interface_t const *itf_descriptor, uint16_t max_length)
+{
+	TU_VERIFY(
+		itf_descriptor->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC &&
+		itf_descriptor->bInterfaceSubClass == TELEMETRY_INTERFACE_SUBCLASS &&
+		itf_descriptor->bInterfaceProtocol == TELEMETRY_INTERFACE_PROTOCOL,
+		0
+	);
+
+	uint16_t driver_length = TUD_TELEMETRY_DESC_LEN;
+	TU_VERIFY(max_length >= driver_length, 0);
+
+	tusb_desc_endpoint_t const *endpoint_descriptor = (tusb_desc_endpoint_t const *)tu_desc_next(itf_descriptor);
+	TU_ASSERT(TUSB_DESC_ENDPOINT == tu_desc_type(endpoint_descriptor), 0);
+	TU_ASSERT(usbd_edpt_open(rhport, endpoint_descriptor), 0);
+	telemetry_endpoint_in = endpoint_descriptor->bEndpointAddress;
+
+	return driver_length;
+}
+
+static bool telemetry_control_request(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+
+	return false;
+}
+
+static bool telemetry_control_complete(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+
+	return true;
+}
+
+static bool telemetry_xfer_callback(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+	(void)rhport;
+	(void)ep_addr;
+	(void)result;
+	(void)xferred_bytes;
+
+	return true;
+}
+
+const usbd_class_driver_t telemetry_driver =
+{
+#if CFG_TUSB_DEBUG >= 2
+	.name = "TELEMETRY",
+#endif
+	.init = telemetry_init,
+	.reset = telemetry_reset,
+	.open = telemetry_open,
+	.control_request = telemetry_control_request,
+	.control_complete = telemetry_control_complete,
+	.xfer_cb = telemetry_xfer_callback,
+	.sof = NULL
+};
@@ -5,70 +5,252 @@
 
 #include <stdint.h>
 
+#include "hardware/irq.h"
+#include "hardware/structs/usb.h"
 #include "tusb_config.h"
 #include "tusb.h"
 #include "class/hid/hid.h"
 #include "device/usbd_pvt.h"
 
 #include "GamepadDescriptors.h"
+#include "RingBuffer.h"
 
 #include "usb_driver.h"
 #include "net_driver.h"
 #include "hid_driver.h"
+#include "keyboard_descriptors.h"
 #include "xinput_driver.h"
+#include "telemetry_driver.h"
 
 UsbMode usb_mode = USB_MODE_HID;
 InputMode input_mode = INPUT_MODE_XINPUT;
+bool telemetry_enabled = false;
+uint8_t player_count = 1;
+
+// As asked for by initialize_driver(), kept for reconnect_driver()
+static bool telemetry_requested = false;
+static uint8_t players_requested = 1;
+
+// TinyUSB fetches the app driver list once in tusb_init(), so a mode change swaps the drivers in place
+static usbd_class_driver_t app_drivers[2];
+static uint8_t app_driver_count = 0;
+
+static RingBuffer<OutputReport, OUTPUT_REPORT_QUEUE_SIZE> output_reports;
+
+static int service_irq = -1;
+static usb_service_cb_t service_cb = nullptr;
+static volatile bool service_locked = false;
+static volatile bool service_deferred = false;
 
 InputMode get_input_mode(void)
 {
 	return input_mode;
 }
 
-void initialize_driver(InputMode mode)
+bool get_telemetry_enabled(void)
+{
+	return telemetry_enabled;
+}
+
+uint8_t get_player_count(void)
+{
+	return player_count;
+}
+
+// The frame number of the last SOF seen by the USB controller, changes once per millisecond while connected
+uint16_t get_usb_frame(void)
+{
+	return usb_hw->sof_rd & USB_SOF_RD_BITS;
+}
+
+/**
+ * With telemetry or more than one player, the gamepad interface is joined by a vendor interface and by
+ * an HID interface per extra player in a composite device. Only HID mode takes either: the XInput driver
+ * on Windows binds the whole device by its IDs, the Switch expects a single controller, and keyboard
+ * mode is meant for hosts that only want a plain keyboard.
+ */
+static void load_app_drivers(void)
+{
+	switch (input_mode)
+	{
+		case INPUT_MODE_XINPUT:
+			app_drivers[0] = xinput_driver;
+			break;
+
+		default:
+			app_drivers[0] = hid_driver;
+			break;
+	}
+
+	app_driver_count = 1;
+	if (telemetry_enabled)
+		app_drivers[app_driver_count++] = telemetry_driver;
+}
+
+static void configure_driver(InputMode mode)
 {
 	input_mode = mode;
 	if (mode == INPUT_MODE_CONFIG)
 		usb_mode = USB_MODE_NET;
 
+	player_count = (mode == INPUT_MODE_HID) ? tu_min8(players_requested, CFG_TUD_HID) : 1;
+	bool telemetry = telemetry_requested && mode == INPUT_MODE_HID;
+	if ((telemetry || player_count > 1) && !build_composite_descriptors(player_count, telemetry))
+	{
+		telemetry = false;
+		player_count = 1;
+	}
+
+	telemetry_enabled = telemetry;
+	load_app_drivers();
+}
+
+void initialize_driver(InputMode mode, bool telemetry, uint8_t players)
+{
+	telemetry_requested = telemetry;
+	players_requested = players;
+	configure_driver(mode);
+
 	tusb_init();
 }
 
-void receive_report(uint8_t *buffer)
+/**
+ * @brief Drop off the bus to change input modes, call reconnect_driver() once the host has seen the device go.
+ *
+ * The class drivers are reset straight away, so nothing is queued on the old endpoints before the host
+ * resets the bus. The web configurator's network driver can't be swapped, so this only works in play.
+ */
+bool disconnect_driver(void)
+{
+	if (usb_mode != USB_MODE_HID)
+		return false;
+
+	tud_disconnect();
+
+	for (uint8_t i = 0; i < app_driver_count; i++)
+		app_drivers[i].reset(0);
+
+	return true;
+}
+
+// Comes back with the descriptors and class driver of the new input mode, the host enumerates it as a new device
+bool reconnect_driver(InputMode mode)
+{
+	if (usb_mode != USB_MODE_HID || mode == INPUT_MODE_CONFIG)
+		return false;
+
+	configure_driver(mode);
+
+	for (uint8_t i = 0; i < app_driver_count; i++)
+		app_drivers[i].init();
+
+	return tud_connect();
+}
+
+// Runs at the lowest priority, after TinyUSB's USB IRQ handler has queued its events
+static void __not_in_flash_func(usb_service_irq_handler)(void)
 {
-	if (input_mode == INPUT_MODE_XINPUT)
+	if (service_locked)
 	{
-		receive_xinput_report();
-		memcpy(buffer, xinput_out_buffer, XINPUT_OUT_SIZE);
+		service_deferred = true;
+		return;
 	}
+
+	tud_task();
+
+	if (service_cb)
+		service_cb();
 }
 
-void send_report(void *report, uint16_t report_size)
+static void __not_in_flash_func(usb_irq_handler)(void)
 {
-	static uint8_t previous_report[CFG_TUD_ENDPOINT0_SIZE] = { };
+	irq_set_pending(service_irq);
+}
 
-	if (tud_suspended())
-		tud_remote_wakeup();
+/**
+ * @brief Service TinyUSB from a low priority IRQ raised by every USB interrupt instead of polling it from the loop.
+ *
+ * Same scheme as the SDK's stdio_usb: TinyUSB's own handler stays on USBCTRL_IRQ and only queues events,
+ * and the shared handler added after it pends a user IRQ that runs tud_task(). The callback runs after
+ * every service, so work waiting on an endpoint can go out the moment it frees up. The web configurator's
+ * network stack is not interrupt safe, so config mode keeps polling.
+ */
+bool start_usb_service_irq(usb_service_cb_t callback)
+{
+	if (usb_mode != USB_MODE_HID)
+		return false;
+
+	// Already running, only the callback changes, as after an input mode switch
+	service_cb = callback;
+	if (service_irq >= 0)
+		return true;
+
+	service_irq = user_irq_claim_unused(true);
+	irq_set_exclusive_handler(service_irq, usb_service_irq_handler);
+	irq_set_priority(service_irq, PICO_LOWEST_IRQ_PRIORITY);
+	irq_set_enabled(service_irq, true);
+	irq_add_shared_handler(USBCTRL_IRQ, usb_irq_handler, PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+
+	// Catch up on anything queued since tusb_init()
+	irq_set_pending(service_irq);
+
+	return true;
+}
+
+void usb_task(void)
+{
+	if (service_irq < 0)
+		tud_task();
+}
+
+// The service IRQ can't be masked without losing its pending bit, so it backs off while locked and is pended again here
+void usb_service_lock(void)
+{
+	service_locked = true;
+}
 
-	if (memcmp(previous_report, report, report_size) != 0)
+void usb_service_unlock(void)
+{
+	service_locked = false;
+	if (service_deferred)
 	{
-		bool sent = false;
-		switch (input_mode)
-		{
-			case INPUT_MODE_XINPUT:
-				sent = send_xinput_report(report, report_size);
-				break;
-
-			default:
-				sent = send_hid_report(0, report, report_size);
-				break;
-		}
-
-		if (sent)
-			memcpy(previous_report, report, report_size);
+		service_deferred = false;
+		irq_set_pending(service_irq);
 	}
 }
 
+// A full ring drops the new command, the consumer is far behind if 8 distinct commands are waiting
+void publish_output_report(OutputReport report)
+{
+	output_reports.push(report);
+}
+
+bool receive_output_report(OutputReport *report)
+{
+	return output_reports.pop(*report);
+}
+
+/* Report Callbacks (Optional) */
+
+TU_ATTR_WEAK void report_queued_cb(uint8_t instance)
+{
+	(void)instance;
+}
+
+TU_ATTR_WEAK void report_complete_cb(uint8_t instance)
+{
+	(void)instance;
+}
+
+TU_ATTR_WEAK void usb_suspend_cb(bool remote_wakeup_en)
+{
+	(void)remote_wakeup_en;
+}
+
+TU_ATTR_WEAK void usb_resume_cb(void)
+{
+}
+
 /* USB Driver Callback (Required for XInput) */
 
 const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count)
@@ -76,20 +258,10 @@ const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count)
 	*driver_count = 1;
 
 	if (usb_mode == USB_MODE_NET)
-	{
 		return &net_driver;
-	}
-	else
-	{
-		switch (input_mode)
-		{
-			case INPUT_MODE_XINPUT:
-				return &xinput_driver;
-
-			default:
-				return &hid_driver;
-		}
-	}
+
+	*driver_count = app_driver_count;
+	return app_drivers;
 }
 
 /* USB HID Callbacks (Required) */
@@ -108,8 +280,15 @@ uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t
 	uint8_t report_size = 0;
 	SwitchReport switch_report;
 	HIDReport hid_report;
-	switch (input_mode)
+	KeyboardReport keyboard_report = { };
+
+	switch (static_cast<uint8_t>(input_mode))
 	{
+		case INPUT_MODE_KEYBOARD:
+			report_size = sizeof(KeyboardReport);
+			memcpy(buffer, &keyboard_report, report_size);
+			break;
+
 		case INPUT_MODE_SWITCH:
 			report_size = sizeof(SwitchReport);
 			memcpy(buffer, &switch_report, report_size);
@@ -128,10 +307,17 @@ uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t
 // received data on OUT endpoint ( Report ID = 0, Type = 0 )
 void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
 {
-	(void) itf;
+	switch (static_cast<uint8_t>(input_mode))
+	{
+		case INPUT_MODE_KEYBOARD:
+			// The keyboard has no output report, and an echo would go out as a key press
+			break;
 
-	// echo back anything we received from host
-	tud_hid_report(report_id, buffer, bufsize);
+		default:
+			// echo back anything we received from host
+			tud_hid_n_report(itf, report_id, buffer, bufsize);
+			break;
+	}
 }
 
 
@@ -152,10 +338,11 @@ void tud_umount_cb(void)
 // Within 7ms, device must draw an average of current less than 2.5 mA from bus
 void tud_suspend_cb(bool remote_wakeup_en)
 {
-	(void)remote_wakeup_en;
+	usb_suspend_cb(remote_wakeup_en);
 }
 
 // Invoked when usb bus is resumed
 void tud_resume_cb(void)
 {
+	usb_resume_cb();
 }
@@ -4,57 +4,191 @@
  * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
  */
 
+#include <string.h>
 #include <wchar.h>
 #include "tusb.h"
 #include "usb_driver.h"
+#include "telemetry_driver.h"
 #include "GamepadDescriptors.h"
+#include "keyboard_descriptors.h"
 #include "webserver_descriptors.h"
 
-// Invoked when received GET STRING DESCRIPTOR request
-// Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
-uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+#define COMPOSITE_CONFIG_MAX_LEN 128
+
+static uint8_t composite_device_descriptor[sizeof(tusb_desc_device_t)];
+static uint8_t composite_configuration_descriptor[COMPOSITE_CONFIG_MAX_LEN];
+
+static uint8_t const *gamepad_device_descriptor(void)
 {
-	(void)langid;
+	switch (static_cast<uint8_t>(get_input_mode()))
+	{
+		case INPUT_MODE_KEYBOARD:
+			return keyboard_device_descriptor;
 
-	if (get_input_mode() == INPUT_MODE_CONFIG)
+		case INPUT_MODE_XINPUT:
+			return xinput_device_descriptor;
+
+		case INPUT_MODE_SWITCH:
+			return switch_device_descriptor;
+
+		default:
+			return hid_device_descriptor;
+	}
+}
+
+static uint8_t const *gamepad_configuration_descriptor(void)
+{
+	switch (static_cast<uint8_t>(get_input_mode()))
+	{
+		case INPUT_MODE_KEYBOARD:
+			return keyboard_configuration_descriptor;
+
+		case INPUT_MODE_XINPUT:
+			return xinput_configuration_descriptor;
+
+		case INPUT_MODE_SWITCH:
+			return switch_configuration_descriptor;
+
+		default:
+			return hid_configuration_descriptor;
+	}
+}
+
+/**
+ * @brief Append the extra players' interfaces and the telemetry interface to the gamepad configuration,
+ * returns false if they won't fit.
+ *
+ * The gamepad keeps interface 0 and its endpoints, so host drivers still bind to it by its class
+ * codes. Each extra player gets a copy of the gamepad interfaces, renumbered past the previous
+ * player's and with its endpoints PLAYER_EPNUM_STRIDE further on. The device class is cleared so the
+ * host treats the device as a composite one.
+ */
+bool build_composite_descriptors(uint8_t players, bool telemetry)
+{
+	memcpy(composite_device_descriptor, gamepad_device_descriptor(), sizeof(tusb_desc_device_t));
+	tusb_desc_device_t *device = (tusb_desc_device_t *)composite_device_descriptor;
+	device->bDeviceClass = 0;
+	device->bDeviceSubClass = 0;
+	device->bDeviceProtocol = 0;
+
+	uint8_t const *gamepad = gamepad_configuration_descriptor();
+	uint16_t gamepad_length = ((tusb_desc_configuration_t const *)gamepad)->wTotalLength;
+	uint8_t gamepad_interfaces = ((tusb_desc_configuration_t const *)gamepad)->bNumInterfaces;
+	uint16_t player_length = gamepad_length - TUD_CONFIG_DESC_LEN;
+	uint8_t interface_count = gamepad_interfaces * players;
+	uint8_t const telemetry_descriptor[] = { TUD_TELEMETRY_DESCRIPTOR(interface_count, TELEMETRY_EPNUM_IN, TELEMETRY_PACKET_SIZE) };
+	uint16_t length = gamepad_length + player_length * (players - 1) + (telemetry ? sizeof(telemetry_descriptor) : 0);
+
+	if (length > sizeof(composite_configuration_descriptor))
+		return false;
+
+	memcpy(composite_configuration_descriptor, gamepad, gamepad_length);
+	uint8_t *p = composite_configuration_descriptor + gamepad_length;
+	for (uint8_t player = 1; player < players; player++)
+	{
+		memcpy(p, gamepad + TUD_CONFIG_DESC_LEN, player_length);
+		for (uint8_t *end = p + player_length; p < end; p = (uint8_t *)tu_desc_next(p))
+		{
+			if (tu_desc_type(p) == TUSB_DESC_INTERFACE)
+				((tusb_desc_interface_t *)p)->bInterfaceNumber += gamepad_interfaces * player;
+			else if (tu_desc_type(p) == TUSB_DESC_ENDPOINT)
+				((tusb_desc_endpoint_t *)p)->bEndpointAddress += PLAYER_EPNUM_STRIDE * player;
+		}
+	}
+
+	if (telemetry)
+		memcpy(p, telemetry_descriptor, sizeof(telemetry_descriptor));
+
+	tusb_desc_configuration_t *config = (tusb_desc_configuration_t *)composite_configuration_descriptor;
+	config->wTotalLength = length;
+	config->bNumInterfaces = interface_count + (telemetry ? 1 : 0);
+	return true;
+}
+
+static const uint8_t *keyboard_string_descriptors[] =
+{
+	keyboard_string_language,
+	keyboard_string_manufacturer,
+	keyboard_string_product,
+	keyboard_string_version
+};
+
+// The gamepad library has no strings for the keyboard, so they are converted to UTF-16 here
+static uint16_t const *keyboard_string_descriptor(uint8_t index)
+{
+	static uint16_t descriptor[32];
+
+	uint8_t length;
+	if (index == 0)
 	{
-		return reinterpret_cast<uint16_t const *>(webserver_string_descriptors[index]);
+		memcpy(&descriptor[1], keyboard_string_language, sizeof(keyboard_string_language));
+		length = 1;
 	}
 	else
 	{
-		uint16_t size = 0;
-		return getStringDescriptor(&size, get_input_mode(), index);
+		if (index >= sizeof(keyboard_string_descriptors) / sizeof(keyboard_string_descriptors[0]))
+			return nullptr;
+
+		const char *str = reinterpret_cast<const char *>(keyboard_string_descriptors[index]);
+		for (length = 0; str[length] && length < 31; length++)
+			descriptor[1 + length] = str[length];
 	}
+
+	// First byte is the length in bytes, including this header, second is the string descriptor type
+	descriptor[0] = (TUSB_DESC_STRING << 8) | (2 * length + 2);
+	return descriptor;
 }
 
-// Invoked when received GET DEVICE DESCRIPTOR
-// Application return pointer to descriptor
-uint8_t const *tud_descriptor_device_cb(void)
+static bool composite_enabled(void)
 {
-	switch (get_input_mode())
+	return get_telemetry_enabled() || get_player_count() > 1;
+}
+
+// Invoked when received GET STRING DESCRIPTOR request
+// Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
+uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+	(void)langid;
+
+	switch (static_cast<uint8_t>(get_input_mode()))
 	{
 		case INPUT_MODE_CONFIG:
-			return reinterpret_cast<uint8_t const *>(&webserver_device_descriptor);
+			return reinterpret_cast<uint16_t const *>(webserver_string_descriptors[index]);
 
-		case INPUT_MODE_XINPUT:
-			return xinput_device_descriptor;
-
-		case INPUT_MODE_SWITCH:
-			return switch_device_descriptor;
+		case INPUT_MODE_KEYBOARD:
+			return keyboard_string_descriptor(index);
 
 		default:
-			return hid_device_descriptor;
+		{
+			uint16_t size = 0;
+			return getStringDescriptor(&size, get_input_mode(), index);
+		}
 	}
 }
 
+// Invoked when received GET DEVICE DESCRIPTOR
+// Application return pointer to descriptor
+uint8_t const *tud_descriptor_device_cb(void)
+{
+	if (get_input_mode() == INPUT_MODE_CONFIG)
+		return reinterpret_cast<uint8_t const *>(&webserver_device_descriptor);
+	else if (composite_enabled())
+		return composite_device_descriptor;
+	else
+		return gamepad_device_descriptor();
+}
+
 // Invoked when received GET HID REPORT DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t itf)
 {
 	(void) itf;
-	switch (get_input_mode())
+	switch (static_cast<uint8_t>(get_input_mode()))
 	{
+		case INPUT_MODE_KEYBOARD:
+			return keyboard_report_descriptor;
+
 		case INPUT_MODE_SWITCH:
 			return switch_report_descriptor;
 
@@ -68,18 +202,10 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t itf)
 // Descriptor contents must exist long enough for transfer to complete
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 {
-	switch (get_input_mode())
-	{
-		case INPUT_MODE_CONFIG:
-			return net_configuration_arr[index];
-
-		case INPUT_MODE_XINPUT:
-			return xinput_configuration_descriptor;
-
-		case INPUT_MODE_SWITCH:
-			return switch_configuration_descriptor;
-
-		default:
-			return hid_configuration_descriptor;
-	}
+	if (get_input_mode() == INPUT_MODE_CONFIG)
+		return net_configuration_arr[index];
+	else if (composite_enabled())
+		return composite_configuration_descriptor;
+	else
+		return gamepad_configuration_descriptor();
 }
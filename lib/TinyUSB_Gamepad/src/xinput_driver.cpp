@@ -4,21 +4,34 @@
  */
 
 #include "xinput_driver.h"
+#include "usb_driver.h"
 
 uint8_t endpoint_in = 0;
 uint8_t endpoint_out = 0;
 uint8_t xinput_out_buffer[XINPUT_OUT_SIZE] = { };
 
-void receive_xinput_report(void)
+// The last commands published, so repeats from the host are dropped here
+static OutputReport last_led;
+static OutputReport last_rumble;
+static bool has_led = false;
+static bool has_rumble = false;
+
+static void publish_if_changed(OutputReport &last, bool &has_last, OutputReport report)
 {
-	if (
-		tud_ready() &&
-		(endpoint_out != 0) && (!usbd_edpt_busy(0, endpoint_out))
-	) {
-		usbd_edpt_claim(0, endpoint_out);                                    // Take control of OUT endpoint
-		usbd_edpt_xfer(0, endpoint_out, xinput_out_buffer, XINPUT_OUT_SIZE); // Retrieve report buffer
-		usbd_edpt_release(0, endpoint_out);                                  // Release control of OUT endpoint
-	}
+	if (has_last && last.values[0] == report.values[0] && last.values[1] == report.values[1])
+		return;
+
+	last = report;
+	has_last = true;
+	publish_output_report(report);
+}
+
+static void parse_xinput_out(uint32_t length)
+{
+	if (length >= 3 && xinput_out_buffer[0] == XINPUT_OUT_LED)
+		publish_if_changed(last_led, has_led, { OUTPUT_REPORT_LED, { xinput_out_buffer[2], 0 } });
+	else if (length >= 5 && xinput_out_buffer[0] == XINPUT_OUT_RUMBLE)
+		publish_if_changed(last_rumble, has_rumble, { OUTPUT_REPORT_RUMBLE, { xinput_out_buffer[3], xinput_out_buffer[4] } });
 }
 
 bool send_xinput_report(void *report, uint8_t report_size)
@@ -27,12 +40,11 @@ bool send_xinput_report(void *report, uint8_t report_size)
 
 	if (
 		tud_ready() &&                                          // Is the device ready?
-		(endpoint_in != 0) && (!usbd_edpt_busy(0, endpoint_in)) // Is the IN endpoint available?
+		(endpoint_in != 0) && (!usbd_edpt_busy(0, endpoint_in)) && // Is the IN endpoint available?
+		usbd_edpt_claim(0, endpoint_in)                         // Take control of IN endpoint
 	) {
-		usbd_edpt_claim(0, endpoint_in);                        // Take control of IN endpoint
-		usbd_edpt_xfer(0, endpoint_in, (uint8_t *)report, report_size);    // Send report buffer
+		sent = usbd_edpt_xfer(0, endpoint_in, (uint8_t *)report, report_size); // Send report buffer
 		usbd_edpt_release(0, endpoint_in);                      // Release control of IN endpoint
-		sent = true;
 	}
 
 	return sent;
@@ -46,12 +58,18 @@ static void xinput_init(void)
 static void xinput_reset(uint8_t rhport)
 {
 	(void)rhport;
+	endpoint_in = 0;
+	endpoint_out = 0;
+	has_led = false;
+	has_rumble = false;
 }
 
 static uint16_t xinput_open(uint8_t rhport, tusb_desc_interface_t const *itf_descriptor, uint16_t max_length)
 {
 	uint16_t driver_length = sizeof(tusb_desc_interface_t) + (itf_descriptor->bNumEndpoints * sizeof(tusb_desc_endpoint_t)) + 16;
 
+	// Leave any other vendor interface, like the telemetry one, to its own driver
+	TU_VERIFY(itf_descriptor->bInterfaceSubClass == XINPUT_INTERFACE_SUBCLASS, 0);
 	TU_VERIFY(max_length >= driver_length, 0);
 
 	uint8_t const *current_descriptor = tu_desc_next(itf_descriptor);
@@ -73,6 +91,11 @@ static uint16_t xinput_open(uint8_t rhport, tusb_desc_interface_t const *itf_des
 
 		current_descriptor = tu_desc_next(current_descriptor);
 	}
+
+	// Keep the OUT endpoint armed from here on, the transfer callback re-arms it after every report
+	if (endpoint_out != 0)
+		usbd_edpt_xfer(rhport, endpoint_out, xinput_out_buffer, XINPUT_OUT_SIZE);
+
 	return driver_length;
 }
 
@@ -94,12 +117,15 @@ static bool xinput_control_complete(uint8_t rhport, tusb_control_request_t const
 
 static bool xinput_xfer_callback(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-	(void)rhport;
-	(void)result;
-	(void)xferred_bytes;
-
 	if (ep_addr == endpoint_out)
-		usbd_edpt_xfer(0, endpoint_out, xinput_out_buffer, XINPUT_OUT_SIZE);
+	{
+		if (result == XFER_RESULT_SUCCESS)
+			parse_xinput_out(xferred_bytes);
+
+		usbd_edpt_xfer(rhport, endpoint_out, xinput_out_buffer, XINPUT_OUT_SIZE);
+	}
+	else if (ep_addr == endpoint_in)
+		report_complete_cb(0);
 
 	return true;
 }
@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_CLASS_HID_H_
+#define SIM_CLASS_HID_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	HID_REPORT_TYPE_INVALID = 0,
+	HID_REPORT_TYPE_INPUT,
+	HID_REPORT_TYPE_OUTPUT,
+	HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+typedef enum
+{
+	HID_REQ_CONTROL_GET_REPORT   = 0x01,
+	HID_REQ_CONTROL_GET_IDLE     = 0x02,
+	HID_REQ_CONTROL_GET_PROTOCOL = 0x03,
+	HID_REQ_CONTROL_SET_REPORT   = 0x09,
+	HID_REQ_CONTROL_SET_IDLE     = 0x0a,
+	HID_REQ_CONTROL_SET_PROTOCOL = 0x0b,
+} hid_request_enum_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_CLASS_HID_DEVICE_H_
+#define SIM_CLASS_HID_DEVICE_H_
+
+#include "tusb.h"
+#include "class/hid/hid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool tud_hid_n_ready(uint8_t instance);
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint8_t len);
+static inline bool tud_hid_ready(void) { return tud_hid_n_ready(0); }
+static inline bool tud_hid_report(uint8_t report_id, void const *report, uint8_t len) { return tud_hid_n_report(0, report_id, report, len); }
+
+// Application callbacks
+uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance);
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen);
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize);
+
+// Class driver
+void hidd_init(void);
+void hidd_reset(uint8_t rhport);
+uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len);
+bool hidd_control_request(uint8_t rhport, tusb_control_request_t const *request);
+bool hidd_control_complete(uint8_t rhport, tusb_control_request_t const *request);
+bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
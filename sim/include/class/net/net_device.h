@@ -0,0 +1,27 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_CLASS_NET_DEVICE_H_
+#define SIM_CLASS_NET_DEVICE_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Class driver, never opened by the simulator
+void netd_init(void);
+void netd_reset(uint8_t rhport);
+uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool netd_control_request(uint8_t rhport, tusb_control_request_t const *request);
+bool netd_control_complete(uint8_t rhport, tusb_control_request_t const *request);
+bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
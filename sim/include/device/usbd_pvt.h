@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_DEVICE_USBD_PVT_H_
+#define SIM_DEVICE_USBD_PVT_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+#if CFG_TUSB_DEBUG >= 2
+	char const *name;
+#endif
+	void (*init)(void);
+	void (*reset)(uint8_t rhport);
+	uint16_t (*open)(uint8_t rhport, tusb_desc_interface_t const *desc_intf, uint16_t max_len);
+	bool (*control_request)(uint8_t rhport, tusb_control_request_t const *request);
+	bool (*control_complete)(uint8_t rhport, tusb_control_request_t const *request);
+	bool (*xfer_cb)(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+	void (*sof)(uint8_t rhport);
+} usbd_class_driver_t;
+
+usbd_class_driver_t const *usbd_app_driver_get_cb(uint8_t *driver_count);
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_ep);
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes);
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr);
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr);
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr);
+void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr);
+bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_ADC_H_
+#define SIM_HARDWARE_ADC_H_
+
+#include "pico.h"
+
+#endif
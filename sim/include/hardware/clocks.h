@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_CLOCKS_H_
+#define SIM_HARDWARE_CLOCKS_H_
+
+#include "pico.h"
+#include "hardware/structs/clocks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MHZ      _u(1000000)
+#define XOSC_MHZ 12
+
+enum clock_index
+{
+	clk_gpout0 = 0,
+	clk_gpout1,
+	clk_gpout2,
+	clk_gpout3,
+	clk_ref,
+	clk_sys,
+	clk_peri,
+	clk_usb,
+	clk_adc,
+	clk_rtc,
+	CLK_COUNT
+};
+
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF             0x0
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX  0x1
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS   0x0
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB   0x1
+
+uint32_t clock_get_hz(enum clock_index clk_index);
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_DMA_H_
+#define SIM_HARDWARE_DMA_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NUM_DMA_CHANNELS 12
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS            0x00000001u
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB      2
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS     0x00000010u
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS    0x00000020u
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB      6
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS      0x00000400u
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB       11
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB       15
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS     0x00200000u
+#define DMA_CH0_CTRL_TRIG_BSWAP_BITS         0x00400000u
+#define DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS      0x00800000u
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS          0x01000000u
+
+#define DREQ_FORCE 0x3f
+
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC32R 0x1
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+// Registers are pointer sized on the host so host addresses survive the round trip
+typedef struct
+{
+	volatile uintptr_t read_addr;
+	volatile uintptr_t write_addr;
+	volatile uintptr_t transfer_count;
+	volatile uintptr_t ctrl_trig;
+	volatile uintptr_t al1_ctrl;
+	volatile uintptr_t al1_read_addr;
+	volatile uintptr_t al1_write_addr;
+	volatile uintptr_t al1_transfer_count_trig;
+} dma_channel_hw_t;
+
+typedef struct
+{
+	dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+	volatile uintptr_t sniff_ctrl;
+	volatile uintptr_t sniff_data;
+} dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+typedef struct
+{
+	uint32_t ctrl;
+} dma_channel_config;
+
+static inline dma_channel_hw_t *dma_channel_hw_addr(uint channel) { return &dma_hw->ch[channel]; }
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel)
+{
+	dma_channel_config c = {
+		DMA_CH0_CTRL_TRIG_EN_BITS | DMA_CH0_CTRL_TRIG_INCR_READ_BITS | (DMA_SIZE_32 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB) |
+		(channel << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB) | ((uint32_t)DREQ_FORCE << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB)
+	};
+	return c;
+}
+
+static inline void channel_config_set_bits(dma_channel_config *c, uint32_t bits, bool set) { c->ctrl = set ? (c->ctrl | bits) : (c->ctrl & ~bits); }
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_INCR_READ_BITS, incr); }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS, incr); }
+static inline void channel_config_set_irq_quiet(dma_channel_config *c, bool quiet) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS, quiet); }
+static inline void channel_config_set_sniff_enable(dma_channel_config *c, bool sniff) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS, sniff); }
+static inline void channel_config_set_bswap(dma_channel_config *c, bool bswap) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_BSWAP_BITS, bswap); }
+static inline void channel_config_set_enable(dma_channel_config *c, bool enable) { channel_config_set_bits(c, DMA_CH0_CTRL_TRIG_EN_BITS, enable); }
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+	c->ctrl = (c->ctrl & ~(3u << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB)) | ((uint32_t)size << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+	c->ctrl = (c->ctrl & ~(0x3fu << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB)) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to)
+{
+	c->ctrl = (c->ctrl & ~(0xfu << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB)) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits)
+{
+	c->ctrl = (c->ctrl & ~(0xfu << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB | DMA_CH0_CTRL_TRIG_RING_SEL_BITS))
+		| (size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) | (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0);
+}
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_claim(uint channel);
+void dma_channel_unclaim(uint channel);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable(void);
+void dma_sniffer_set_byte_swap_enabled(bool swap);
+void dma_sniffer_set_output_reverse_enabled(bool reverse);
+void dma_sniffer_set_output_invert_enabled(bool invert);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
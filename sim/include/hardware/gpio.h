@@ -0,0 +1,61 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_GPIO_H_
+#define SIM_HARDWARE_GPIO_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_function
+{
+	GPIO_FUNC_XIP  = 0,
+	GPIO_FUNC_SPI  = 1,
+	GPIO_FUNC_UART = 2,
+	GPIO_FUNC_I2C  = 3,
+	GPIO_FUNC_PWM  = 4,
+	GPIO_FUNC_SIO  = 5,
+	GPIO_FUNC_PIO0 = 6,
+	GPIO_FUNC_PIO1 = 7,
+	GPIO_FUNC_GPCK = 8,
+	GPIO_FUNC_USB  = 9,
+	GPIO_FUNC_NULL = 0x1f,
+};
+
+enum gpio_irq_level
+{
+	GPIO_IRQ_LEVEL_LOW  = 0x1u,
+	GPIO_IRQ_LEVEL_HIGH = 0x2u,
+	GPIO_IRQ_EDGE_FALL  = 0x4u,
+	GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t events);
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+static inline void gpio_pull_up(uint gpio) { gpio_set_pulls(gpio, true, false); }
+static inline void gpio_pull_down(uint gpio) { gpio_set_pulls(gpio, false, true); }
+static inline void gpio_disable_pulls(uint gpio) { gpio_set_pulls(gpio, false, false); }
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_PIO_H_
+#define SIM_HARDWARE_PIO_H_
+
+#include "pico.h"
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NUM_PIOS              2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+
+// The FIFO registers are real memory so DMA channels can be pointed at them
+typedef struct
+{
+	volatile uint32_t ctrl;
+	volatile uint32_t fstat;
+	volatile uint32_t fdebug;
+	volatile uint32_t flevel;
+	volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+	volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern PIO pio0;
+extern PIO pio1;
+
+typedef struct pio_program
+{
+	const uint16_t *instructions;
+	uint8_t length;
+	int8_t origin;
+} pio_program_t;
+
+enum pio_fifo_join
+{
+	PIO_FIFO_JOIN_NONE = 0,
+	PIO_FIFO_JOIN_TX   = 1,
+	PIO_FIFO_JOIN_RX   = 2,
+};
+
+typedef struct
+{
+	float clkdiv;
+	uint32_t wrap_target;
+	uint32_t wrap;
+	uint32_t in_base;
+	uint32_t out_base;
+	uint32_t out_count;
+	uint32_t set_base;
+	uint32_t set_count;
+	uint32_t sideset_base;
+	uint32_t sideset_count;
+	uint32_t shiftctrl;
+	uint32_t fifo_join;
+} pio_sm_config;
+
+static inline pio_sm_config pio_get_default_sm_config(void) { pio_sm_config c = { 1.f, 0, 31, 0, 0, 0, 0, 0, 0, 0, 0, PIO_FIFO_JOIN_NONE }; return c; }
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) { c->wrap_target = wrap_target; c->wrap = wrap; }
+static inline void sm_config_set_in_pins(pio_sm_config *c, uint in_base) { c->in_base = in_base; }
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) { c->out_base = out_base; c->out_count = out_count; }
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint set_base, uint set_count) { c->set_base = set_base; c->set_count = set_count; }
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) { c->sideset_base = sideset_base; }
+static inline void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) { (void)optional; (void)pindirs; c->sideset_count = bit_count; }
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = div; }
+static inline void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) { (void)shift_right; (void)autopush; (void)push_threshold; }
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) { (void)shift_right; (void)autopull; (void)pull_threshold; }
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) { c->fifo_join = join; }
+
+uint pio_get_index(PIO pio);
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return (pio_get_index(pio) << 3) + sm + (is_tx ? 0 : NUM_PIO_STATE_MACHINES); }
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+static inline void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) { pio_sm_put(pio, sm, data); }
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_claim(PIO pio, uint sm);
+void pio_sm_unclaim(PIO pio, uint sm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_PLL_H_
+#define SIM_HARDWARE_PLL_H_
+
+#include "pico.h"
+#include "hardware/structs/pll.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern pll_hw_t *const pll_sys;
+extern pll_hw_t *const pll_usb;
+
+void pll_init(pll_hw_t *pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2);
+void pll_deinit(pll_hw_t *pll);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
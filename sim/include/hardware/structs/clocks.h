@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_CLOCKS_H_
+#define SIM_HARDWARE_STRUCTS_CLOCKS_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS                   0x000000e0u
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB                    5
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS          0x0
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS   0x1
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB   0x2
+
+// Only the control registers are modelled, clock_configure() keeps them up to date
+typedef struct
+{
+	volatile uint32_t ctrl;
+	volatile uint32_t div;
+	volatile uint32_t selected;
+} clock_hw_t;
+
+typedef struct
+{
+	clock_hw_t clk[10];
+} clocks_hw_t;
+
+extern clocks_hw_t *clocks_hw;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_PLL_H_
+#define SIM_HARDWARE_STRUCTS_PLL_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLL_CS_REFDIV_BITS      0x0000003fu
+#define PLL_CS_REFDIV_LSB       0
+#define PLL_PWR_PD_BITS         0x00000001u
+#define PLL_FBDIV_INT_BITS      0x00000fffu
+#define PLL_PRIM_POSTDIV1_BITS  0x00070000u
+#define PLL_PRIM_POSTDIV1_LSB   16
+#define PLL_PRIM_POSTDIV2_BITS  0x00007000u
+#define PLL_PRIM_POSTDIV2_LSB   12
+
+// pll_init() and pll_deinit() keep the registers up to date, a PLL runs while PWR_PD is clear
+typedef struct
+{
+	volatile uint32_t cs;
+	volatile uint32_t pwr;
+	volatile uint32_t fbdiv_int;
+	volatile uint32_t prim;
+} pll_hw_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
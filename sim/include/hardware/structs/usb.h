@@ -0,0 +1,33 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_USB_H_
+#define SIM_HARDWARE_STRUCTS_USB_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_SOF_RD_BITS 0x000007ffu
+
+// Only the registers the firmware reads are modelled, the simulator bumps sof_rd every virtual millisecond
+typedef struct
+{
+	volatile uint32_t dev_addr_ctrl;
+	volatile uint32_t int_ep_addr_ctrl[15];
+	volatile uint32_t main_ctrl;
+	volatile uint32_t sof_wr;
+	volatile uint32_t sof_rd;
+} usb_hw_t;
+
+extern usb_hw_t *usb_hw;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
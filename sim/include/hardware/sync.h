@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_SYNC_H_
+#define SIM_HARDWARE_SYNC_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef volatile uint32_t spin_lock_t;
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __dsb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __isb(void) { }
+static inline void __sev(void) { }
+void __wfe(void); // core1 stops being tracked by the clock until it reads it again
+static inline void __wfi(void) { }
+static inline void __nop(void) { }
+
+// Interrupts are simulated on core0's thread, so masking them has nothing to do
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+spin_lock_t *spin_lock_instance(uint lock_num);
+uint spin_lock_claim_unused(bool required);
+void spin_lock_unclaim(uint lock_num);
+bool is_spin_locked(spin_lock_t *lock);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_TIMER_H_
+#define SIM_HARDWARE_TIMER_H_
+
+#include "pico/time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
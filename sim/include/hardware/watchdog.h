@@ -0,0 +1,36 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_HARDWARE_WATCHDOG_H_
+#define SIM_HARDWARE_WATCHDOG_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+	volatile uint32_t ctrl;
+	volatile uint32_t load;
+	volatile uint32_t reason;
+	volatile uint32_t scratch[8];
+	volatile uint32_t tick;
+} watchdog_hw_t;
+
+extern watchdog_hw_t *watchdog_hw;
+
+// A reboot ends the simulation
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+bool watchdog_caused_reboot(void);
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void watchdog_update(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
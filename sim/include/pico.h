@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+// Host shim of the Pico SDK base types and attributes
+
+#ifndef SIM_PICO_H_
+#define SIM_PICO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int uint;
+
+// The SDK wraps this in a struct in debug builds, the plain integer form is used here
+typedef uint64_t absolute_time_t;
+
+#define _u(x) x ## u
+
+#define PICO_NO_HARDWARE 0
+#define NUM_BANK0_GPIOS  30
+#define XIP_BASE         _u(0x10000000)
+#define SRAM_BASE        _u(0x20000000)
+#define SRAM_END         _u(0x20042000)
+
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// The linker script's symbol, at options.imageBytes into the simulated flash. Left bare so the
+// firmware's `extern char __flash_binary_end;` declares the pointer, and its address is the pointer
+extern char *sim_flash_binary_end;
+#define __flash_binary_end *sim_flash_binary_end
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __force_inline inline __attribute__((always_inline))
+#define __uninitialized_ram(group) group
+
+#define hard_assert(x) ((void)0)
+#define panic(...) sim_panic(__VA_ARGS__)
+
+void sim_panic(const char *format, ...) __attribute__((noreturn));
+
+uint get_core_num(void);
+
+static inline void tight_loop_contents(void) { }
+
+#ifdef __cplusplus
+}
+#endif
+
+// The SDK headers the firmware includes reach the time API through the platform headers
+#include "pico/time.h"
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_PICO_BINARY_INFO_H_
+#define SIM_PICO_BINARY_INFO_H_
+
+#define bi_decl(...)
+#define bi_decl_if_func_used(...)
+#define bi_2pins_with_func(...)
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_PICO_LOCK_CORE_H_
+#define SIM_PICO_LOCK_CORE_H_
+
+#include "pico.h"
+#include "hardware/sync.h"
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_PICO_MULTICORE_H_
+#define SIM_PICO_MULTICORE_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// core1 runs on its own host thread
+void multicore_launch_core1(void (*entry)(void));
+void multicore_reset_core1(void);
+void multicore_lockout_victim_init(void);
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_PICO_STDLIB_H_
+#define SIM_PICO_STDLIB_H_
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// clk_sys from the system PLL, the simulator only records the frequency
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
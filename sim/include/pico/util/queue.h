@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_PICO_UTIL_QUEUE_H_
+#define SIM_PICO_UTIL_QUEUE_H_
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+	void *lock;
+	uint8_t *data;
+	uint16_t wptr;
+	uint16_t rptr;
+	uint16_t element_size;
+	uint16_t element_count;
+} queue_t;
+
+void queue_init(queue_t *q, uint element_size, uint element_count);
+void queue_free(queue_t *q);
+uint queue_get_level(queue_t *q);
+static inline bool queue_is_empty(queue_t *q) { return queue_get_level(q) == 0; }
+static inline bool queue_is_full(queue_t *q) { return queue_get_level(q) == q->element_count; }
+bool queue_try_add(queue_t *q, const void *data);
+bool queue_try_remove(queue_t *q, void *data);
+bool queue_try_peek(queue_t *q, void *data);
+void queue_add_blocking(queue_t *q, const void *data);
+void queue_remove_blocking(queue_t *q, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
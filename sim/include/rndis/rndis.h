@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_RNDIS_H_
+#define SIM_RNDIS_H_
+
+// The web configurator needs lwIP and a real host network stack, the simulator leaves it out
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rndis_init(void);
+void rndis_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_TUSB_H_
+#define SIM_TUSB_H_
+
+// Host shim of the TinyUSB device stack. The simulated host enumerates the device as soon as
+// tusb_init() runs, then collects each queued IN transfer at the next start-of-frame.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define OPT_MCU_RP2040       2200
+#define OPT_OS_PICO          5
+#define OPT_MODE_DEVICE      0x01
+#define OPT_MODE_HOST        0x02
+#define OPT_MODE_FULL_SPEED  0x00
+#define OPT_MODE_HIGH_SPEED  0x04
+
+#include "tusb_config.h"
+
+#ifndef CFG_TUD_NET_ENDPOINT_SIZE
+#define CFG_TUD_NET_ENDPOINT_SIZE 64
+#endif
+
+#ifndef CFG_TUD_NET_MTU
+#define CFG_TUD_NET_MTU 1514
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TU_ATTR_WEAK       __attribute__((weak))
+#define TU_ATTR_PACKED     __attribute__((packed))
+#define TU_ATTR_ALIGNED(x) __attribute__((aligned(x)))
+#define TU_ARRAY_SIZE(a)   (sizeof(a) / sizeof(a[0]))
+#define TU_MIN(a, b)       (((a) < (b)) ? (a) : (b))
+#define TU_MAX(a, b)       (((a) > (b)) ? (a) : (b))
+#define TU_U16_LOW(u16)    ((uint8_t)((u16) & 0x00ff))
+#define TU_U16_HIGH(u16)   ((uint8_t)(((u16) >> 8) & 0x00ff))
+#define U16_TO_U8S_LE(u16) TU_U16_LOW(u16), TU_U16_HIGH(u16)
+
+#define TU_GET_3RD_ARG(arg1, arg2, arg3, ...) arg3
+#define TU_VERIFY_1ARG(cond)      do { if (!(cond)) return false; } while (0)
+#define TU_VERIFY_2ARG(cond, ret) do { if (!(cond)) return ret; } while (0)
+#define TU_VERIFY(...) TU_GET_3RD_ARG(__VA_ARGS__, TU_VERIFY_2ARG, TU_VERIFY_1ARG, unused)(__VA_ARGS__)
+#define TU_ASSERT(...) TU_VERIFY(__VA_ARGS__)
+#define TU_BREAKPOINT()       do { } while (0)
+#define TU_LOG1(...)
+#define TU_LOG2(...)
+
+typedef enum
+{
+	XFER_RESULT_SUCCESS,
+	XFER_RESULT_FAILED,
+	XFER_RESULT_STALLED,
+} xfer_result_t;
+
+typedef enum
+{
+	TUSB_DIR_OUT = 0,
+	TUSB_DIR_IN  = 1,
+	TUSB_DIR_IN_MASK = 0x80,
+} tusb_dir_t;
+
+typedef enum
+{
+	TUSB_XFER_CONTROL     = 0,
+	TUSB_XFER_ISOCHRONOUS = 1,
+	TUSB_XFER_BULK        = 2,
+	TUSB_XFER_INTERRUPT   = 3,
+} tusb_xfer_type_t;
+
+typedef enum
+{
+	TUSB_DESC_DEVICE                = 0x01,
+	TUSB_DESC_CONFIGURATION         = 0x02,
+	TUSB_DESC_STRING                = 0x03,
+	TUSB_DESC_INTERFACE             = 0x04,
+	TUSB_DESC_ENDPOINT              = 0x05,
+	TUSB_DESC_INTERFACE_ASSOCIATION = 0x0B,
+	TUSB_DESC_CS_INTERFACE          = 0x24,
+} tusb_desc_type_t;
+
+typedef enum
+{
+	TUSB_CLASS_UNSPECIFIED     = 0,
+	TUSB_CLASS_CDC             = 2,
+	TUSB_CLASS_HID             = 3,
+	TUSB_CLASS_CDC_DATA        = 10,
+	TUSB_CLASS_MISC            = 0xEF,
+	TUSB_CLASS_VENDOR_SPECIFIC = 0xFF,
+} tusb_class_code_t;
+
+#define MISC_SUBCLASS_COMMON 2
+#define MISC_PROTOCOL_IAD    1
+
+typedef struct TU_ATTR_PACKED
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint16_t bcdUSB;
+	uint8_t bDeviceClass;
+	uint8_t bDeviceSubClass;
+	uint8_t bDeviceProtocol;
+	uint8_t bMaxPacketSize0;
+	uint16_t idVendor;
+	uint16_t idProduct;
+	uint16_t bcdDevice;
+	uint8_t iManufacturer;
+	uint8_t iProduct;
+	uint8_t iSerialNumber;
+	uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+typedef struct TU_ATTR_PACKED
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint16_t wTotalLength;
+	uint8_t bNumInterfaces;
+	uint8_t bConfigurationValue;
+	uint8_t iConfiguration;
+	uint8_t bmAttributes;
+	uint8_t bMaxPower;
+} tusb_desc_configuration_t;
+
+typedef struct TU_ATTR_PACKED
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bInterfaceNumber;
+	uint8_t bAlternateSetting;
+	uint8_t bNumEndpoints;
+	uint8_t bInterfaceClass;
+	uint8_t bInterfaceSubClass;
+	uint8_t bInterfaceProtocol;
+	uint8_t iInterface;
+} tusb_desc_interface_t;
+
+typedef struct TU_ATTR_PACKED
+{
+	uint8_t bLength;
+	uint8_t bDescriptorType;
+	uint8_t bEndpointAddress;
+	struct TU_ATTR_PACKED
+	{
+		uint8_t xfer  : 2;
+		uint8_t sync  : 2;
+		uint8_t usage : 2;
+		uint8_t       : 2;
+	} bmAttributes;
+	uint16_t wMaxPacketSize;
+	uint8_t bInterval;
+} tusb_desc_endpoint_t;
+
+typedef struct TU_ATTR_PACKED
+{
+	union
+	{
+		struct TU_ATTR_PACKED
+		{
+			uint8_t recipient : 5;
+			uint8_t type      : 2;
+			uint8_t direction : 1;
+		} bmRequestType_bit;
+
+		uint8_t bmRequestType;
+	};
+
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} tusb_control_request_t;
+
+static inline uint8_t const *tu_desc_next(void const *desc) { uint8_t const *d = (uint8_t const *)desc; return d + d[0]; }
+static inline uint8_t tu_desc_type(void const *desc) { return ((uint8_t const *)desc)[1]; }
+static inline uint8_t tu_desc_len(void const *desc) { return ((uint8_t const *)desc)[0]; }
+static inline tusb_dir_t tu_edpt_dir(uint8_t addr) { return (addr & TUSB_DIR_IN_MASK) ? TUSB_DIR_IN : TUSB_DIR_OUT; }
+static inline uint8_t tu_edpt_number(uint8_t addr) { return (uint8_t)(addr & (~TUSB_DIR_IN_MASK)); }
+static inline uint8_t tu_min8(uint8_t x, uint8_t y) { return (x < y) ? x : y; }
+
+#define TUD_CONFIG_DESC_LEN 9
+
+#define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+	9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, TU_BIT(7) | _attribute, (_power_ma) / 2
+
+#define TU_BIT(n) (1UL << (n))
+
+// The network interfaces are only used by the web configurator, which isn't simulated
+#define TUD_RNDIS_DESC_LEN   9
+#define TUD_CDC_ECM_DESC_LEN 9
+#define TUD_HID_INOUT_DESC_LEN 9
+#define TUD_RNDIS_DESCRIPTOR(_itfnum, ...)    9, TUSB_DESC_INTERFACE, _itfnum, 0, 0, TUSB_CLASS_CDC, 0, 0, 0
+#define TUD_CDC_ECM_DESCRIPTOR(_itfnum, ...)  9, TUSB_DESC_INTERFACE, _itfnum, 0, 0, TUSB_CLASS_CDC, 0, 0, 0
+
+bool tusb_init(void);
+bool tusb_inited(void);
+void tud_task(void);
+bool tud_mounted(void);
+bool tud_ready(void);
+bool tud_suspended(void);
+bool tud_remote_wakeup(void);
+bool tud_connected(void);
+bool tud_connect(void);
+bool tud_disconnect(void);
+void tud_int_handler(uint8_t rhport);
+
+// Application callbacks
+uint8_t const *tud_descriptor_device_cb(void);
+uint8_t const *tud_descriptor_configuration_cb(uint8_t index);
+uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid);
+void tud_mount_cb(void);
+void tud_umount_cb(void);
+void tud_suspend_cb(bool remote_wakeup_en);
+void tud_resume_cb(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "class/hid/hid_device.h"
+
+#endif
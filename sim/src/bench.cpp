@@ -0,0 +1,357 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include "pico/util/queue.h"
+#include "gamepad.h"
+#include "latency.h"
+#include "pollstats.h"
+#include "modeswitch.h"
+#include "reportpipeline.h"
+#include "usb_driver.h"
+#include "sim.h"
+
+/**
+ * @brief Times the loop's per-cycle work with one player and then with two, in host time.
+ *
+ * Stands in for the main loop without the scheduler's waits: every cycle services USB, drives a
+ * button of each player so the reports keep changing, then reads, processes and sends for each
+ * player. The host's numbers don't carry over to the RP2040, the ratio between the two runs does.
+ *
+ * The pin map is then timed on its own against the ternaries read() used before the lookup tables,
+ * over the same GPIO words with this build's board configuration. Last, one handoff of the gamepad to
+ * core1 is timed both ways: the copy of the whole Gamepad through a queue_t the loop used to make, and
+ * the GamepadChannel's seqlocked frame. Both sides run on one thread, so neither waits on the other.
+ *
+ * Then each input mode with its own driver is timed with the report step the loop used to make,
+ * MPG's report switch and send_report() with its mode switch and full report memcmp, against that
+ * mode's ReportPipeline. Both get a changing button each cycle, then no changes at all. Both service
+ * USB and read the clock once a cycle, so the host collects reports at the same pace for each.
+ */
+namespace
+{
+	const uint32_t benchWords = 256; // GPIO words the map benchmark cycles through
+
+	// Exposes the primary's debounced word, so the lookup tables can be timed without the read
+	struct MapBench : public Gamepad
+	{
+		MapBench() : Gamepad(GAMEPAD_DEBOUNCE_MILLIS) {}
+
+		inline void mapWord(uint32_t values)
+		{
+			debouncedValues = values;
+			map();
+		}
+	};
+
+	// The pin map as read() had it before the lookup tables
+	void mapTernaries(Gamepad &gamepad, uint32_t values)
+	{
+		GamepadState &state = gamepad.state;
+
+		#ifdef PIN_SETTINGS
+		state.aux = 0
+			| ((values & (1 << PIN_SETTINGS)) ? (1 << 0) : 0)
+		;
+		#endif
+
+		state.dpad = 0
+			| ((values & gamepad.mapDpadUp->pinMask)    ? (gamepad.options.invertYAxis ? gamepad.mapDpadDown->buttonMask : gamepad.mapDpadUp->buttonMask) : 0)
+			| ((values & gamepad.mapDpadDown->pinMask)  ? (gamepad.options.invertYAxis ? gamepad.mapDpadUp->buttonMask : gamepad.mapDpadDown->buttonMask) : 0)
+			| ((values & gamepad.mapDpadLeft->pinMask)  ? gamepad.mapDpadLeft->buttonMask  : 0)
+			| ((values & gamepad.mapDpadRight->pinMask) ? gamepad.mapDpadRight->buttonMask : 0)
+		;
+
+		state.buttons = 0
+			| ((values & gamepad.mapButtonB1->pinMask)  ? gamepad.mapButtonB1->buttonMask  : 0)
+			| ((values & gamepad.mapButtonB2->pinMask)  ? gamepad.mapButtonB2->buttonMask  : 0)
+			| ((values & gamepad.mapButtonB3->pinMask)  ? gamepad.mapButtonB3->buttonMask  : 0)
+			| ((values & gamepad.mapButtonB4->pinMask)  ? gamepad.mapButtonB4->buttonMask  : 0)
+			| ((values & gamepad.mapButtonL1->pinMask)  ? gamepad.mapButtonL1->buttonMask  : 0)
+			| ((values & gamepad.mapButtonR1->pinMask)  ? gamepad.mapButtonR1->buttonMask  : 0)
+			| ((values & gamepad.mapButtonL2->pinMask)  ? gamepad.mapButtonL2->buttonMask  : 0)
+			| ((values & gamepad.mapButtonR2->pinMask)  ? gamepad.mapButtonR2->buttonMask  : 0)
+			| ((values & gamepad.mapButtonS1->pinMask)  ? gamepad.mapButtonS1->buttonMask  : 0)
+			| ((values & gamepad.mapButtonS2->pinMask)  ? gamepad.mapButtonS2->buttonMask  : 0)
+			| ((values & gamepad.mapButtonL3->pinMask)  ? gamepad.mapButtonL3->buttonMask  : 0)
+			| ((values & gamepad.mapButtonR3->pinMask)  ? gamepad.mapButtonR3->buttonMask  : 0)
+			| ((values & gamepad.mapButtonA1->pinMask)  ? gamepad.mapButtonA1->buttonMask  : 0)
+			| ((values & gamepad.mapButtonA2->pinMask)  ? gamepad.mapButtonA2->buttonMask  : 0)
+		;
+
+		state.lx = GAMEPAD_JOYSTICK_MID;
+		state.ly = GAMEPAD_JOYSTICK_MID;
+		state.rx = GAMEPAD_JOYSTICK_MID;
+		state.ry = GAMEPAD_JOYSTICK_MID;
+		state.lt = 0;
+		state.rt = 0;
+	}
+
+	template <typename Function>
+	double timeWords(const uint32_t *words, uint32_t cycles, Function function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t cycle = 0; cycle < cycles; cycle++)
+			function(words[cycle % benchWords]);
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / cycles;
+	}
+
+	// Both maps are checked against each other on every word before either is timed
+	void benchMap(uint32_t cycles)
+	{
+		static MapBench gamepad;
+		gamepad.setup();
+
+		static uint32_t words[benchWords];
+		uint32_t seed = 0x2040;
+		for (uint32_t &word : words)
+		{
+			seed = seed * 1103515245 + 12345;
+			word = (seed ^ (seed >> 15)) & gamepad.pinMask;
+		}
+
+		uint32_t mismatches = 0;
+		for (uint32_t word : words)
+		{
+			gamepad.mapWord(word);
+			GamepadState lookup = gamepad.state;
+			mapTernaries(gamepad, word);
+			if (lookup.buttons != gamepad.state.buttons || lookup.dpad != gamepad.state.dpad || lookup.aux != gamepad.state.aux)
+				mismatches++;
+		}
+
+		double lookup = timeWords(words, cycles, [](uint32_t word) { gamepad.mapWord(word); });
+		double ternary = timeWords(words, cycles, [](uint32_t word) { mapTernaries(gamepad, word); });
+
+		sim::emit("bench %llu map pins %u lookup ns %.1f ternary ns %.1f mismatches %u\n", (unsigned long long)sim::now(),
+			__builtin_popcount(gamepad.pinMask), lookup, ternary, mismatches);
+		fprintf(stderr, "sim: pin map %.1f ns with the lookup tables, %.1f ns with the ternaries (%.2fx), %u mismatches\n",
+			lookup, ternary, lookup > 0 ? ternary / lookup : 0.0, mismatches);
+	}
+
+	template <typename Function>
+	double timeHandoffs(uint32_t cycles, Function function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t cycle = 0; cycle < cycles; cycle++)
+			function(cycle);
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / cycles;
+	}
+
+	// Each handoff changes a button, so the seqlock always has a new frame to take
+	void benchHandoff(Gamepad &gamepad, uint32_t cycles)
+	{
+		static queue_t gamepadQueue;
+		static Gamepad snapshot(GAMEPAD_DEBOUNCE_MILLIS);
+		static Gamepad received(GAMEPAD_DEBOUNCE_MILLIS);
+		static GamepadChannel channel;
+		queue_init(&gamepadQueue, sizeof(Gamepad), 1);
+
+		double queued = timeHandoffs(cycles, [&gamepad](uint32_t cycle)
+		{
+			gamepad.state.buttons = cycle;
+			memcpy((void *)&snapshot, (void *)&gamepad, sizeof(Gamepad));
+			queue_try_add(&gamepadQueue, &snapshot);
+			queue_try_remove(&gamepadQueue, &received);
+		});
+
+		double seqlocked = timeHandoffs(cycles, [&gamepad](uint32_t cycle)
+		{
+			gamepad.state.buttons = cycle;
+			channel.publish(gamepad);
+			channel.receive(received);
+		});
+
+		queue_free(&gamepadQueue);
+
+		// The queue copies the Gamepad into the snapshot, into the queue and out again, the seqlock
+		// copies the frame in and out. Its barriers are full fences on the host but a few cycles on
+		// the RP2040, so the bytes copied carry over to the board better than the host times do.
+		size_t queueBytes = 3 * sizeof(Gamepad);
+		size_t seqlockBytes = 2 * sizeof(InputFrame);
+		sim::emit("bench %llu handoff queue copied %zu ns %.1f seqlock copied %zu ns %.1f\n", (unsigned long long)sim::now(),
+			queueBytes, queued, seqlockBytes, seqlocked);
+		fprintf(stderr, "sim: core1 handoff %.1f ns copying %zu bytes through a queue, %.1f ns copying %zu through the seqlock\n",
+			queued, queueBytes, seqlocked, seqlockBytes);
+	}
+
+	// The loop's report step before the pipelines, with its own copy of the last report sent
+	struct LegacyReport
+	{
+		uint8_t previous[CFG_TUD_ENDPOINT0_SIZE] = { };
+
+		// MPG::getReport() picked the report by input mode on every call
+		void *build(Gamepad &gamepad, InputMode mode, uint16_t &size)
+		{
+			switch (mode)
+			{
+				case INPUT_MODE_XINPUT:
+					size = sizeof(XInputReport);
+					return gamepad.getXInputReport();
+
+				case INPUT_MODE_SWITCH:
+					size = sizeof(SwitchReport);
+					return gamepad.getSwitchReport();
+
+				default:
+					size = sizeof(HIDReport);
+					return gamepad.getHIDReport();
+			}
+		}
+
+		// send_report() as it was, dispatching on the input mode again to send
+		void run(Gamepad &gamepad, InputMode mode)
+		{
+			uint16_t size;
+			void *report = build(gamepad, mode, size);
+
+			if (tud_suspended())
+				tud_remote_wakeup();
+
+			if (memcmp(previous, report, size) != 0)
+			{
+				bool sent = false;
+				switch (mode)
+				{
+					case INPUT_MODE_XINPUT:
+						sent = send_xinput_report(report, size);
+						break;
+
+					default:
+						sent = send_hid_report(0, report, size);
+						break;
+				}
+
+				if (sent)
+				{
+					memcpy(previous, report, size);
+					report_queued_cb(0);
+				}
+			}
+		}
+	};
+
+	// Every cycle changes the report when changing is set, otherwise the buttons stay released
+	template <typename Function>
+	double timeReports(Gamepad &gamepad, uint32_t cycles, bool changing, Function function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t cycle = 0; cycle < cycles; cycle++)
+		{
+			usb_task();
+			uint64_t now = time_us_64();
+			gamepad.state.buttons = (changing && (cycle & 1)) ? GAMEPAD_MASK_B1 : 0;
+			function(now);
+		}
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / cycles;
+	}
+
+	template <InputMode Mode>
+	void benchReports(Gamepad &gamepad, const char *name, uint32_t cycles)
+	{
+		static ReportPipeline<Mode> pipeline;
+		static LegacyReport legacy;
+
+		disconnect_driver();
+		sleep_ms(USB_DETACH_MS);
+		reconnect_driver(Mode);
+		while (!tud_mounted())
+			usb_task();
+
+		pipeline.reset();
+		gamepad.options.inputMode = Mode;
+
+		// The USB service and clock read every cycle pays are timed on their own and taken off
+		double service = timeReports(gamepad, cycles, true, [](uint64_t now) { (void)now; });
+
+		double results[4];
+		for (int i = 0; i < 4; i++)
+		{
+			bool changing = i < 2;
+			if (i & 1)
+				results[i] = timeReports(gamepad, cycles, changing, [&gamepad](uint64_t now) { pipeline.run(gamepad, now); });
+			else
+				results[i] = timeReports(gamepad, cycles, changing, [&gamepad](uint64_t now) { (void)now; legacy.run(gamepad, Mode); });
+
+			results[i] -= service;
+		}
+
+		sim::emit("bench %llu report %s service ns %.1f change legacy ns %.1f pipeline ns %.1f idle legacy ns %.1f pipeline ns %.1f\n",
+			(unsigned long long)sim::now(), name, service, results[0], results[1], results[2], results[3]);
+		fprintf(stderr, "sim: %s report step %.1f ns with send_report(), %.1f ns with the pipeline, idle %.1f ns and %.1f ns\n",
+			name, results[0], results[1], results[2], results[3]);
+	}
+
+	struct BenchPlayer
+	{
+		Gamepad *gamepad;
+		ReportPipeline<INPUT_MODE_HID> pipeline;
+	};
+
+	double runCycles(BenchPlayer *players, uint8_t count, uint32_t cycles)
+	{
+		uint8_t pins[2] = { players[0].gamepad->mapButtonB1->pin, players[1].gamepad->mapButtonB1->pin };
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t cycle = 0; cycle < cycles; cycle++)
+		{
+			for (uint8_t pin : pins)
+			{
+				if (pin < NUM_BANK0_GPIOS)
+					sim::gpioDrive(pin, (cycle & 1) ? 0 : -1);
+			}
+
+			usb_task();
+
+			uint64_t now = time_us_64();
+			for (uint8_t i = 0; i < count; i++)
+			{
+				players[i].gamepad->read();
+				players[i].gamepad->process();
+				players[i].pipeline.run(*players[i].gamepad, now);
+			}
+		}
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / cycles;
+	}
+}
+
+void sim::bench(uint32_t cycles)
+{
+	GamepadStore.start();
+	latencyTracer.setup();
+	pollTracker.setup();
+
+	static Gamepad first(GAMEPAD_DEBOUNCE_MILLIS);
+	static Gamepad second(GAMEPAD_DEBOUNCE_MILLIS, &GamepadStore, 1, &first);
+	first.setup();
+	second.setup();
+
+	initialize_driver(INPUT_MODE_HID, false, 2);
+
+	static BenchPlayer players[2] = { { &first }, { &second } };
+	players[1].pipeline.instance = 1;
+
+	// Warm up the caches and the lookup tables before timing
+	runCycles(players, 2, cycles / 10 + 1);
+
+	double one = runCycles(players, 1, cycles);
+	double two = runCycles(players, 2, cycles);
+
+	emit("bench %llu cycles %u players 1 ns %.0f players 2 ns %.0f\n", (unsigned long long)now(), cycles, one, two);
+	fprintf(stderr, "sim: %u cycles, %.0f ns per cycle with one player, %.0f ns with two (%.2fx)\n",
+		cycles, one, two, one > 0 ? two / one : 0.0);
+
+	benchMap(cycles);
+	benchHandoff(first, cycles);
+
+	benchReports<INPUT_MODE_XINPUT>(first, "xinput", cycles);
+	benchReports<INPUT_MODE_HID>(first, "hid", cycles);
+	benchReports<INPUT_MODE_SWITCH>(first, "switch", cycles);
+}
@@ -0,0 +1,207 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <vector>
+#include "debounce.h"
+#include "sim.h"
+
+/**
+ * @brief Runs the debouncer over switch waveforms in both modes and checks what it reports, and when.
+ *
+ * Each waveform is a list of edges on one pin, bounces built the way the script's `bounce` command
+ * builds them, sampled every BOUNCE_SAMPLE_US the way read() samples the pins in play. A stall stops the
+ * sampling for a while, as a long USB or flash wait does on core0, so the first sample after it arrives
+ * with many milliseconds to count. Every change the debouncer reports has to fall in its expected
+ * window: the sample after the first edge in eager mode, the window after the last edge in deferred.
+ */
+#define BOUNCE_SAMPLE_US 100
+
+namespace
+{
+	struct Edge
+	{
+		uint64_t time;
+		bool pressed;
+	};
+
+	// A change the debouncer must report, no earlier than from and no later than to
+	struct Expected
+	{
+		bool pressed;
+		uint64_t from;
+		uint64_t to;
+	};
+
+	struct Waveform
+	{
+		const char *name;
+		std::vector<Edge> edges;
+		uint64_t stallStart = 0; // No samples are taken from here up to stallEnd
+		uint64_t stallEnd = 0;
+		std::vector<Expected> eager;
+		std::vector<Expected> deferred;
+	};
+
+	// The script's bounce command: count edges this far apart, starting with a press
+	void bounce(std::vector<Edge> &edges, uint64_t time, int count, uint64_t interval)
+	{
+		for (int i = 0; i < count; i++)
+			edges.push_back({ time + i * interval, (i & 1) == 0 });
+	}
+
+	// Reported within a sample of the edge
+	Expected after(bool pressed, uint64_t time)
+	{
+		return { pressed, time, time + BOUNCE_SAMPLE_US };
+	}
+
+	// Reported once the pin has been seen at its level for the window. The debouncer counts the
+	// millisecond ticks it sees, so the first can be up to a millisecond after the pin was seen.
+	Expected settled(bool pressed, uint64_t seen, uint64_t windowUs)
+	{
+		return { pressed, seen + windowUs - 1000, seen + windowUs + BOUNCE_SAMPLE_US };
+	}
+
+	std::vector<Waveform> waveforms(uint64_t windowUs)
+	{
+		std::vector<Waveform> list;
+
+		Waveform clean = { "clean" };
+		clean.edges.push_back({ 10000, true });
+		clean.edges.push_back({ 60000, false });
+		clean.eager = { after(true, 10000), after(false, 60000) };
+		clean.deferred = { settled(true, 10000, windowUs), settled(false, 60000, windowUs) };
+		list.push_back(clean);
+
+		// Bounces on the press and on the release, each over within the window
+		Waveform bounced = { "bounce" };
+		bounce(bounced.edges, 10000, 4, 200);
+		bounced.edges.push_back({ 10800, true });
+		bounced.edges.push_back({ 60000, false });
+		bounce(bounced.edges, 60200, 3, 200);
+		bounced.edges.push_back({ 60800, false });
+		bounced.eager = { after(true, 10000), after(false, 60000) };
+		bounced.deferred = { settled(true, 10800, windowUs), settled(false, 60800, windowUs) };
+		list.push_back(bounced);
+
+		// Noise shorter than the window, eager passes it on and holds it for the window
+		Waveform spike = { "spike" };
+		bounce(spike.edges, 30000, 2, 300);
+		spike.eager = { after(true, 30000), settled(false, 30000, windowUs) };
+		list.push_back(spike);
+
+		// One sample of noise straight after a stall, longer than the window, must not be taken as a press
+		Waveform stall = { "stall" };
+		stall.stallStart = 30000;
+		stall.stallEnd = 50000;
+		bounce(stall.edges, 50000, 2, BOUNCE_SAMPLE_US);
+		stall.eager = { after(true, 50000), settled(false, 50000, windowUs) };
+		list.push_back(stall);
+
+		// A press made during a stall is only seen after it, and settles from there
+		Waveform stallPress = { "stall-press" };
+		stallPress.stallStart = 30000;
+		stallPress.stallEnd = 50000;
+		stallPress.edges.push_back({ 40000, true });
+		stallPress.edges.push_back({ 100000, false });
+		stallPress.eager = { after(true, 50000), after(false, 100000) };
+		stallPress.deferred = { settled(true, 50000, windowUs), settled(false, 100000, windowUs) };
+		list.push_back(stallPress);
+
+		return list;
+	}
+
+	// Runs one waveform, returns whether every reported change was expected and in time
+	bool run(const Waveform &waveform, DebounceMode mode, uint32_t windowMs)
+	{
+		const std::vector<Expected> &expected = (mode == DEBOUNCE_MODE_EAGER) ? waveform.eager : waveform.deferred;
+		const uint8_t pin = 0;
+		const uint64_t endUs = waveform.edges.back().time + 4 * windowMs * 1000 + 10000;
+
+		GamepadDebouncer debouncer;
+		debouncer.setWindow(pin, windowMs);
+		debouncer.setup(mode, 0, 0);
+
+		size_t edge = 0;
+		size_t changes = 0;
+		bool pressed = false;
+		bool reported = false;
+		bool ok = true;
+		int64_t latency = -1;
+		for (uint64_t t = 0; t < endUs; t += BOUNCE_SAMPLE_US)
+		{
+			while (edge < waveform.edges.size() && waveform.edges[edge].time <= t)
+				pressed = waveform.edges[edge++].pressed;
+
+			if (t >= waveform.stallStart && t < waveform.stallEnd)
+				continue;
+
+			bool state = debouncer.update(pressed ? (1U << pin) : 0, t / 1000) & (1U << pin);
+			if (state == reported)
+				continue;
+
+			reported = state;
+			if (changes >= expected.size())
+			{
+				sim::emit("debounce %llu %s %s unexpected %s at %llu\n", (unsigned long long)sim::now(),
+					(mode == DEBOUNCE_MODE_EAGER) ? "eager" : "deferred", waveform.name,
+					state ? "press" : "release", (unsigned long long)t);
+				ok = false;
+			}
+			else
+			{
+				const Expected &change = expected[changes];
+				if (state != change.pressed || t < change.from || t > change.to)
+				{
+					sim::emit("debounce %llu %s %s %s at %llu expected %llu-%llu\n", (unsigned long long)sim::now(),
+						(mode == DEBOUNCE_MODE_EAGER) ? "eager" : "deferred", waveform.name,
+						state ? "press" : "release", (unsigned long long)t,
+						(unsigned long long)change.from, (unsigned long long)change.to);
+					ok = false;
+				}
+			}
+
+			if (changes == 0 && !waveform.edges.empty())
+				latency = t - waveform.edges[0].time;
+
+			changes++;
+		}
+
+		if (changes < expected.size())
+			ok = false;
+
+		sim::emit("debounce %llu %s %s changes %zu expected %zu latency %lld %s\n", (unsigned long long)sim::now(),
+			(mode == DEBOUNCE_MODE_EAGER) ? "eager" : "deferred", waveform.name,
+			changes, expected.size(), (long long)latency, ok ? "ok" : "bad");
+
+		return ok;
+	}
+}
+
+void sim::debounce(uint32_t windowMs)
+{
+	if (windowMs < 2 || windowMs > DEBOUNCE_MAX_MILLIS)
+	{
+		fprintf(stderr, "sim: debounce window must be 2 to %d ms\n", DEBOUNCE_MAX_MILLIS);
+		finish(1, "bad debounce window");
+	}
+
+	uint32_t failed = 0;
+	uint32_t count = 0;
+	for (const Waveform &waveform : waveforms(windowMs * 1000))
+	{
+		for (DebounceMode mode : { DEBOUNCE_MODE_EAGER, DEBOUNCE_MODE_DEFERRED })
+		{
+			count++;
+			if (!run(waveform, mode, windowMs))
+				failed++;
+		}
+	}
+
+	fprintf(stderr, "sim: %u debounce waveforms with a %ums window, %u failed\n", count, windowMs, failed);
+	if (failed)
+		finish(1, "debounce mismatch");
+}
@@ -0,0 +1,157 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <chrono>
+#include "AnimationStorage.hpp"
+#include "CRC32.h"
+#include "FlashPROM.h"
+#include "storage.h"
+#include "sim.h"
+
+/**
+ * @brief Checks the CRC32 backends against the nibble table code they replaced, then times them.
+ *
+ * Every length and alignment up to a few hundred bytes is checked through update() a byte at a time,
+ * updateBytes() on the slice tables and calculate(), which hands CRC32_DMA_MIN_BYTES and up to the DMA
+ * sniffer. The lengths the settings and the store's records are checksummed at are then timed, and
+ * the checksums already stored in the -f flash image are checked with calculate(). Host times don't
+ * carry over to the RP2040, and the sniffer is modelled a bit at a time, so its time means nothing.
+ */
+namespace
+{
+	const uint32_t nibbleTable[] = {
+		0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+		0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+		0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+		0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+	};
+
+	// CRC32::update() as it was, a nibble at a time
+	uint32_t nibbleCRC(const uint8_t *data, uint32_t size)
+	{
+		uint32_t state = ~0u;
+		for (uint32_t i = 0; i < size; i++)
+		{
+			state = nibbleTable[(state ^ data[i]) & 0x0f] ^ (state >> 4);
+			state = nibbleTable[(state ^ (data[i] >> 4)) & 0x0f] ^ (state >> 4);
+		}
+
+		return ~state;
+	}
+
+	uint32_t byteCRC(const uint8_t *data, uint32_t size)
+	{
+		CRC32 crc;
+		for (uint32_t i = 0; i < size; i++)
+			crc.update(data[i]);
+
+		return crc.finalize();
+	}
+
+	uint32_t slicedCRC(const uint8_t *data, uint32_t size)
+	{
+		CRC32 crc;
+		crc.updateBytes(data, size);
+		return crc.finalize();
+	}
+
+	template <typename Function>
+	double timeCalls(Function function, const uint8_t *data, uint32_t size, uint32_t rounds)
+	{
+		volatile uint32_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < rounds; i++)
+			sink = sink + function(data, size);
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+	}
+
+	// A checksum the old code didn't match was never saved, one it matched and calculate() doesn't is a regression
+	template <typename T>
+	bool checkStored(const char *name, uint16_t index, uint32_t T::*checksum)
+	{
+		T options;
+		EEPROM.get(index, options);
+		uint32_t stored = options.*checksum;
+		options.*checksum = 0;
+
+		const uint8_t *data = reinterpret_cast<const uint8_t *>(&options);
+		bool saved = nibbleCRC(data, sizeof(T)) == stored;
+		bool valid = CRC32::calculate(&options) == stored;
+		sim::emit("crc %llu stored %s %s\n", (unsigned long long)sim::now(), name, valid ? "ok" : (saved ? "bad" : "unset"));
+		return valid || !saved;
+	}
+}
+
+void sim::crc(uint32_t rounds)
+{
+	static uint8_t buffer[EEPROM_SIZE_BYTES + 8];
+	uint32_t seed = 0x2040;
+	for (uint8_t &byte : buffer)
+	{
+		seed = seed * 1103515245 + 12345;
+		byte = seed >> 16;
+	}
+
+	uint32_t mismatches = 0;
+	for (uint32_t offset = 0; offset < 8; offset++)
+	{
+		for (uint32_t size = 0; size <= 2 * FLASH_PAGE_SIZE; size++)
+		{
+			uint32_t expected = nibbleCRC(buffer + offset, size);
+			if (byteCRC(buffer + offset, size) != expected || slicedCRC(buffer + offset, size) != expected ||
+				CRC32::calculateBytes(buffer + offset, size) != expected)
+			{
+				mismatches++;
+			}
+		}
+	}
+
+	const uint32_t sizes[] = {
+		sizeof(GamepadOptions), sizeof(DebounceOptions), sizeof(AnimationOptions), sizeof(KeyboardMapping), sizeof(BoardOptions),
+		sizeof(FlashPROMRecord) - offsetof(FlashPROMRecord, generation), EEPROM_SIZE_BYTES
+	};
+
+	for (uint32_t size : sizes)
+	{
+		double nibble = timeCalls(nibbleCRC, buffer, size, rounds);
+		double sliced = timeCalls(slicedCRC, buffer, size, rounds);
+		double calculate = timeCalls(CRC32::calculateBytes, buffer, size, rounds);
+		emit("crc %llu bytes %u nibble ns %.0f sliced ns %.0f calculate ns %.0f %s\n", (unsigned long long)now(),
+			size, nibble, sliced, calculate, (CRC32::sniffing() && size >= CRC32_DMA_MIN_BYTES) ? "dma" : "tables");
+	}
+
+	// The store checks every record's CRC as it loads, so loaded records have checksums calculate() agrees with
+	GamepadStore.start();
+	bool stored = checkStored("gamepad", GAMEPAD_STORAGE_INDEX, &GamepadOptions::checksum);
+	stored &= checkStored("board", BOARD_STORAGE_INDEX, &BoardOptions::checksum);
+	stored &= checkStored("animation", ANIMATION_STORAGE_INDEX, &AnimationOptions::checksum);
+	stored &= checkStored("debounce", DEBOUNCE_STORAGE_INDEX, &DebounceOptions::checksum);
+	stored &= checkStored("keyboard", KEYBOARD_STORAGE_INDEX, &KeyboardMapping::checksum);
+
+	uint32_t records = 0;
+	uint32_t recordsValid = 0;
+	for (uint32_t page = 0; page < EEPROM_SECTOR_COUNT * EEPROM_SECTOR_PAGES; page++)
+	{
+		const FlashPROMRecord *record = reinterpret_cast<const FlashPROMRecord *>(EEPROM_REGION_START + page * FLASH_PAGE_SIZE);
+		if (record->magic != 0x52504730) // EEPROM_RECORD_MAGIC
+			continue;
+
+		const uint8_t *data = reinterpret_cast<const uint8_t *>(record) + offsetof(FlashPROMRecord, generation);
+		uint32_t size = sizeof(FlashPROMRecord) - offsetof(FlashPROMRecord, generation);
+		records++;
+		if (CRC32::calculateBytes(data, size) == record->crc && nibbleCRC(data, size) == record->crc)
+			recordsValid++;
+	}
+
+	emit("crc %llu records %u valid %u mismatches %u\n", (unsigned long long)now(), records, recordsValid, mismatches);
+	fprintf(stderr, "sim: CRC32 backends %s the nibble table, stored checksums %s, %u of %u flash records valid\n",
+		mismatches ? "disagree with" : "match", stored ? "valid" : "broken", recordsValid, records);
+
+	if (mismatches || !stored)
+		finish(1, "checksum mismatch");
+}
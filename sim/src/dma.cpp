@@ -0,0 +1,356 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include <thread>
+#include "pico/time.h"
+#include "hardware/dma.h"
+#include "sim.h"
+
+#define DMA_SNIFF_CTRL_EN_BITS      0x00000001u
+#define DMA_SNIFF_CTRL_DMACH_LSB    1
+#define DMA_SNIFF_CTRL_CALC_LSB     5
+#define DMA_SNIFF_CTRL_BSWAP_BITS   0x00000200u
+#define DMA_SNIFF_CTRL_OUT_REV_BITS 0x00000400u
+#define DMA_SNIFF_CTRL_OUT_INV_BITS 0x00000800u
+
+static dma_hw_t dmaState = { };
+dma_hw_t *dma_hw = &dmaState;
+
+static uint16_t channelsClaimed = 0;
+static uint32_t sniffRaw = 0;
+static uint32_t sniffShown = 0;
+
+static void dmaTrigger(uint channel);
+
+static inline uint32_t ctrl(uint channel)     { return dma_hw->ch[channel].ctrl_trig; }
+static inline uint dataSize(uint channel)     { return 1u << ((ctrl(channel) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB) & 3); }
+static inline uint treqSel(uint channel)      { return (ctrl(channel) >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB) & 0x3f; }
+static inline uint chainTo(uint channel)      { return (ctrl(channel) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB) & 0xf; }
+static inline bool busy(uint channel)         { return ctrl(channel) & DMA_CH0_CTRL_TRIG_BUSY_BITS; }
+
+// Only the PIO RX requests are paced, everything else is always ready on the host
+static inline bool paced(uint treq)
+{
+	return treq < 16 && (treq & 4);
+}
+
+static uint32_t reverse32(uint32_t value)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < 32; i++, value >>= 1)
+		result = (result << 1) | (value & 1);
+
+	return result;
+}
+
+static void sniffByte(uint mode, uint8_t byte)
+{
+	switch (mode)
+	{
+		case 0x1: // CRC-32 over bit-reversed data
+			byte = reverse32(byte) >> 24;
+			// fallthrough
+		case 0x0: // CRC-32, IEEE 802.3 polynomial
+			sniffRaw ^= (uint32_t)byte << 24;
+			for (int i = 0; i < 8; i++)
+				sniffRaw = (sniffRaw & 0x80000000) ? (sniffRaw << 1) ^ 0x04C11DB7 : (sniffRaw << 1);
+			break;
+
+		case 0x3: // CRC-16-CCITT over bit-reversed data
+			byte = reverse32(byte) >> 24;
+			// fallthrough
+		case 0x2: // CRC-16-CCITT
+			sniffRaw ^= (uint32_t)byte << 8;
+			for (int i = 0; i < 8; i++)
+				sniffRaw = ((sniffRaw & 0x8000) ? (sniffRaw << 1) ^ 0x1021 : (sniffRaw << 1)) & 0xffff;
+			break;
+
+		case 0xe: // XOR reduction
+			sniffRaw ^= __builtin_parity(byte);
+			break;
+	}
+}
+
+static void sniff(uint channel, uint32_t value, uint size)
+{
+	uint32_t sniffCtrl = dma_hw->sniff_ctrl;
+	if (!(sniffCtrl & DMA_SNIFF_CTRL_EN_BITS)
+		|| !(ctrl(channel) & DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS)
+		|| ((sniffCtrl >> DMA_SNIFF_CTRL_DMACH_LSB) & 0xf) != channel)
+		return;
+
+	uint mode = (sniffCtrl >> DMA_SNIFF_CTRL_CALC_LSB) & 0xf;
+	if (mode == 0xf)
+	{
+		sniffRaw += value;
+	}
+	else
+	{
+		for (uint i = 0; i < size; i++)
+		{
+			uint shift = (sniffCtrl & DMA_SNIFF_CTRL_BSWAP_BITS) ? (size - 1 - i) * 8 : i * 8;
+			sniffByte(mode, value >> shift);
+		}
+	}
+
+	sniffShown = sniffRaw;
+	if (sniffCtrl & DMA_SNIFF_CTRL_OUT_REV_BITS)
+		sniffShown = reverse32(sniffShown);
+	if (sniffCtrl & DMA_SNIFF_CTRL_OUT_INV_BITS)
+		sniffShown = ~sniffShown;
+
+	dma_hw->sniff_data = sniffShown;
+}
+
+static uintptr_t advanceAddress(uint channel, uintptr_t address, uint size, bool write)
+{
+	uint32_t control = ctrl(channel);
+	uint ringBits = (control >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) & 0xf;
+	bool ringWrite = control & DMA_CH0_CTRL_TRIG_RING_SEL_BITS;
+
+	if (ringBits && ringWrite == write)
+	{
+		uintptr_t mask = (1u << ringBits) - 1;
+		return (address & ~mask) | ((address + size) & mask);
+	}
+
+	return address + size;
+}
+
+static void dmaComplete(uint channel)
+{
+	dma_hw->ch[channel].ctrl_trig &= ~DMA_CH0_CTRL_TRIG_BUSY_BITS;
+	if (chainTo(channel) != channel)
+		dmaTrigger(chainTo(channel));
+}
+
+// Move one element, returns false once the channel has finished
+static bool dmaStep(uint channel)
+{
+	dma_channel_hw_t &hw = dma_hw->ch[channel];
+	uint size = dataSize(channel);
+	uint32_t control = ctrl(channel);
+	uint32_t value = 0;
+	uint pioIndex, sm;
+
+	memcpy(&value, (const void *)hw.read_addr, size);
+
+	if (sim::pioTxAddress(hw.write_addr, &pioIndex, &sm))
+		sim::pioTxPut(pioIndex, sm, value);
+	else if (!sim::dmaRegisterWrite(hw.write_addr, value))
+		memcpy((void *)hw.write_addr, &value, size);
+
+	sniff(channel, value, size);
+
+	if (control & DMA_CH0_CTRL_TRIG_INCR_READ_BITS)
+		hw.read_addr = advanceAddress(channel, hw.read_addr, size, false);
+	if (control & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS)
+		hw.write_addr = advanceAddress(channel, hw.write_addr, size, true);
+
+	hw.al1_read_addr = hw.read_addr;
+	hw.al1_write_addr = hw.write_addr;
+	hw.transfer_count = (uint32_t)(hw.transfer_count - 1);
+	if (hw.transfer_count == 0)
+	{
+		dmaComplete(channel);
+		return false;
+	}
+
+	return busy(channel);
+}
+
+static void dmaTrigger(uint channel)
+{
+	dma_channel_hw_t &hw = dma_hw->ch[channel];
+	if (!(hw.ctrl_trig & DMA_CH0_CTRL_TRIG_EN_BITS))
+		return;
+
+	if ((hw.ctrl_trig & DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS) && dma_hw->sniff_data != sniffShown)
+		sniffRaw = sniffShown = dma_hw->sniff_data;
+
+	hw.ctrl_trig |= DMA_CH0_CTRL_TRIG_BUSY_BITS;
+	hw.al1_ctrl = hw.ctrl_trig;
+	if (hw.transfer_count == 0)
+	{
+		dmaComplete(channel);
+		return;
+	}
+
+	if (paced(treqSel(channel)))
+		return;
+
+	while (dmaStep(channel));
+}
+
+/* Simulator side */
+
+/**
+ * @brief Handle a DMA write into the channel registers, which is how one channel reprograms another.
+ */
+bool sim::dmaRegisterWrite(uintptr_t address, uint32_t value)
+{
+	uintptr_t base = (uintptr_t)&dma_hw->ch[0];
+	if (address == (uintptr_t)&dma_hw->sniff_data)
+	{
+		dma_hw->sniff_data = value;
+		return true;
+	}
+
+	if (address < base || address >= base + sizeof(dma_hw->ch))
+		return false;
+
+	uint channel = (address - base) / sizeof(dma_channel_hw_t);
+	uint field = ((address - base) % sizeof(dma_channel_hw_t)) / sizeof(uintptr_t);
+	dma_channel_hw_t &hw = dma_hw->ch[channel];
+	switch (field)
+	{
+		case 0: hw.read_addr = hw.al1_read_addr = value; break;
+		case 1: hw.write_addr = hw.al1_write_addr = value; break;
+		case 2: hw.transfer_count = value; break;
+		case 3: hw.ctrl_trig = hw.al1_ctrl = value; dmaTrigger(channel); break;
+		case 4: hw.ctrl_trig = hw.al1_ctrl = value; break;
+		case 5: hw.read_addr = hw.al1_read_addr = value; break;
+		case 6: hw.write_addr = hw.al1_write_addr = value; break;
+		case 7: hw.transfer_count = value; dmaTrigger(channel); break;
+	}
+
+	return true;
+}
+
+void sim::dmaRequest(uint dreq)
+{
+	for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+	{
+		if (busy(channel) && treqSel(channel) == dreq)
+		{
+			dmaStep(channel);
+			return;
+		}
+	}
+}
+
+/* SDK */
+
+int dma_claim_unused_channel(bool required)
+{
+	for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+	{
+		if (!(channelsClaimed & (1u << channel)))
+		{
+			channelsClaimed |= (1u << channel);
+			return channel;
+		}
+	}
+
+	if (required)
+		panic("No DMA channels are available");
+
+	return -1;
+}
+
+void dma_channel_claim(uint channel)
+{
+	channelsClaimed |= (1u << channel);
+}
+
+void dma_channel_unclaim(uint channel)
+{
+	channelsClaimed &= ~(1u << channel);
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger)
+{
+	dma_hw->ch[channel].ctrl_trig = dma_hw->ch[channel].al1_ctrl = config->ctrl;
+	if (trigger)
+		dmaTrigger(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger)
+{
+	dma_hw->ch[channel].read_addr = dma_hw->ch[channel].al1_read_addr = (uintptr_t)read_addr;
+	if (trigger)
+		dmaTrigger(channel);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger)
+{
+	dma_hw->ch[channel].write_addr = dma_hw->ch[channel].al1_write_addr = (uintptr_t)write_addr;
+	if (trigger)
+		dmaTrigger(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger)
+{
+	dma_hw->ch[channel].transfer_count = trans_count;
+	if (trigger)
+		dmaTrigger(channel);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+	dma_channel_set_read_addr(channel, read_addr, false);
+	dma_channel_set_write_addr(channel, write_addr, false);
+	dma_channel_set_trans_count(channel, transfer_count, false);
+	dma_channel_set_config(channel, config, trigger);
+}
+
+void dma_channel_start(uint channel)
+{
+	dmaTrigger(channel);
+}
+
+void dma_channel_abort(uint channel)
+{
+	dma_hw->ch[channel].ctrl_trig &= ~DMA_CH0_CTRL_TRIG_BUSY_BITS;
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+	return busy(channel);
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel)
+{
+	while (busy(channel))
+	{
+		if (sim::onCore0())
+			time_us_64();
+		else
+			std::this_thread::yield();
+	}
+}
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable)
+{
+	dma_hw->sniff_ctrl = DMA_SNIFF_CTRL_EN_BITS | (channel << DMA_SNIFF_CTRL_DMACH_LSB) | (mode << DMA_SNIFF_CTRL_CALC_LSB);
+	if (force_channel_enable)
+		dma_hw->ch[channel].ctrl_trig |= DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS;
+}
+
+void dma_sniffer_disable(void)
+{
+	dma_hw->sniff_ctrl = 0;
+}
+
+static void sniffCtrlBit(uint32_t bits, bool set)
+{
+	dma_hw->sniff_ctrl = set ? (dma_hw->sniff_ctrl | bits) : (dma_hw->sniff_ctrl & ~bits);
+}
+
+void dma_sniffer_set_byte_swap_enabled(bool swap)
+{
+	sniffCtrlBit(DMA_SNIFF_CTRL_BSWAP_BITS, swap);
+}
+
+void dma_sniffer_set_output_reverse_enabled(bool reverse)
+{
+	sniffCtrlBit(DMA_SNIFF_CTRL_OUT_REV_BITS, reverse);
+}
+
+void dma_sniffer_set_output_invert_enabled(bool invert)
+{
+	sniffCtrlBit(DMA_SNIFF_CTRL_OUT_INV_BITS, invert);
+}
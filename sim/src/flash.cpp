@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <atomic>
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+#include "pico/bootrom.h"
+#include "sim.h"
+
+#define SIM_FLASH_SIZE       PICO_FLASH_SIZE_BYTES
+#define SIM_FLASH_ERASE_US   45000 // Typical sector erase and page program times of the Pico's W25Q16JV
+#define SIM_FLASH_PROGRAM_US 400
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+static uint8_t *flash = nullptr;
+char *sim_flash_binary_end = nullptr;
+static uint32_t sectorErases[SIM_FLASH_SIZE / FLASH_SECTOR_SIZE] = { };
+static uint32_t flashOps = 0;
+static std::atomic<uint64_t> lastBusy(0);
+static watchdog_hw_t watchdogState = { };
+watchdog_hw_t *watchdog_hw = &watchdogState;
+
+/**
+ * @brief Map the flash image at the XIP address so the firmware can read it through plain pointers.
+ */
+void sim::flashMap(const char *file)
+{
+	void *address = mmap((void *)(uintptr_t)XIP_BASE, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (address != (void *)(uintptr_t)XIP_BASE)
+		panic("Unable to map flash at 0x%08x", XIP_BASE);
+
+	flash = (uint8_t *)address;
+	memset(flash, 0xFF, SIM_FLASH_SIZE);
+	sim_flash_binary_end = (char *)flash + sim::options.imageBytes;
+
+	if (file)
+	{
+		FILE *image = fopen(file, "rb");
+		if (image)
+		{
+			size_t length = fread(flash, 1, SIM_FLASH_SIZE, image);
+			fclose(image);
+			sim::emit("flash 0 load %zu\n", length);
+		}
+	}
+}
+
+void sim::flashSave()
+{
+	if (!options.flashFile)
+		return;
+
+	FILE *image = fopen(options.flashFile, "wb");
+	if (!image)
+		return;
+
+	fwrite(flash, 1, SIM_FLASH_SIZE, image);
+	fclose(image);
+}
+
+// Power lost part way through an erase or program leaves it half done
+static bool losePower(size_t *count)
+{
+	if (++flashOps != sim::options.powerLossOp)
+		return false;
+
+	*count /= 2;
+	return true;
+}
+
+uint32_t sim::flashErases(uint32_t offset)
+{
+	return sectorErases[offset / FLASH_SECTOR_SIZE];
+}
+
+uint64_t sim::flashLastBusy()
+{
+	return lastBusy;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+	if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs + count > SIM_FLASH_SIZE)
+		panic("Bad flash erase 0x%x+0x%zx", flash_offs, count);
+
+	bool lost = losePower(&count);
+	memset(flash + flash_offs, 0xFF, count);
+	for (size_t sector = flash_offs / FLASH_SECTOR_SIZE; sector < (flash_offs + count) / FLASH_SECTOR_SIZE; sector++)
+		sectorErases[sector]++;
+
+	sim::emit("flash %llu erase 0x%x %zu\n", (unsigned long long)sim::now(), flash_offs, count);
+	if (lost)
+		sim::finish(0, "power lost");
+
+	sim::stall(count / FLASH_SECTOR_SIZE * SIM_FLASH_ERASE_US);
+	lastBusy = sim::now();
+}
+
+// Programming can only clear bits, the same as NOR flash
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+	if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs + count > SIM_FLASH_SIZE)
+		panic("Bad flash program 0x%x+0x%zx", flash_offs, count);
+
+	bool lost = losePower(&count);
+	for (size_t i = 0; i < count; i++)
+		flash[flash_offs + i] &= data[i];
+
+	sim::emit("flash %llu program 0x%x %zu\n", (unsigned long long)sim::now(), flash_offs, count);
+	if (lost)
+		sim::finish(0, "power lost");
+
+	sim::stall(count / FLASH_PAGE_SIZE * SIM_FLASH_PROGRAM_US);
+	lastBusy = sim::now();
+}
+
+/* Watchdog and bootrom */
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+{
+	(void)pc;
+	(void)sp;
+	(void)delay_ms;
+	sim::finish(0, "watchdog reboot");
+}
+
+bool watchdog_caused_reboot(void)
+{
+	return false;
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+	(void)delay_ms;
+	(void)pause_on_debug;
+}
+
+void watchdog_update(void)
+{
+}
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask)
+{
+	(void)usb_activity_gpio_pin_mask;
+	(void)disable_interface_mask;
+	sim::finish(0, "reboot to BOOTSEL");
+}
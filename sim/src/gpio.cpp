@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "hardware/gpio.h"
+#include "sim.h"
+
+struct Pin
+{
+	enum gpio_function function = GPIO_FUNC_NULL;
+	bool output = false;
+	bool value = false;
+	bool pullUp = false;
+	bool pullDown = false;
+	int driven = -1; // Level forced by the script, -1 when released
+	uint32_t irqEvents = 0;
+};
+
+static Pin pins[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t irqCallback = nullptr;
+
+static bool pinLevel(uint gpio)
+{
+	const Pin &pin = pins[gpio];
+	if (pin.output)
+		return pin.value;
+	if (pin.driven >= 0)
+		return pin.driven;
+
+	return pin.pullUp;
+}
+
+/**
+ * @brief Change the level forced onto a pin from outside, firing edge interrupts like the IO bank would.
+ */
+void sim::gpioDrive(uint gpio, int level)
+{
+	bool before = pinLevel(gpio);
+	pins[gpio].driven = level;
+	bool after = pinLevel(gpio);
+
+	if (before == after || !irqCallback)
+		return;
+
+	uint32_t event = after ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+	if (pins[gpio].irqEvents & event)
+		irqCallback(gpio, event);
+}
+
+int sim::gpioDriven(uint gpio)
+{
+	return pins[gpio].driven;
+}
+
+void gpio_init(uint gpio)
+{
+	pins[gpio].function = GPIO_FUNC_SIO;
+	pins[gpio].output = false;
+	pins[gpio].value = false;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+	pins[gpio].function = fn;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+	pins[gpio].output = out;
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+	pins[gpio].pullUp = up;
+	pins[gpio].pullDown = down;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+	pins[gpio].value = value;
+}
+
+bool gpio_get(uint gpio)
+{
+	return pinLevel(gpio);
+}
+
+uint32_t gpio_get_all(void)
+{
+	uint32_t values = 0;
+	for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++)
+		values |= (uint32_t)pinLevel(gpio) << gpio;
+
+	return values;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+	if (enabled)
+		pins[gpio].irqEvents |= events;
+	else
+		pins[gpio].irqEvents &= ~events;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+	gpio_set_irq_enabled(gpio, events, enabled);
+	if (enabled)
+		irqCallback = callback;
+}
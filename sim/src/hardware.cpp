@@ -0,0 +1,285 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pll.h"
+#include "hardware/pwm.h"
+#include "sim.h"
+
+#define SIM_PWM_SLICES      8
+#define SIM_USER_IRQ_FIRST 26
+
+/* Clocks, changes to clk_sys and clk_peri are logged but don't change the cost of anything */
+
+static uint32_t sysClockHz = 125000000;
+static bool sysFromPllSys = true;
+static uint32_t loggedSysHz = 125000000;
+static uint32_t loggedPeriHz = 125000000;
+
+// As clocks_init() leaves them: a 1500MHz VCO divided by 6 and 2 for clk_sys, 1200MHz by 5 and 5 for USB
+static pll_hw_t pllSys = { 1, 0, 125, (6 << PLL_PRIM_POSTDIV1_LSB) | (2 << PLL_PRIM_POSTDIV2_LSB) };
+static pll_hw_t pllUsb = { 1, 0, 100, (5 << PLL_PRIM_POSTDIV1_LSB) | (5 << PLL_PRIM_POSTDIV2_LSB) };
+pll_hw_t *const pll_sys = &pllSys;
+pll_hw_t *const pll_usb = &pllUsb;
+
+// clk_peri starts out on clk_sys, AUXSRC 0
+static clocks_hw_t clocksState = { };
+clocks_hw_t *clocks_hw = &clocksState;
+
+static inline bool pllRunning(pll_hw_t *pll)
+{
+	return !(pll->pwr & PLL_PWR_PD_BITS);
+}
+
+static uint32_t pllOutputHz(pll_hw_t *pll)
+{
+	if (!pllRunning(pll))
+		return 0;
+
+	uint32_t refDiv = (pll->cs & PLL_CS_REFDIV_BITS) >> PLL_CS_REFDIV_LSB;
+	uint32_t postDiv1 = (pll->prim & PLL_PRIM_POSTDIV1_BITS) >> PLL_PRIM_POSTDIV1_LSB;
+	uint32_t postDiv2 = (pll->prim & PLL_PRIM_POSTDIV2_BITS) >> PLL_PRIM_POSTDIV2_LSB;
+	return (uint64_t)XOSC_MHZ * MHZ / refDiv * (pll->fbdiv_int & PLL_FBDIV_INT_BITS) / (postDiv1 * postDiv2);
+}
+
+static uint32_t periClockHz()
+{
+	switch ((clocks_hw->clk[clk_peri].ctrl & CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS) >> CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB)
+	{
+		case CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS:        return sysClockHz;
+		case CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS: return pllOutputHz(pll_sys);
+		case CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB: return pllOutputHz(pll_usb);
+		default:                                              return 0;
+	}
+}
+
+static void clocksChanged()
+{
+	uint32_t periHz = periClockHz();
+	if (sysClockHz == loggedSysHz && periHz == loggedPeriHz)
+		return;
+
+	bool sysChanged = sysClockHz != loggedSysHz;
+	loggedSysHz = sysClockHz;
+	loggedPeriHz = periHz;
+	sim::emit("clock %llu sys %u peri %u\n", (unsigned long long)sim::now(), sysClockHz, periHz);
+	if (sysChanged)
+		sim::pioClockChanged();
+}
+
+static void setSysClock(uint32_t hz, bool fromPllSys)
+{
+	// The chip would hang running from a stopped PLL
+	if (fromPllSys && !pllRunning(pll_sys))
+		sim::finish(1, "clk_sys switched to the stopped system PLL");
+
+	if (fromPllSys && hz != pllOutputHz(pll_sys))
+		sim::finish(1, "clk_sys set to a different speed than the system PLL runs at");
+
+	sysFromPllSys = fromPllSys;
+	sysClockHz = hz;
+	clocksChanged();
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+	switch (clk_index)
+	{
+		case clk_ref:  return 12000000;
+		case clk_peri: return periClockHz();
+		case clk_usb:  return 48000000;
+		case clk_adc:  return 48000000;
+		case clk_rtc:  return 46875;
+		default:       return sysClockHz;
+	}
+}
+
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq)
+{
+	if (clk_index == clk_sys)
+		setSysClock(freq, src == CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX && auxsrc == CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS);
+
+	// clk_peri has no divider, it runs at its source's speed
+	if (clk_index == clk_peri)
+	{
+		clocks_hw->clk[clk_peri].ctrl = auxsrc << CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB;
+		if (src_freq != freq || freq != periClockHz())
+			sim::finish(1, "clk_peri set to a different speed than its source runs at");
+
+		clocksChanged();
+	}
+
+	return true;
+}
+
+// Picks the PLL settings the way the SDK does, and like the SDK moves clk_peri to the USB PLL's 48MHz
+bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+	uint32_t referenceKhz = XOSC_MHZ * 1000;
+	for (uint32_t fbdiv = 320; fbdiv >= 16; fbdiv--)
+	{
+		uint32_t vcoKhz = fbdiv * referenceKhz;
+		if (vcoKhz < 400000 || vcoKhz > 1600000)
+			continue;
+
+		for (uint32_t postDiv1 = 7; postDiv1 >= 1; postDiv1--)
+		{
+			for (uint32_t postDiv2 = postDiv1; postDiv2 >= 1; postDiv2--)
+			{
+				if (vcoKhz / (postDiv1 * postDiv2) != freq_khz || vcoKhz % (postDiv1 * postDiv2))
+					continue;
+
+				clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, 12000000, 12000000);
+				pll_init(pll_sys, 1, vcoKhz * 1000, postDiv1, postDiv2);
+				clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+					freq_khz * 1000, freq_khz * 1000);
+				clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 48000000, 48000000);
+				return true;
+			}
+		}
+	}
+
+	if (required)
+		sim::finish(1, "clk_sys speed can't be made by the system PLL");
+
+	return false;
+}
+
+void pll_init(pll_hw_t *pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2)
+{
+	if (pll == pll_sys && sysFromPllSys)
+		sim::finish(1, "system PLL changed while clk_sys runs from it");
+
+	pll->cs = ref_div;
+	pll->fbdiv_int = vco_freq / (XOSC_MHZ * MHZ / ref_div);
+	pll->prim = (post_div1 << PLL_PRIM_POSTDIV1_LSB) | (post_div2 << PLL_PRIM_POSTDIV2_LSB);
+	pll->pwr = 0;
+	clocksChanged();
+}
+
+void pll_deinit(pll_hw_t *pll)
+{
+	if (pll == pll_sys && sysFromPllSys)
+		sim::finish(1, "system PLL stopped while clk_sys runs from it");
+
+	pll->pwr = PLL_PWR_PD_BITS;
+	clocksChanged();
+}
+
+/* IRQs, a pending IRQ runs straight away on the calling core */
+
+static irq_handler_t irqHandlers[NUM_IRQS] = { };
+static uint32_t irqEnabled = 0;
+static uint32_t irqPending = 0;
+static uint32_t userIrqsClaimed = 0;
+
+static void irqDispatch(uint num)
+{
+	if ((irqEnabled & (1u << num)) && (irqPending & (1u << num)) && irqHandlers[num])
+	{
+		irqPending &= ~(1u << num);
+		irqHandlers[num]();
+	}
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+	irqEnabled = enabled ? (irqEnabled | (1u << num)) : (irqEnabled & ~(1u << num));
+	irqDispatch(num);
+}
+
+bool irq_is_enabled(uint num)
+{
+	return irqEnabled & (1u << num);
+}
+
+void irq_set_pending(uint num)
+{
+	irqPending |= (1u << num);
+	irqDispatch(num);
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority)
+{
+	(void)num;
+	(void)hardware_priority;
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+	irqHandlers[num] = handler;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+	(void)order_priority;
+	irqHandlers[num] = handler;
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler)
+{
+	if (irqHandlers[num] == handler)
+		irqHandlers[num] = nullptr;
+}
+
+int user_irq_claim_unused(bool required)
+{
+	for (uint num = SIM_USER_IRQ_FIRST; num < NUM_IRQS; num++)
+	{
+		if (!(userIrqsClaimed & (1u << num)))
+		{
+			userIrqsClaimed |= (1u << num);
+			return num;
+		}
+	}
+
+	if (required)
+		panic("No user IRQs are available");
+
+	return -1;
+}
+
+void user_irq_unclaim(uint irq_num)
+{
+	userIrqsClaimed &= ~(1u << irq_num);
+}
+
+/* PWM, level changes are logged */
+
+static uint16_t pwmLevels[SIM_PWM_SLICES][2];
+static uint16_t pwmWraps[SIM_PWM_SLICES] = { 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff };
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+	(void)start;
+	pwmWraps[slice_num] = c->top;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+	pwmWraps[slice_num] = wrap;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level)
+{
+	if (pwmLevels[slice_num][chan] == level)
+		return;
+
+	pwmLevels[slice_num][chan] = level;
+	sim::emit("pwm %llu %u%c %u/%u\n", (unsigned long long)sim::now(), slice_num, chan ? 'B' : 'A', level, pwmWraps[slice_num]);
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+	pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+	(void)slice_num;
+	(void)enabled;
+}
@@ -0,0 +1,227 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "pico/time.h"
+#include "sim.h"
+
+#define SIM_OLED_ADDRESS 0x3C
+#define SIM_OLED_WIDTH   132 // SH1106 RAM width, the SSD1306 uses the first 128 columns
+#define SIM_OLED_PAGES   8
+#define SIM_OLED_STATUS  0x03 // SSD1306 status register, detected as an SSD1306 by OneBitDisplay
+
+struct i2c_inst { uint index; uint baudrate; };
+struct spi_inst { uint index; };
+
+static i2c_inst i2cBlocks[2] = { { 0, 100000 }, { 1, 100000 } };
+i2c_inst_t *i2c0 = &i2cBlocks[0];
+i2c_inst_t *i2c1 = &i2cBlocks[1];
+
+static spi_inst spiBlocks[2] = { { 0 }, { 1 } };
+spi_inst_t *spi0 = &spiBlocks[0];
+spi_inst_t *spi1 = &spiBlocks[1];
+
+/**
+ * @brief Minimal SSD1306/SH1106 model: tracks the addressing commands and writes data into GDDRAM.
+ */
+struct Oled
+{
+	uint8_t ram[SIM_OLED_PAGES][SIM_OLED_WIDTH];
+	uint8_t addressingMode = 2; // Page addressing
+	uint8_t column = 0;
+	uint8_t page = 0;
+	uint8_t columnStart = 0;
+	uint8_t columnEnd = 127;
+	uint8_t pageStart = 0;
+	uint8_t pageEnd = SIM_OLED_PAGES - 1;
+	uint8_t command[8];
+	uint8_t commandLength = 0;
+	bool on = false;
+	uint32_t writes = 0;
+};
+
+static Oled oled;
+static std::mutex oledLock;
+
+static uint8_t commandArgs(uint8_t command)
+{
+	switch (command)
+	{
+		case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+			return 1;
+		case 0x21: case 0x22: case 0xA3:
+			return 2;
+		case 0x29: case 0x2A:
+			return 5;
+		case 0x26: case 0x27:
+			return 6;
+		default:
+			return 0;
+	}
+}
+
+static void oledCommand(uint8_t byte)
+{
+	oled.command[oled.commandLength++] = byte;
+	if (oled.commandLength <= commandArgs(oled.command[0]))
+		return;
+
+	uint8_t *c = oled.command;
+	oled.commandLength = 0;
+
+	if (c[0] <= 0x0F)
+		oled.column = (oled.column & 0xF0) | c[0];
+	else if (c[0] <= 0x1F)
+		oled.column = (oled.column & 0x0F) | ((c[0] & 0x0F) << 4);
+	else if (c[0] >= 0xB0 && c[0] <= 0xB7)
+		oled.page = c[0] & 0x07;
+	else if (c[0] == 0x20)
+		oled.addressingMode = c[1] & 0x03;
+	else if (c[0] == 0x21)
+		oled.column = oled.columnStart = c[1], oled.columnEnd = c[2];
+	else if (c[0] == 0x22)
+		oled.page = oled.pageStart = c[1] & 0x07, oled.pageEnd = c[2] & 0x07;
+	else if (c[0] == 0xAE || c[0] == 0xAF)
+		oled.on = c[0] & 1;
+}
+
+static void oledData(uint8_t byte)
+{
+	if (oled.column < SIM_OLED_WIDTH)
+		oled.ram[oled.page][oled.column] = byte;
+
+	oled.writes++;
+	if (oled.addressingMode == 2)
+	{
+		oled.column++;
+		return;
+	}
+
+	if (oled.column++ >= oled.columnEnd)
+	{
+		oled.column = oled.columnStart;
+		oled.page = (oled.page >= oled.pageEnd) ? oled.pageStart : oled.page + 1;
+	}
+}
+
+static void oledWrite(const uint8_t *src, size_t len)
+{
+	std::lock_guard<std::mutex> guard(oledLock);
+	size_t i = 0;
+	while (i < len)
+	{
+		uint8_t control = src[i++];
+		bool data = control & 0x40;
+		bool single = control & 0x80; // Continuation bit, one byte follows before the next control byte
+		size_t end = single ? std::min(i + 1, len) : len;
+		for (; i < end; i++)
+		{
+			if (data)
+				oledData(src[i]);
+			else
+				oledCommand(src[i]);
+		}
+	}
+}
+
+void sim::oledDump(const char *file)
+{
+	std::lock_guard<std::mutex> guard(oledLock);
+	FILE *image = fopen(file, "w");
+	if (!image)
+		return;
+
+	fprintf(image, "P1\n# %s, %u data writes\n%d %d\n", oled.on ? "on" : "off", oled.writes, 128, SIM_OLED_PAGES * 8);
+	for (int y = 0; y < SIM_OLED_PAGES * 8; y++)
+	{
+		for (int x = 0; x < 128; x++)
+			fputs((oled.ram[y / 8][x] >> (y % 8)) & 1 ? "1" : "0", image);
+		fputc('\n', image);
+	}
+
+	fclose(image);
+	sim::emit("oled %llu %s\n", (unsigned long long)sim::now(), file);
+}
+
+/* I2C */
+
+// A transfer takes its bus time: the address and every byte are nine clocks with the ACK
+static void i2cTransfer(i2c_inst_t *i2c, size_t len)
+{
+	uint64_t us = (len + 1) * 9 * 1000000ull / i2c->baudrate;
+	busy_wait_us(us);
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+	i2c->baudrate = baudrate;
+	return baudrate;
+}
+
+void i2c_deinit(i2c_inst_t *i2c)
+{
+	(void)i2c;
+}
+
+uint i2c_hw_index(i2c_inst_t *i2c)
+{
+	return i2c->index;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+	(void)nostop;
+	if (addr != SIM_OLED_ADDRESS)
+	{
+		i2cTransfer(i2c, 0);
+		return -2; // PICO_ERROR_GENERIC, no device acknowledged
+	}
+
+	i2cTransfer(i2c, len);
+	oledWrite(src, len);
+	return len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+	(void)nostop;
+	if (addr != SIM_OLED_ADDRESS)
+	{
+		i2cTransfer(i2c, 0);
+		return -2;
+	}
+
+	i2cTransfer(i2c, len);
+	memset(dst, SIM_OLED_STATUS, len);
+	return len;
+}
+
+/* SPI, nothing is attached */
+
+uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+	(void)spi;
+	return baudrate;
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order)
+{
+	(void)spi;
+	(void)data_bits;
+	(void)cpol;
+	(void)cpha;
+	(void)order;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+	(void)spi;
+	(void)src;
+	return len;
+}
@@ -0,0 +1,238 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/sync.h"
+#include "sim.h"
+
+#define SIM_SPIN_LOCK_COUNT       32
+#define SIM_SPIN_LOCK_FIRST_CLAIM 24 // The SDK reserves the lower locks for itself
+#define SIM_LOCKOUT_TIMEOUT_MS    2  // Wall time to wait for core1 to be held
+
+static thread_local uint coreNum = 0;
+static std::thread core1Thread;
+
+static std::atomic<bool> lockoutVictim(false);
+static std::atomic<bool> lockoutRequested(false);
+static std::atomic<bool> core1LockedOut(false);
+
+static spin_lock_t spinLocks[SIM_SPIN_LOCK_COUNT];
+static uint32_t spinLocksClaimed = 0;
+
+bool sim::onCore0()
+{
+	return coreNum == 0;
+}
+
+uint get_core_num(void)
+{
+	return coreNum;
+}
+
+/* Multicore */
+
+void multicore_launch_core1(void (*entry)(void))
+{
+	core1Thread = std::thread([entry]()
+	{
+		coreNum = 1;
+		entry();
+	});
+	core1Thread.detach();
+}
+
+void multicore_reset_core1(void)
+{
+	sim::finish(1, "multicore_reset_core1 isn't supported");
+}
+
+/**
+ * @brief core1 is held the way the SDK's lockout handler holds it, as soon as it next calls into the
+ * sim: a clock read, a sleep or an event wait. Its sleeps and frames run late by as long as core0
+ * keeps it held, so LED pacing shows what a flash write costs it.
+ */
+void multicore_lockout_victim_init(void)
+{
+	lockoutVictim = true;
+}
+
+void multicore_lockout_start_blocking(void)
+{
+	if (!lockoutVictim)
+		return;
+
+	// A core1 loop that never calls into the sim can't be told, it is taken as held
+	lockoutRequested = true;
+	auto start = std::chrono::steady_clock::now();
+	while (!core1LockedOut && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(SIM_LOCKOUT_TIMEOUT_MS))
+		std::this_thread::yield();
+}
+
+void multicore_lockout_end_blocking(void)
+{
+	if (!lockoutVictim)
+		return;
+
+	lockoutRequested = false;
+	while (core1LockedOut)
+		std::this_thread::yield();
+}
+
+void sim::core1Lockout()
+{
+	if (!lockoutRequested)
+		return;
+
+	core1LockedOut = true;
+	while (lockoutRequested)
+		std::this_thread::yield();
+	core1LockedOut = false;
+}
+
+/* Events */
+
+// Nothing raises events on the host, so a waiting core1 yields and checks again
+void __wfe(void)
+{
+	if (!sim::onCore0())
+	{
+		sim::core1Idle();
+		sim::core1Lockout();
+	}
+
+	std::this_thread::yield();
+}
+
+/* Spin locks */
+
+spin_lock_t *spin_lock_instance(uint lock_num)
+{
+	return &spinLocks[lock_num];
+}
+
+uint spin_lock_claim_unused(bool required)
+{
+	for (uint i = SIM_SPIN_LOCK_FIRST_CLAIM; i < SIM_SPIN_LOCK_COUNT; i++)
+	{
+		if (!(spinLocksClaimed & (1u << i)))
+		{
+			spinLocksClaimed |= (1u << i);
+			return i;
+		}
+	}
+
+	if (required)
+		panic("No spin locks are available");
+
+	return (uint)-1;
+}
+
+void spin_lock_unclaim(uint lock_num)
+{
+	spinLocksClaimed &= ~(1u << lock_num);
+}
+
+bool is_spin_locked(spin_lock_t *lock)
+{
+	return __atomic_load_n(lock, __ATOMIC_ACQUIRE) != 0;
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock)
+{
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+		std::this_thread::yield();
+
+	return 0;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq)
+{
+	(void)saved_irq;
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Queues */
+
+void queue_init(queue_t *q, uint element_size, uint element_count)
+{
+	q->lock = new std::mutex();
+	q->data = (uint8_t *)calloc(element_count + 1, element_size);
+	q->element_size = element_size;
+	q->element_count = element_count;
+	q->wptr = 0;
+	q->rptr = 0;
+}
+
+void queue_free(queue_t *q)
+{
+	delete (std::mutex *)q->lock;
+	free(q->data);
+	q->lock = nullptr;
+	q->data = nullptr;
+}
+
+static inline uint16_t queue_next(queue_t *q, uint16_t index)
+{
+	return (index + 1) % (q->element_count + 1);
+}
+
+uint queue_get_level(queue_t *q)
+{
+	std::lock_guard<std::mutex> guard(*(std::mutex *)q->lock);
+	int level = q->wptr - q->rptr;
+	return (level < 0) ? level + q->element_count + 1 : level;
+}
+
+bool queue_try_add(queue_t *q, const void *data)
+{
+	std::lock_guard<std::mutex> guard(*(std::mutex *)q->lock);
+	uint16_t next = queue_next(q, q->wptr);
+	if (next == q->rptr)
+		return false;
+
+	memcpy(q->data + q->wptr * q->element_size, data, q->element_size);
+	q->wptr = next;
+	return true;
+}
+
+bool queue_try_peek(queue_t *q, void *data)
+{
+	std::lock_guard<std::mutex> guard(*(std::mutex *)q->lock);
+	if (q->rptr == q->wptr)
+		return false;
+
+	memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+	return true;
+}
+
+bool queue_try_remove(queue_t *q, void *data)
+{
+	std::lock_guard<std::mutex> guard(*(std::mutex *)q->lock);
+	if (q->rptr == q->wptr)
+		return false;
+
+	memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+	q->rptr = queue_next(q, q->rptr);
+	return true;
+}
+
+void queue_add_blocking(queue_t *q, const void *data)
+{
+	while (!queue_try_add(q, data))
+		std::this_thread::yield();
+}
+
+void queue_remove_blocking(queue_t *q, void *data)
+{
+	while (!queue_try_remove(q, data))
+		std::this_thread::yield();
+}
@@ -0,0 +1,59 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "class/net/net_device.h"
+#include "rndis/rndis.h"
+#include "sim.h"
+
+// The web configurator needs lwIP and a host network, so config mode ends the simulation
+
+int rndis_init(void)
+{
+	sim::finish(0, "config mode isn't simulated");
+}
+
+void rndis_task(void)
+{
+}
+
+void netd_init(void)
+{
+}
+
+void netd_reset(uint8_t rhport)
+{
+	(void)rhport;
+}
+
+uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len)
+{
+	(void)rhport;
+	(void)itf_desc;
+	(void)max_len;
+	return 0;
+}
+
+bool netd_control_request(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+	return false;
+}
+
+bool netd_control_complete(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+	return false;
+}
+
+bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+	(void)rhport;
+	(void)ep_addr;
+	(void)result;
+	(void)xferred_bytes;
+	return false;
+}
@@ -0,0 +1,331 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "sim.h"
+
+#define SIM_PIO_FRAME_GAP_US 50 // WS2812 latches after the data line idles this long
+
+/**
+ * @brief State machines aren't executed. Output words are captured as they are pushed, and a state
+ * machine that starts on an `in pins` instruction is treated as a sampler that pushes the GPIO word
+ * once per loop of its program.
+ */
+struct StateMachine
+{
+	bool claimed = false;
+	bool enabled = false;
+	bool sampler = false;
+	double periodUs = 0;
+	double nextSampleUs = 0;
+	uint pc = 0;
+	pio_sm_config config;
+	std::vector<uint32_t> frame;
+	uint64_t frameStart = 0;
+	uint64_t lastPut = 0;
+	uint64_t lastFrameStart = SIM_NEVER;
+};
+
+struct PioBlock
+{
+	pio_hw_t hw;
+	uint32_t usedInstructions;
+	uint16_t instructions[PIO_INSTRUCTION_COUNT];
+	StateMachine sm[NUM_PIO_STATE_MACHINES];
+};
+
+static PioBlock blocks[NUM_PIOS];
+PIO pio0 = &blocks[0].hw;
+PIO pio1 = &blocks[1].hw;
+
+static std::mutex frameLock;
+static uint32_t framesCaptured = 0;
+static std::vector<uint32_t> frameIntervals;
+static uint32_t flashIntervals = 0;   // Intervals a flash erase or program finished in
+static uint32_t flashIntervalMax = 0;
+
+static inline PioBlock &block(PIO pio)
+{
+	return blocks[pio_get_index(pio)];
+}
+
+static void flushFrame(uint pioIndex, uint sm)
+{
+	StateMachine &state = blocks[pioIndex].sm[sm];
+	if (state.frame.empty())
+		return;
+
+	std::string words;
+	char word[10];
+	for (uint32_t value : state.frame)
+	{
+		snprintf(word, sizeof(word), " %08x", value);
+		words += word;
+	}
+
+	sim::emit("led %llu pio%u.%u %zu%s\n", (unsigned long long)state.frameStart, pioIndex, sm, state.frame.size(), words.c_str());
+	state.frame.clear();
+	framesCaptured++;
+
+	// Frame pacing, and how a flash write that falls between two frames stretches it
+	if (state.lastFrameStart != SIM_NEVER)
+	{
+		uint32_t interval = state.frameStart - state.lastFrameStart;
+		frameIntervals.push_back(interval);
+		uint64_t flashBusy = sim::flashLastBusy();
+		if (flashBusy > state.lastFrameStart && flashBusy <= state.frameStart)
+		{
+			flashIntervals++;
+			flashIntervalMax = std::max(flashIntervalMax, interval);
+		}
+	}
+	state.lastFrameStart = state.frameStart;
+}
+
+uint pio_get_index(PIO pio)
+{
+	return (pio == pio1) ? 1 : 0;
+}
+
+static int findProgramOffset(PIO pio, const pio_program_t *program)
+{
+	uint32_t mask = (1u << program->length) - 1;
+	if (program->origin >= 0)
+		return (block(pio).usedInstructions & (mask << program->origin)) ? -1 : program->origin;
+
+	for (int offset = PIO_INSTRUCTION_COUNT - program->length; offset >= 0; offset--)
+		if (!(block(pio).usedInstructions & (mask << offset)))
+			return offset;
+
+	return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program)
+{
+	return findProgramOffset(pio, program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+	int offset = findProgramOffset(pio, program);
+	if (offset < 0)
+		panic("No program space");
+
+	PioBlock &pioBlock = block(pio);
+	pioBlock.usedInstructions |= ((1u << program->length) - 1) << offset;
+	memcpy(&pioBlock.instructions[offset], program->instructions, program->length * sizeof(uint16_t));
+
+	return offset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset)
+{
+	block(pio).usedInstructions &= ~(((1u << program->length) - 1) << loaded_offset);
+}
+
+void pio_gpio_init(PIO pio, uint pin)
+{
+	gpio_set_function(pin, pio_get_index(pio) ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out)
+{
+	(void)pio;
+	(void)sm;
+	for (uint pin = pin_base; pin < pin_base + pin_count; pin++)
+		gpio_set_dir(pin, is_out);
+}
+
+// A state machine's clock is clk_sys through its divider, a sampler's rate follows changes to either
+static void retime(uint pioIndex, uint sm)
+{
+	StateMachine &state = blocks[pioIndex].sm[sm];
+	double periodUs = state.config.clkdiv * (state.config.wrap - state.config.wrap_target + 1) * 1e6 / clock_get_hz(clk_sys);
+	if (periodUs == state.periodUs)
+		return;
+
+	state.periodUs = periodUs;
+	if (state.enabled && state.sampler)
+		sim::emit("sampler %llu pio%u.%u rate %.0f\n", (unsigned long long)sim::now(), pioIndex, sm, 1e6 / periodUs);
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config)
+{
+	StateMachine &state = block(pio).sm[sm];
+	uint16_t instruction = block(pio).instructions[initial_pc];
+
+	state.enabled = false;
+	state.pc = initial_pc;
+	state.config = *config;
+	state.sampler = (instruction & 0xE0E0) == 0x4000; // in pins, n
+	state.periodUs = config->clkdiv * (config->wrap - config->wrap_target + 1) * 1e6 / clock_get_hz(clk_sys);
+	pio_sm_clear_fifos(pio, sm);
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+	StateMachine &state = block(pio).sm[sm];
+	state.enabled = enabled;
+	state.nextSampleUs = sim::now() + state.periodUs;
+	sim::reschedule();
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div)
+{
+	block(pio).sm[sm].config.clkdiv = div;
+	retime(pio_get_index(pio), sm);
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm)
+{
+	pio->rxf[sm] = 0;
+	pio->txf[sm] = 0;
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data)
+{
+	pio->txf[sm] = data;
+	sim::pioTxPut(pio_get_index(pio), sm, data);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+	for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+	{
+		if (!block(pio).sm[sm].claimed)
+		{
+			block(pio).sm[sm].claimed = true;
+			return sm;
+		}
+	}
+
+	if (required)
+		panic("No PIO state machines are available");
+
+	return -1;
+}
+
+void pio_sm_claim(PIO pio, uint sm)
+{
+	block(pio).sm[sm].claimed = true;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm)
+{
+	block(pio).sm[sm].claimed = false;
+}
+
+/* Simulator side */
+
+void sim::pioTxPut(uint pioIndex, uint sm, uint32_t value)
+{
+	std::lock_guard<std::mutex> guard(frameLock);
+	StateMachine &state = blocks[pioIndex].sm[sm];
+	uint64_t current = now();
+
+	if (!state.frame.empty() && current - state.lastPut >= SIM_PIO_FRAME_GAP_US)
+		flushFrame(pioIndex, sm);
+
+	if (state.frame.empty())
+	{
+		state.frameStart = current;
+		reschedule();
+	}
+
+	state.frame.push_back(value);
+	state.lastPut = current;
+}
+
+bool sim::pioTxAddress(uintptr_t address, uint *pioIndex, uint *sm)
+{
+	for (uint i = 0; i < NUM_PIOS; i++)
+	{
+		uintptr_t base = (uintptr_t)&blocks[i].hw.txf[0];
+		if (address >= base && address < base + sizeof(blocks[i].hw.txf))
+		{
+			*pioIndex = i;
+			*sm = (address - base) / sizeof(uint32_t);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void sim::pioRxPush(uint pioIndex, uint sm, uint32_t value)
+{
+	blocks[pioIndex].hw.rxf[sm] = value;
+	dmaRequest((pioIndex << 3) + sm + NUM_PIO_STATE_MACHINES);
+}
+
+void sim::pioClockChanged()
+{
+	for (uint i = 0; i < NUM_PIOS; i++)
+		for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+			retime(i, sm);
+}
+
+uint64_t sim::pioNext()
+{
+	uint64_t next = SIM_NEVER;
+	std::lock_guard<std::mutex> guard(frameLock);
+	for (auto &pioBlock : blocks)
+	{
+		for (auto &state : pioBlock.sm)
+		{
+			if (state.enabled && state.sampler)
+				next = std::min(next, (uint64_t)ceil(state.nextSampleUs));
+			if (!state.frame.empty())
+				next = std::min(next, state.lastPut + SIM_PIO_FRAME_GAP_US);
+		}
+	}
+
+	return next;
+}
+
+void sim::pioRun(uint64_t now)
+{
+	for (uint i = 0; i < NUM_PIOS; i++)
+	{
+		for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+		{
+			StateMachine &state = blocks[i].sm[sm];
+			while (state.enabled && state.sampler && state.nextSampleUs <= now)
+			{
+				pioRxPush(i, sm, gpio_get_all());
+				state.nextSampleUs += state.periodUs;
+			}
+
+			std::lock_guard<std::mutex> guard(frameLock);
+			if (!state.frame.empty() && now - state.lastPut >= SIM_PIO_FRAME_GAP_US)
+				flushFrame(i, sm);
+		}
+	}
+}
+
+void sim::pioSummary()
+{
+	std::lock_guard<std::mutex> guard(frameLock);
+	for (uint i = 0; i < NUM_PIOS; i++)
+		for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+			flushFrame(i, sm);
+
+	fprintf(stderr, "sim: %u LED frames\n", framesCaptured);
+	if (frameIntervals.empty())
+		return;
+
+	std::sort(frameIntervals.begin(), frameIntervals.end());
+	sim::emit("leds %llu interval count %zu min %u p50 %u max %u flash count %u max %u\n", (unsigned long long)sim::now(),
+		frameIntervals.size(), frameIntervals.front(), frameIntervals[frameIntervals.size() / 2], frameIntervals.back(),
+		flashIntervals, flashIntervalMax);
+}
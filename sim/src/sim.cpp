@@ -0,0 +1,616 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FlashPROM.h"
+#include "gamepad.h"
+#include "inputtrace.h"
+#include "latency.h"
+#include "modeswitch.h"
+#include "pollstats.h"
+#include "power.h"
+#include "storage.h"
+#include "sim.h"
+
+// The firmware entry point is renamed by the build flags so the simulator can own main()
+#undef main
+extern int gp2040_main();
+extern Gamepad gamepad;
+
+#define SIM_DEFAULT_TAIL_US 100000 // Keep running this long after the last scripted event
+
+enum ScriptAction
+{
+	SCRIPT_DRIVE,
+	SCRIPT_OUT,
+	SCRIPT_OLED,
+	SCRIPT_TRACE_CONFIG,
+	SCRIPT_SUSPEND,
+	SCRIPT_RESUME,
+	SCRIPT_END,
+};
+
+struct ScriptEvent
+{
+	uint64_t time;
+	ScriptAction action;
+	std::string target; // Button name or GPIO number for SCRIPT_DRIVE, file for SCRIPT_OLED
+	int level;
+	std::string data; // Report bytes for SCRIPT_OUT, an InputTraceConfig for SCRIPT_TRACE_CONFIG
+	int line;
+};
+
+struct ButtonName
+{
+	const char *name;
+	size_t offset;
+};
+
+// Same order as the gamepad mappings and the pins of an input trace
+static const ButtonName buttonNames[] =
+{
+	{ "up",    offsetof(BoardOptions, pinDpadUp) },
+	{ "down",  offsetof(BoardOptions, pinDpadDown) },
+	{ "left",  offsetof(BoardOptions, pinDpadLeft) },
+	{ "right", offsetof(BoardOptions, pinDpadRight) },
+	{ "b1",    offsetof(BoardOptions, pinButtonB1) },
+	{ "b2",    offsetof(BoardOptions, pinButtonB2) },
+	{ "b3",    offsetof(BoardOptions, pinButtonB3) },
+	{ "b4",    offsetof(BoardOptions, pinButtonB4) },
+	{ "l1",    offsetof(BoardOptions, pinButtonL1) },
+	{ "r1",    offsetof(BoardOptions, pinButtonR1) },
+	{ "l2",    offsetof(BoardOptions, pinButtonL2) },
+	{ "r2",    offsetof(BoardOptions, pinButtonR2) },
+	{ "s1",    offsetof(BoardOptions, pinButtonS1) },
+	{ "s2",    offsetof(BoardOptions, pinButtonS2) },
+	{ "l3",    offsetof(BoardOptions, pinButtonL3) },
+	{ "r3",    offsetof(BoardOptions, pinButtonR3) },
+	{ "a1",    offsetof(BoardOptions, pinButtonA1) },
+	{ "a2",    offsetof(BoardOptions, pinButtonA2) },
+};
+
+sim::Options sim::options;
+
+static FILE *output = stdout;
+static std::mutex outputLock;
+static std::vector<ScriptEvent> script;
+static size_t scriptIndex = 0;
+static std::atomic<bool> finishing(false);
+static std::chrono::steady_clock::time_point wallStart;
+
+/* Event log */
+
+void sim::emit(const char *format, ...)
+{
+	std::lock_guard<std::mutex> guard(outputLock);
+	va_list args;
+	va_start(args, format);
+	vfprintf(output, format, args);
+	va_end(args);
+}
+
+// Writes the firmware's input trace in the /api/getInputTrace format
+static void traceSave(const char *file)
+{
+	FILE *out = fopen(file, "wb");
+	if (!out || !inputTrace.dump || fwrite(inputTrace.dump, sizeof(InputTraceDump), 1, out) != 1)
+		perror(file);
+	if (out)
+		fclose(out);
+}
+
+// Per-stage input latency from the firmware's own tracer, in microseconds from the pin edge
+static void latencySummary()
+{
+	static const char *stageNames[LATENCY_STAGE_COUNT] = { "read", "debounce", "process", "send", "complete" };
+
+	LatencyStats *stats = latencyTracer.stats;
+	if (!stats || !stats->traces)
+		return;
+
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+	{
+		LatencyStage stage = static_cast<LatencyStage>(i);
+		LatencyStageStats &stageStats = stats->stages[i];
+		sim::emit("latency %llu %s count %u min %u p50 %u p99 %u max %u\n", (unsigned long long)sim::now(), stageNames[i],
+			stageStats.count, stageStats.count ? stageStats.minUs : 0,
+			latencyTracer.percentile(stage, 500), latencyTracer.percentile(stage, 990), stageStats.maxUs);
+	}
+}
+
+static void pollSummary()
+{
+	static const char *histogramNames[POLL_HISTOGRAM_COUNT] = { "interval", "jitter", "staleness" };
+
+	PollStats *stats = pollTracker.stats;
+	if (!stats || !stats->completions)
+		return;
+
+	sim::emit("poll %llu frames %u skipped %u completions %u intervals %u\n", (unsigned long long)sim::now(),
+		stats->frames, stats->framesSkipped, stats->completions, stats->intervals);
+	for (int i = 0; i < POLL_HISTOGRAM_COUNT; i++)
+	{
+		PollHistogram histogram = static_cast<PollHistogram>(i);
+		LatencyStageStats &histogramStats = stats->histograms[i];
+		sim::emit("poll %llu %s count %u min %u p50 %u p99 %u max %u\n", (unsigned long long)sim::now(), histogramNames[i],
+			histogramStats.count, histogramStats.count ? histogramStats.minUs : 0,
+			pollTracker.percentile(histogram, 500), pollTracker.percentile(histogram, 990), histogramStats.maxUs);
+	}
+}
+
+static void modeSwitchSummary()
+{
+	InputModeSwitchStats &stats = inputModeSwitch.stats;
+	if (!stats.switches)
+		return;
+
+	sim::emit("mode %llu switches %u completed %u last %u max %u\n", (unsigned long long)sim::now(),
+		stats.switches, stats.completed, stats.lastUs, stats.maxUs);
+}
+
+static void storeSummary()
+{
+	FlashPROMStats &stats = FlashPROM::stats;
+	if (!stats.commits)
+		return;
+
+	sim::emit("store %llu commits %u records %u relocations %u erases %u stall last %u max %u frames %u deferred %u forced %u\n", (unsigned long long)sim::now(),
+		stats.commits, stats.records, stats.relocations, stats.erases, stats.lastStallUs, stats.maxStallUs, stats.missedFrames,
+		stats.deferred, stats.forced);
+}
+
+static void powerSummary()
+{
+	PowerStats &stats = powerManager.stats;
+	if (!stats.suspends)
+		return;
+
+	sim::emit("power %llu suspends %u wakeups %u resume last %u max %u\n", (unsigned long long)sim::now(),
+		stats.suspends, stats.wakeups, stats.lastResumeUs, stats.maxResumeUs);
+}
+
+void sim::finish(int code, const char *reason)
+{
+	if (finishing.exchange(true))
+	{
+		while (true)
+			pause();
+	}
+
+	pioSummary();
+	if (options.oledFile)
+		oledDump(options.oledFile);
+	flashSave();
+
+	latencySummary();
+	pollSummary();
+	modeSwitchSummary();
+	powerSummary();
+	storeSummary();
+	if (options.traceFile)
+		traceSave(options.traceFile);
+
+	double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+	double virtualMs = now() / 1000.0;
+	emit("end %llu %s\n", (unsigned long long)now(), reason);
+	usbSummary();
+	fprintf(stderr, "sim: %s after %.3f virtual ms in %.3f wall ms (%.1fx)\n",
+		reason, virtualMs, wallMs, wallMs > 0 ? virtualMs / wallMs : 0.0);
+
+	fflush(output);
+	fflush(stderr);
+	_exit(code);
+}
+
+extern "C" void sim_panic(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "sim: panic: ");
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+	sim::finish(1, "panic");
+}
+
+/* Script */
+
+static_assert(sizeof(buttonNames) / sizeof(buttonNames[0]) == INPUT_TRACE_PINS, "one button name per trace pin");
+
+static int resolvePin(const std::string &target)
+{
+	if (!target.empty() && isdigit((unsigned char)target[0]))
+		return atoi(target.c_str());
+
+	BoardOptions boardOptions = getBoardOptions();
+	for (auto &button : buttonNames)
+		if (strcasecmp(button.name, target.c_str()) == 0)
+			return *((uint8_t *)&boardOptions + button.offset);
+
+	return -1;
+}
+
+/**
+ * @brief Turn an input trace downloaded from the web configurator into script events from the start
+ * time on: the recorded settings are applied first, then each recorded pin change drives the button
+ * on the same mapping, so the trace replays on any board configuration.
+ */
+static bool loadTrace(const char *file, uint64_t start, int line)
+{
+	FILE *input = fopen(file, "rb");
+	if (!input)
+	{
+		perror(file);
+		return false;
+	}
+
+	static InputTraceDump dump;
+	size_t length = fread(&dump, 1, sizeof(dump), input);
+	fclose(input);
+
+	size_t header = offsetof(InputTraceDump, records);
+	if (
+		length < header ||
+		dump.magic != INPUT_TRACE_MAGIC ||
+		dump.version != INPUT_TRACE_VERSION ||
+		dump.capacity > INPUT_TRACE_RECORDS ||
+		dump.head >= dump.capacity ||
+		length < header + dump.capacity * sizeof(InputTraceRecord)
+	) {
+		fprintf(stderr, "%s: not an input trace\n", file);
+		return false;
+	}
+
+	ScriptEvent event = { start, SCRIPT_TRACE_CONFIG, "", -1, std::string((const char *)&dump.config, sizeof(InputTraceConfig)), line };
+	script.push_back(event);
+
+	// The oldest record is at the head once the ring has wrapped
+	uint32_t count = std::min<uint32_t>(dump.written, dump.capacity);
+	uint32_t first = (dump.written > dump.capacity) ? dump.head : 0;
+	uint32_t baseUs = dump.records[first].timeUs;
+	uint32_t previous = 0; // Every pin starts released
+
+	event.action = SCRIPT_DRIVE;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const InputTraceRecord &record = dump.records[(first + i) % dump.capacity];
+		event.time = start + (uint32_t)(record.timeUs - baseUs);
+
+		for (int pin = 0; pin < INPUT_TRACE_PINS; pin++)
+		{
+			uint8_t gpio = dump.config.pins[pin];
+			if (gpio >= NUM_BANK0_GPIOS || !((record.values ^ previous) & (1U << gpio)))
+				continue;
+
+			event.target = buttonNames[pin].name;
+			event.level = (record.values & (1U << gpio)) ? 0 : -1;
+			script.push_back(event);
+		}
+
+		uint8_t settingsPin = dump.config.settingsPin;
+		if (settingsPin < NUM_BANK0_GPIOS && ((record.values ^ previous) & (1U << settingsPin)))
+		{
+			event.target = std::to_string(settingsPin);
+			event.level = (record.values & (1U << settingsPin)) ? 0 : -1;
+			script.push_back(event);
+		}
+
+		previous = record.values;
+	}
+
+	fprintf(stderr, "sim: replaying %u of %u recorded changes from %s\n", count, dump.written, file);
+	return true;
+}
+
+static bool parseTime(const char *text, uint64_t *time)
+{
+	char *unit;
+	double value = strtod(text, &unit);
+	if (unit == text)
+		return false;
+
+	if (!*unit || !strcmp(unit, "us"))
+		*time = value;
+	else if (!strcmp(unit, "ms"))
+		*time = value * 1000;
+	else if (!strcmp(unit, "s"))
+		*time = value * 1000000;
+	else
+		return false;
+
+	return true;
+}
+
+/**
+ * @brief Load a script of "<time> <command> [args]" lines, times in us unless suffixed with ms or s.
+ *
+ *   <time> press <button|gpio>         drive the pin low
+ *   <time> release <button|gpio>       release the pin to its pull-up
+ *   <time> bounce <button|gpio> <n> <interval>
+ *                                      toggle the pin n times, starting from released
+ *   <time> out <hex bytes>             host OUT transfer on the next frame
+ *   <time> oled <file>                 dump the display RAM as a PBM image
+ *   <time> replay <file>               replay an input trace from /api/getInputTrace
+ *   <time> suspend                     host suspends the bus
+ *   <time> resume                      host resumes the bus
+ *   <time> end                         stop the simulation
+ */
+static bool loadScript(const char *file)
+{
+	FILE *input = fopen(file, "r");
+	if (!input)
+	{
+		perror(file);
+		return false;
+	}
+
+	char line[512];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), input))
+	{
+		lineNumber++;
+		char *comment = strchr(line, '#');
+		if (comment)
+			*comment = 0;
+
+		char *timeText = strtok(line, " \t\r\n");
+		char *command = strtok(nullptr, " \t\r\n");
+		if (!timeText)
+			continue;
+
+		ScriptEvent event = { 0, SCRIPT_DRIVE, "", -1, "", lineNumber };
+		if (!command || !parseTime(timeText, &event.time))
+		{
+			fprintf(stderr, "%s:%d: expected \"<time> <command>\"\n", file, lineNumber);
+			return false;
+		}
+
+		char *arg = strtok(nullptr, " \t\r\n");
+		if ((!strcmp(command, "press") || !strcmp(command, "release")) && arg)
+		{
+			event.target = arg;
+			event.level = (command[0] == 'p') ? 0 : -1;
+			script.push_back(event);
+		}
+		else if (!strcmp(command, "bounce") && arg)
+		{
+			char *countText = strtok(nullptr, " \t\r\n");
+			char *intervalText = strtok(nullptr, " \t\r\n");
+			uint64_t interval = 0;
+			if (!countText || !intervalText || !parseTime(intervalText, &interval))
+			{
+				fprintf(stderr, "%s:%d: expected \"bounce <pin> <count> <interval>\"\n", file, lineNumber);
+				return false;
+			}
+
+			event.target = arg;
+			for (int i = 0, count = atoi(countText); i < count; i++)
+			{
+				event.level = (i & 1) ? -1 : 0;
+				script.push_back(event);
+				event.time += interval;
+			}
+		}
+		else if (!strcmp(command, "out") && arg)
+		{
+			event.action = SCRIPT_OUT;
+			for (; arg; arg = strtok(nullptr, " \t\r\n"))
+				event.data.push_back((char)strtoul(arg, nullptr, 16));
+			script.push_back(event);
+		}
+		else if (!strcmp(command, "oled") && arg)
+		{
+			event.action = SCRIPT_OLED;
+			event.target = arg;
+			script.push_back(event);
+		}
+		else if (!strcmp(command, "replay") && arg)
+		{
+			if (!loadTrace(arg, event.time, lineNumber))
+				return false;
+		}
+		else if (!strcmp(command, "suspend") || !strcmp(command, "resume"))
+		{
+			event.action = (command[0] == 's') ? SCRIPT_SUSPEND : SCRIPT_RESUME;
+			script.push_back(event);
+		}
+		else if (!strcmp(command, "end"))
+		{
+			event.action = SCRIPT_END;
+			script.push_back(event);
+		}
+		else
+		{
+			fprintf(stderr, "%s:%d: unknown command \"%s\"\n", file, lineNumber, command);
+			return false;
+		}
+	}
+
+	fclose(input);
+	std::stable_sort(script.begin(), script.end(), [](const ScriptEvent &a, const ScriptEvent &b) { return a.time < b.time; });
+	return true;
+}
+
+uint64_t sim::scriptNext()
+{
+	uint64_t next = options.endUs;
+	if (scriptIndex < script.size())
+		next = std::min(next, script[scriptIndex].time);
+
+	return next;
+}
+
+void sim::scriptRun(uint64_t now)
+{
+	while (scriptIndex < script.size() && script[scriptIndex].time <= now)
+	{
+		const ScriptEvent &event = script[scriptIndex++];
+		switch (event.action)
+		{
+			case SCRIPT_DRIVE:
+			{
+				int pin = resolvePin(event.target);
+				if (pin < 0 || pin >= NUM_BANK0_GPIOS)
+				{
+					fprintf(stderr, "sim: line %d: unknown pin \"%s\"\n", event.line, event.target.c_str());
+					break;
+				}
+
+				emit("gpio %llu %d %s\n", (unsigned long long)now, pin, event.level == 0 ? "low" : "release");
+				gpioDrive(pin, event.level);
+				break;
+			}
+
+			case SCRIPT_OUT:
+				usbHostOut((const uint8_t *)event.data.data(), event.data.size());
+				break;
+
+			case SCRIPT_OLED:
+				oledDump(event.target.c_str());
+				break;
+
+			case SCRIPT_TRACE_CONFIG:
+				InputTrace::applyConfig(gamepad, *(const InputTraceConfig *)event.data.data());
+				break;
+
+			case SCRIPT_SUSPEND:
+				usbHostSuspend();
+				break;
+
+			case SCRIPT_RESUME:
+				usbHostResume();
+				break;
+
+			case SCRIPT_END:
+				finish(0, "end of script");
+		}
+	}
+
+	if (now >= options.endUs)
+		finish(0, "end of run");
+}
+
+/* Entry */
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s script] [-t ms] [-o log] [-O oled.pbm] [-f flash.bin] [-c us] [-k us] [-T trace.bin] [-P frames] [-A ms] [-B cycles] [-C rounds] [-W commits] [-L op] [-I kb]\n"
+		"  -s  input script, see sim/src/sim.cpp for the format\n"
+		"  -t  virtual run time in ms, defaults to 100ms after the last scripted event\n"
+		"  -o  event log, defaults to stdout\n"
+		"  -O  dump the display RAM to a PBM image at the end of the run\n"
+		"  -f  flash image, loaded at start and saved at the end of the run\n"
+		"  -c  virtual cost of each time read on core0 in us, defaults to 1\n"
+		"  -k  how far core0 may run ahead of core1 in us, defaults to 100, 0 lets core1 run free\n"
+		"  -T  save the input trace recorded by the firmware at the end of the run\n"
+		"  -P  host polling interval for interrupt endpoints in frames, defaults to the endpoint's bInterval\n"
+		"  -A  host time from the device connecting to it being enumerated in ms, defaults to 0\n"
+		"  -B  time this many loop cycles with one player and with two instead of running the firmware\n"
+		"  -C  check the CRC32 backends and the checksums stored in flash, and time each this many rounds\n"
+		"  -D  check the debouncer's reports on switch waveforms with this window in ms instead of running the firmware\n"
+		"  -W  run the settings store through this many commits and report the flash erases of each sector\n"
+		"  -L  lose power halfway through this flash erase or program, counting from 1, and end the run\n"
+		"  -I  size of the firmware image at the start of flash in KB, defaults to 256\n",
+		name);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	uint64_t runMs = 0;
+	uint32_t benchCycles = 0;
+	uint32_t crcRounds = 0;
+	uint32_t wearCommits = 0;
+	uint32_t debounceMs = 0;
+	while ((opt = getopt(argc, argv, "s:t:o:O:f:c:k:T:P:A:B:C:D:W:L:I:h")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				if (!loadScript(optarg))
+					return 1;
+				break;
+
+			case 't': runMs = strtoull(optarg, nullptr, 10); break;
+			case 'O': sim::options.oledFile = optarg; break;
+			case 'f': sim::options.flashFile = optarg; break;
+			case 'c': sim::options.readCostUs = strtoul(optarg, nullptr, 10); break;
+			case 'k': sim::options.core1SlackUs = strtoul(optarg, nullptr, 10); break;
+			case 'T': sim::options.traceFile = optarg; break;
+			case 'P': sim::options.pollFrames = strtoul(optarg, nullptr, 10); break;
+			case 'A': sim::options.attachUs = strtoul(optarg, nullptr, 10) * 1000; break;
+			case 'L': sim::options.powerLossOp = strtoul(optarg, nullptr, 10); break;
+			case 'I': sim::options.imageBytes = strtoul(optarg, nullptr, 10) * 1024; break;
+			case 'B': benchCycles = strtoul(optarg, nullptr, 10); break;
+			case 'C': crcRounds = strtoul(optarg, nullptr, 10); break;
+			case 'D': debounceMs = strtoul(optarg, nullptr, 10); break;
+			case 'W': wearCommits = strtoul(optarg, nullptr, 10); break;
+
+			case 'o':
+				output = fopen(optarg, "w");
+				if (!output)
+				{
+					perror(optarg);
+					return 1;
+				}
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (runMs)
+		sim::options.endUs = runMs * 1000;
+	else
+		sim::options.endUs = (script.empty() ? 0 : script.back().time) + SIM_DEFAULT_TAIL_US;
+
+	sim::flashMap(sim::options.flashFile);
+	wallStart = std::chrono::steady_clock::now();
+
+	if (benchCycles)
+	{
+		sim::options.endUs = SIM_NEVER;
+		sim::bench(benchCycles);
+		sim::finish(0, "end of benchmark");
+	}
+
+	if (crcRounds)
+	{
+		sim::options.endUs = SIM_NEVER;
+		sim::crc(crcRounds);
+		sim::finish(0, "end of checksum run");
+	}
+
+	if (debounceMs)
+	{
+		sim::options.endUs = SIM_NEVER;
+		sim::debounce(debounceMs);
+		sim::finish(0, "end of debounce run");
+	}
+
+	if (wearCommits)
+	{
+		sim::options.endUs = SIM_NEVER;
+		sim::wear(wearCommits);
+		sim::finish(0, "end of endurance run");
+	}
+
+	gp2040_main();
+	sim::finish(0, "firmware returned");
+}
@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include "pico.h"
+
+#define SIM_NEVER UINT64_MAX
+
+/**
+ * @brief Internal interface between the simulated peripherals.
+ *
+ * Virtual time belongs to core0. Every time read on core0 costs a fixed number of microseconds, and
+ * advancing the clock runs every device event that falls due on the way: scripted pin changes,
+ * alarms, USB frames and PIO samples. core1 never moves the clock, its sleeps wait for core0, and
+ * core0 is held within a slack of the last time core1 read the clock so both cores stay in step.
+ */
+namespace sim
+{
+	struct Options
+	{
+		uint32_t readCostUs = 1;
+		uint32_t core1SlackUs = 100;
+		uint32_t pollFrames = 0; // Overrides the interrupt endpoints' bInterval when set
+		uint32_t attachUs = 0;   // Host time from the device connecting to it being enumerated
+		uint32_t powerLossOp = 0; // Flash erase or program that power is lost halfway through, counting from 1
+		uint32_t imageBytes = 256 * 1024; // Firmware image at the start of flash, ends at __flash_binary_end
+		uint64_t endUs = SIM_NEVER;
+		const char *flashFile = nullptr;
+		const char *oledFile = nullptr;
+		const char *traceFile = nullptr;
+	};
+
+	extern Options options;
+
+	// Clock
+	uint64_t now();
+	void advance(uint64_t until);
+	void reschedule();
+	void waitUntil(uint64_t until);
+	void core1CheckIn();
+	void stall(uint64_t us); // Moves core0's clock on without running device events
+	void core1Idle(); // core1 is waiting for an event, core0 runs free until core1 reads the clock again
+	void core1Lockout(); // Holds core1 here while core0 has it locked out
+	bool onCore0();
+
+	// Event log, one line per event, safe from either core
+	void emit(const char *format, ...) __attribute__((format(printf, 1, 2)));
+	void finish(int code, const char *reason) __attribute__((noreturn));
+
+	// Device event sources, each reports its next due time and runs everything due at now
+	uint64_t scriptNext();
+	void scriptRun(uint64_t now);
+	uint64_t alarmNext();
+	void alarmRun(uint64_t now);
+	uint64_t usbNext();
+	void usbRun(uint64_t now);
+	void usbStall(uint64_t now); // Counts the frames that start while core0 is stalled
+	uint64_t pioNext();
+	void pioRun(uint64_t now);
+	void pioClockChanged(); // clk_sys changed speed, the state machines follow it
+
+	// GPIO
+	void gpioDrive(uint pin, int level); // -1 releases the pin to its pulls
+	int gpioDriven(uint pin);
+
+	// USB host side
+	void usbHostOut(const uint8_t *data, uint16_t length);
+	void usbHostSuspend();
+	void usbHostResume();
+	void usbSummary();
+
+	// PIO and DMA
+	void pioRxPush(uint pioIndex, uint sm, uint32_t value);
+	bool pioTxAddress(uintptr_t address, uint *pioIndex, uint *sm);
+	void pioTxPut(uint pioIndex, uint sm, uint32_t value);
+	bool dmaRegisterWrite(uintptr_t address, uint32_t value);
+	void dmaRequest(uint dreq);
+	void pioSummary();
+
+	// Flash and display
+	void flashMap(const char *file);
+	void flashSave();
+	uint32_t flashErases(uint32_t offset); // Erases of the sector at this offset so far
+	uint64_t flashLastBusy(); // When the last erase or program finished
+	void oledDump(const char *file);
+
+	// Times the per-cycle work with one and two players instead of running the firmware
+	void bench(uint32_t cycles);
+
+	// Checks the CRC32 backends agree with the old nibble table code and times each this many rounds
+	void crc(uint32_t rounds);
+
+	// Runs the debouncer over bounce, noise and stall waveforms in both modes and checks its reports
+	void debounce(uint32_t windowMs);
+
+	// Runs the settings store through this many commits and reports the erases of each of its sectors
+	void wear(uint32_t commits);
+}
+
+#endif
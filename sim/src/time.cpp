@@ -0,0 +1,248 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pico/time.h"
+#include "sim.h"
+
+#define SIM_CORE1_TIMEOUT_MS 2 // Wall time to wait for core1 before letting it run free
+
+struct Alarm
+{
+	alarm_id_t id;
+	uint64_t target;
+	alarm_callback_t callback;
+	void *userData;
+};
+
+static std::atomic<uint64_t> virtualClock(0);
+static std::atomic<uint64_t> nextDue(0);
+static std::atomic<uint64_t> core1Clock(SIM_NEVER);
+static bool advancing = false;
+
+static std::recursive_mutex alarmLock;
+static std::vector<Alarm> alarms;
+static alarm_id_t nextAlarmId = 1;
+
+uint64_t sim::now()
+{
+	return virtualClock.load(std::memory_order_acquire);
+}
+
+// Run the device events up to the target time, in time order
+static void runEvents(uint64_t until)
+{
+	while (true)
+	{
+		uint64_t next = until;
+		next = std::min(next, sim::scriptNext());
+		next = std::min(next, sim::alarmNext());
+		next = std::min(next, sim::usbNext());
+		next = std::min(next, sim::pioNext());
+		if (next > sim::now())
+			virtualClock.store(next, std::memory_order_release);
+
+		uint64_t current = sim::now();
+		sim::scriptRun(current);
+		sim::alarmRun(current);
+		sim::usbRun(current);
+		sim::pioRun(current);
+
+		if (current >= until)
+			break;
+	}
+
+	uint64_t next = std::min(std::min(sim::scriptNext(), sim::alarmNext()), std::min(sim::usbNext(), sim::pioNext()));
+	nextDue.store(next, std::memory_order_release);
+}
+
+/**
+ * @brief How far core0 may run ahead, waiting for core1 to read the clock if it is too far behind.
+ *
+ * core1 only runs in wall time, so core0 is held within a slack of the last time core1 read the
+ * clock. A core1 loop that never reads the clock stops being tracked until it does.
+ */
+static uint64_t core1Limit()
+{
+	if (!sim::options.core1SlackUs)
+		return SIM_NEVER;
+
+	auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		uint64_t seen = core1Clock.load(std::memory_order_acquire);
+		if (seen == SIM_NEVER)
+			return SIM_NEVER;
+
+		if (seen + sim::options.core1SlackUs > sim::now())
+			return seen + sim::options.core1SlackUs;
+
+		if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(SIM_CORE1_TIMEOUT_MS))
+		{
+			core1Clock.compare_exchange_strong(seen, SIM_NEVER);
+			return SIM_NEVER;
+		}
+
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * @brief Move core0's clock to the target, running every device event that falls due on the way.
+ *
+ * Callbacks run from here behave like interrupt handlers, so time reads inside them see a fixed clock.
+ */
+void sim::advance(uint64_t until)
+{
+	if (advancing)
+		return;
+
+	advancing = true;
+	do
+	{
+		uint64_t step = std::min(until, core1Limit());
+		if (step < nextDue.load(std::memory_order_acquire))
+			virtualClock.store(std::max(step, now()), std::memory_order_release);
+		else
+			runEvents(step);
+	}
+	while (now() < until);
+	advancing = false;
+}
+
+// The CPU is held with interrupts off, device events that fall due meanwhile run late
+void sim::stall(uint64_t us)
+{
+	sim::usbStall(virtualClock.fetch_add(us, std::memory_order_acq_rel) + us);
+}
+
+void sim::core1CheckIn()
+{
+	core1Lockout();
+	core1Clock.store(now(), std::memory_order_release);
+}
+
+void sim::core1Idle()
+{
+	core1Clock.store(SIM_NEVER, std::memory_order_release);
+}
+
+// Called when a device event source gains an earlier event than it had at the last advance
+void sim::reschedule()
+{
+	nextDue.store(0, std::memory_order_release);
+}
+
+void sim::waitUntil(uint64_t until)
+{
+	if (!onCore0())
+		core1Clock.store(until, std::memory_order_release);
+
+	while (now() < until)
+	{
+		if (!onCore0())
+			core1Lockout();
+		std::this_thread::yield();
+	}
+}
+
+/* Alarms */
+
+uint64_t sim::alarmNext()
+{
+	std::lock_guard<std::recursive_mutex> guard(alarmLock);
+	uint64_t next = SIM_NEVER;
+	for (auto &alarm : alarms)
+		next = std::min(next, alarm.target);
+
+	return next;
+}
+
+void sim::alarmRun(uint64_t now)
+{
+	std::lock_guard<std::recursive_mutex> guard(alarmLock);
+	for (size_t i = 0; i < alarms.size();)
+	{
+		if (alarms[i].target > now)
+		{
+			i++;
+			continue;
+		}
+
+		Alarm alarm = alarms[i];
+		alarms.erase(alarms.begin() + i);
+
+		// As the SDK: more time from when the callback returns, or less than zero from when it was due
+		int64_t result = alarm.callback(alarm.id, alarm.userData);
+		if (result != 0)
+		{
+			alarm.target = (result > 0) ? sim::now() + result : alarm.target - result;
+			alarms.push_back(alarm);
+		}
+
+		i = 0;
+	}
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+	(void)fire_if_past;
+
+	std::lock_guard<std::recursive_mutex> guard(alarmLock);
+	Alarm alarm = { nextAlarmId++, sim::now() + us, callback, user_data };
+	alarms.push_back(alarm);
+	sim::reschedule();
+
+	return alarm.id;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+	std::lock_guard<std::recursive_mutex> guard(alarmLock);
+	for (auto it = alarms.begin(); it != alarms.end(); it++)
+	{
+		if (it->id == alarm_id)
+		{
+			alarms.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Time */
+
+uint64_t time_us_64(void)
+{
+	if (sim::onCore0())
+		sim::advance(sim::now() + sim::options.readCostUs);
+	else
+		sim::core1CheckIn();
+
+	return sim::now();
+}
+
+void busy_wait_us(uint64_t us)
+{
+	if (sim::onCore0())
+		sim::advance(sim::now() + us);
+	else
+		sim::waitUntil(sim::now() + us);
+}
+
+void sleep_us(uint64_t us)
+{
+	busy_wait_us(us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+	busy_wait_us(ms * 1000ull);
+}
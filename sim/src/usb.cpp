@@ -0,0 +1,510 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include "hardware/irq.h"
+#include "hardware/structs/usb.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "sim.h"
+
+#define SIM_USB_FRAME_US     1000
+#define SIM_USB_ENDPOINTS    16
+#define SIM_USB_PACKET_SIZE  64
+#define SIM_USB_RESUME_US    20000 // The host drives resume signalling for 20ms after a remote wakeup
+
+/**
+ * @brief Device stack and host in one: the configuration descriptor is walked at tusb_init() to open
+ * the class drivers, then the host collects each busy IN endpoint on its polling interval and hands
+ * queued OUT data to an armed OUT endpoint. Completions raise USBCTRL_IRQ and are delivered from tud_task().
+ * A suspended bus has no frames; the host enables remote wakeup and resumes the bus after it is signalled.
+ */
+struct Endpoint
+{
+	bool opened = false;
+	bool busy = false;
+	bool claimed = false;
+	uint8_t driver = 0;
+	uint8_t interval = 1;
+	uint8_t *buffer = nullptr;
+	uint16_t length = 0;
+	uint8_t data[SIM_USB_PACKET_SIZE];
+};
+
+struct Completion
+{
+	uint8_t address;
+	uint32_t length;
+};
+
+static usb_hw_t usbState = { };
+usb_hw_t *usb_hw = &usbState;
+
+static const usbd_class_driver_t *drivers = nullptr;
+static uint8_t driverCount = 0;
+static uint8_t openingDriver = 0; // Driver being opened, owns the endpoints it opens
+static Endpoint endpoints[2][SIM_USB_ENDPOINTS]; // [direction][number]
+static std::deque<Completion> completions;
+static std::deque<std::string> hostOut;
+static bool inited = false;
+static bool connected = false;
+static bool mounted = false;
+static bool suspended = false;
+static int8_t busEvent = 0; // Suspend (1) or resume (-1) waiting for tud_task()
+static uint64_t nextFrame = SIM_NEVER;
+static uint64_t attachAt = SIM_NEVER; // When the host enumerates a device that has just connected
+static uint64_t resumeAt = SIM_NEVER; // When the host resumes the bus after a remote wakeup
+static uint32_t frames = 0;
+static uint32_t reports = 0;
+
+static inline Endpoint &endpoint(uint8_t address)
+{
+	return endpoints[tu_edpt_dir(address)][tu_edpt_number(address)];
+}
+
+static void enumerate()
+{
+	drivers = usbd_app_driver_get_cb(&driverCount);
+	for (uint8_t i = 0; i < driverCount; i++)
+		drivers[i].init();
+
+	uint8_t const *config = tud_descriptor_configuration_cb(0);
+	uint16_t total = ((tusb_desc_configuration_t const *)config)->wTotalLength;
+	uint8_t const *p = config + tu_desc_len(config);
+	uint8_t const *end = config + total;
+	while (p < end)
+	{
+		uint16_t used = 0;
+		if (tu_desc_type(p) == TUSB_DESC_INTERFACE)
+		{
+			for (openingDriver = 0; openingDriver < driverCount && !used; openingDriver++)
+				used = drivers[openingDriver].open(0, (tusb_desc_interface_t const *)p, end - p);
+		}
+
+		p = used ? p + used : tu_desc_next(p);
+	}
+
+	mounted = true;
+	nextFrame = sim::now() + SIM_USB_FRAME_US;
+	sim::reschedule();
+	sim::emit("usb %llu mount\n", (unsigned long long)sim::now());
+	tud_mount_cb();
+}
+
+// The host takes options.attachUs to debounce the connection, reset the bus and enumerate
+static void attach()
+{
+	if (sim::options.attachUs == 0)
+	{
+		enumerate();
+		return;
+	}
+
+	attachAt = sim::now() + sim::options.attachUs;
+	sim::reschedule();
+}
+
+static void unmount()
+{
+	if (!mounted)
+		return;
+
+	mounted = false;
+	suspended = false;
+	busEvent = 0;
+	nextFrame = SIM_NEVER;
+	resumeAt = SIM_NEVER;
+	completions.clear();
+	for (auto &direction : endpoints)
+		for (auto &ep : direction)
+			ep = Endpoint();
+
+	for (uint8_t i = 0; i < driverCount; i++)
+		drivers[i].reset(0);
+	sim::emit("usb %llu unmount\n", (unsigned long long)sim::now());
+	tud_umount_cb();
+}
+
+/* Host side */
+
+uint64_t sim::usbNext()
+{
+	return std::min({ nextFrame, attachAt, resumeAt });
+}
+
+// The controller keeps counting frames while core0 is stalled, their reports and interrupts come late
+void sim::usbStall(uint64_t now)
+{
+	if (mounted && nextFrame <= now)
+		usb_hw->sof_rd = (frames + (now - nextFrame) / SIM_USB_FRAME_US + 1) & USB_SOF_RD_BITS;
+}
+
+void sim::usbRun(uint64_t now)
+{
+	if (attachAt <= now)
+	{
+		attachAt = SIM_NEVER;
+		if (connected)
+			enumerate();
+	}
+
+	if (resumeAt <= now)
+	{
+		resumeAt = SIM_NEVER;
+		sim::usbHostResume();
+	}
+
+	while (mounted && nextFrame <= now)
+	{
+		frames++;
+		usb_hw->sof_rd = frames & USB_SOF_RD_BITS;
+
+		for (uint8_t number = 1; number < SIM_USB_ENDPOINTS; number++)
+		{
+			Endpoint &in = endpoints[TUSB_DIR_IN][number];
+			if (in.busy && in.length != UINT16_MAX && (frames % in.interval) == 0)
+			{
+				std::string bytes;
+				char hex[4];
+				for (uint16_t i = 0; i < in.length; i++)
+				{
+					snprintf(hex, sizeof(hex), " %02x", in.data[i]);
+					bytes += hex;
+				}
+
+				sim::emit("usb %llu in %02x%s\n", (unsigned long long)nextFrame, number | TUSB_DIR_IN_MASK, bytes.c_str());
+				completions.push_back({ (uint8_t)(number | TUSB_DIR_IN_MASK), in.length });
+				in.length = UINT16_MAX; // Collected, waiting for tud_task()
+				reports++;
+			}
+
+			Endpoint &out = endpoints[TUSB_DIR_OUT][number];
+			if (out.opened && out.busy && out.buffer && !hostOut.empty())
+			{
+				std::string packet = hostOut.front();
+				hostOut.pop_front();
+
+				uint16_t length = std::min<size_t>(packet.size(), out.length);
+				memcpy(out.buffer, packet.data(), length);
+				out.buffer = nullptr;
+				completions.push_back({ number, length });
+				sim::emit("usb %llu out %02x %u\n", (unsigned long long)nextFrame, number, length);
+			}
+		}
+
+		nextFrame += SIM_USB_FRAME_US;
+	}
+
+	if (!completions.empty())
+		irq_set_pending(USBCTRL_IRQ);
+}
+
+void sim::usbHostOut(const uint8_t *data, uint16_t length)
+{
+	hostOut.push_back(std::string((const char *)data, length));
+}
+
+void sim::usbHostSuspend()
+{
+	if (!mounted || suspended)
+		return;
+
+	suspended = true;
+	busEvent = 1;
+	nextFrame = SIM_NEVER;
+	sim::emit("usb %llu suspend\n", (unsigned long long)sim::now());
+	irq_set_pending(USBCTRL_IRQ);
+}
+
+void sim::usbHostResume()
+{
+	if (!suspended)
+		return;
+
+	suspended = false;
+	busEvent = -1;
+	resumeAt = SIM_NEVER;
+	nextFrame = sim::now() + SIM_USB_FRAME_US;
+	sim::reschedule();
+	sim::emit("usb %llu resume\n", (unsigned long long)sim::now());
+	irq_set_pending(USBCTRL_IRQ);
+}
+
+void sim::usbSummary()
+{
+	fprintf(stderr, "sim: %u USB frames, %u IN reports\n", frames, reports);
+}
+
+/* Device stack */
+
+bool tusb_init(void)
+{
+	inited = true;
+	connected = true;
+	irq_set_enabled(USBCTRL_IRQ, true);
+	attach();
+	return true;
+}
+
+bool tusb_inited(void)
+{
+	return inited;
+}
+
+void tud_task(void)
+{
+	if (busEvent > 0)
+		tud_suspend_cb(true);
+	else if (busEvent < 0)
+		tud_resume_cb();
+	busEvent = 0;
+
+	while (!completions.empty())
+	{
+		Completion completion = completions.front();
+		completions.pop_front();
+
+		Endpoint &ep = endpoint(completion.address);
+		ep.busy = false;
+		drivers[ep.driver].xfer_cb(0, completion.address, XFER_RESULT_SUCCESS, completion.length);
+	}
+}
+
+bool tud_mounted(void)
+{
+	return mounted;
+}
+
+bool tud_ready(void)
+{
+	return mounted && !suspended;
+}
+
+bool tud_suspended(void)
+{
+	return suspended;
+}
+
+bool tud_remote_wakeup(void)
+{
+	if (!suspended || resumeAt != SIM_NEVER)
+		return false;
+
+	resumeAt = sim::now() + SIM_USB_RESUME_US;
+	sim::reschedule();
+	sim::emit("usb %llu wakeup\n", (unsigned long long)sim::now());
+	return true;
+}
+
+bool tud_connected(void)
+{
+	return connected;
+}
+
+bool tud_connect(void)
+{
+	if (!connected)
+	{
+		connected = true;
+		attach();
+	}
+
+	return true;
+}
+
+bool tud_disconnect(void)
+{
+	connected = false;
+	attachAt = SIM_NEVER;
+	unmount();
+	return true;
+}
+
+void tud_int_handler(uint8_t rhport)
+{
+	(void)rhport;
+}
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_ep)
+{
+	(void)rhport;
+	Endpoint &ep = endpoint(desc_ep->bEndpointAddress);
+	ep = Endpoint();
+	ep.opened = true;
+	ep.driver = openingDriver;
+	ep.interval = desc_ep->bInterval ? desc_ep->bInterval : 1;
+	if (sim::options.pollFrames && desc_ep->bmAttributes.xfer == TUSB_XFER_INTERRUPT)
+		ep.interval = sim::options.pollFrames;
+	return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
+{
+	(void)rhport;
+	Endpoint &ep = endpoint(ep_addr);
+	if (!ep.opened || ep.busy)
+		return false;
+
+	ep.busy = true;
+	if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN)
+	{
+		ep.length = std::min<uint16_t>(total_bytes, SIM_USB_PACKET_SIZE);
+		memcpy(ep.data, buffer, ep.length);
+	}
+	else
+	{
+		ep.buffer = buffer;
+		ep.length = total_bytes;
+	}
+
+	return true;
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
+{
+	(void)rhport;
+	return endpoint(ep_addr).busy;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
+{
+	(void)rhport;
+	Endpoint &ep = endpoint(ep_addr);
+	if (ep.claimed || ep.busy)
+		return false;
+
+	ep.claimed = true;
+	return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
+{
+	(void)rhport;
+	endpoint(ep_addr).claimed = false;
+	return true;
+}
+
+void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
+{
+	(void)rhport;
+	(void)ep_addr;
+}
+
+bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr)
+{
+	(void)rhport;
+	(void)ep_addr;
+	return false;
+}
+
+/* HID class driver, one instance per interface in the order they are opened */
+
+struct HidInstance
+{
+	uint8_t endpointIn = 0;
+	uint8_t endpointOut = 0;
+	uint8_t report[SIM_USB_PACKET_SIZE];
+	uint8_t out[SIM_USB_PACKET_SIZE];
+};
+
+static HidInstance hidInstances[CFG_TUD_HID];
+static uint8_t hidInstanceCount = 0;
+
+void hidd_init(void)
+{
+	for (auto &instance : hidInstances)
+		instance = HidInstance();
+	hidInstanceCount = 0;
+}
+
+void hidd_reset(uint8_t rhport)
+{
+	(void)rhport;
+	hidd_init();
+}
+
+uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len)
+{
+	TU_VERIFY(desc_itf->bInterfaceClass == TUSB_CLASS_HID && hidInstanceCount < CFG_TUD_HID, 0);
+
+	HidInstance &instance = hidInstances[hidInstanceCount++];
+	uint8_t const *p = (uint8_t const *)desc_itf;
+	uint16_t length = tu_desc_len(p);
+	p = tu_desc_next(p);
+	while (length < max_len && tu_desc_type(p) != TUSB_DESC_INTERFACE)
+	{
+		if (tu_desc_type(p) == TUSB_DESC_ENDPOINT)
+		{
+			tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *)p;
+			usbd_edpt_open(rhport, desc_ep);
+			if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN)
+				instance.endpointIn = desc_ep->bEndpointAddress;
+			else
+				instance.endpointOut = desc_ep->bEndpointAddress;
+		}
+
+		length += tu_desc_len(p);
+		p = tu_desc_next(p);
+	}
+
+	if (instance.endpointOut)
+		usbd_edpt_xfer(rhport, instance.endpointOut, instance.out, sizeof(instance.out));
+
+	return length;
+}
+
+bool hidd_control_request(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+	return false;
+}
+
+bool hidd_control_complete(uint8_t rhport, tusb_control_request_t const *request)
+{
+	(void)rhport;
+	(void)request;
+	return true;
+}
+
+bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+	(void)result;
+	for (uint8_t i = 0; i < hidInstanceCount; i++)
+	{
+		HidInstance &instance = hidInstances[i];
+		if (ep_addr == instance.endpointOut)
+		{
+			tud_hid_set_report_cb(i, 0, HID_REPORT_TYPE_INVALID, instance.out, xferred_bytes);
+			usbd_edpt_xfer(rhport, instance.endpointOut, instance.out, sizeof(instance.out));
+		}
+	}
+
+	return true;
+}
+
+bool tud_hid_n_ready(uint8_t instance)
+{
+	return tud_ready() && instance < hidInstanceCount && hidInstances[instance].endpointIn
+		&& !usbd_edpt_busy(0, hidInstances[instance].endpointIn);
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint8_t len)
+{
+	TU_VERIFY(tud_hid_n_ready(instance));
+
+	HidInstance &hid = hidInstances[instance];
+	uint8_t length = 0;
+	if (report_id)
+		hid.report[length++] = report_id;
+
+	len = std::min<uint8_t>(len, sizeof(hid.report) - length);
+	memcpy(hid.report + length, report, len);
+	return usbd_edpt_xfer(0, hid.endpointIn, hid.report, length + len);
+}
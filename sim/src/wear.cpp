@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include "AnimationStorage.hpp"
+#include "FlashPROM.h"
+#include "storage.h"
+#include "sim.h"
+
+/**
+ * @brief Endurance run of the settings store, in virtual time.
+ *
+ * Each commit is what a hotkey does in play: mostly an LED brightness step, with a D-pad mode change
+ * every eighth. The store is loaded again from flash at the end to check the log replays to the last
+ * settings. The old store erased its one sector on every commit, so its count is simply `commits`.
+ * With -L the run ends with power lost in the middle of a flash write instead, and the next run on
+ * the same image shows the settings it loaded.
+ */
+void sim::wear(uint32_t commits)
+{
+	GamepadStore.start();
+
+	AnimationOptions animation = AnimationStore.getAnimationOptions();
+	GamepadOptions gamepad = GamepadStore.getGamepadOptions();
+	emit("wear %llu loaded brightness %u dpad %u\n", (unsigned long long)now(), animation.brightness, gamepad.dpadMode);
+	for (uint32_t i = 0; i < commits; i++)
+	{
+		animation.brightness = i % 5;
+		AnimationStore.setAnimationOptions(animation);
+		if (i % 8 == 0)
+		{
+			gamepad.dpadMode = static_cast<DpadMode>((i / 8) % 3);
+			GamepadStore.setGamepadOptions(gamepad);
+		}
+
+		GamepadStore.save();
+		while (EEPROM.isWriting())
+			sleep_ms(1);
+	}
+
+	GamepadStore.start();
+	AnimationOptions loadedAnimation = AnimationStore.getAnimationOptions();
+	GamepadOptions loadedGamepad = GamepadStore.getGamepadOptions();
+	bool intact = loadedAnimation.brightness == animation.brightness && loadedGamepad.dpadMode == gamepad.dpadMode;
+
+	uint32_t total = 0;
+	uint32_t most = 0;
+	for (uint32_t sector = 0; sector < EEPROM_SECTOR_COUNT; sector++)
+	{
+		uint32_t offset = EEPROM_REGION_START - XIP_BASE + sector * FLASH_SECTOR_SIZE;
+		uint32_t erases = flashErases(offset);
+		total += erases;
+		most = std::max(most, erases);
+		emit("wear %llu sector 0x%x erases %u\n", (unsigned long long)now(), offset, erases);
+	}
+
+	FlashPROMStats &stats = FlashPROM::stats;
+	emit("wear %llu commits %u records %u relocations %u erases %u stall max %u %s\n", (unsigned long long)now(),
+		stats.commits, stats.records, stats.relocations, total, stats.maxStallUs, intact ? "intact" : "lost");
+	fprintf(stderr, "sim: %u commits, %u sector erases, at most %u of one sector where the single sector store had %u, settings %s\n",
+		commits, total, most, commits, intact ? "intact" : "lost");
+
+	if (!intact)
+		finish(1, "settings lost");
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "debounce.h"
+
+void GamepadDebouncer::setup(DebounceMode mode, uint32_t values, uint32_t millis)
+{
+	this->mode = mode;
+	state = values;
+	active = 0;
+	lastMillis = millis;
+	clear(~0U);
+}
+
+void GamepadDebouncer::setWindow(uint8_t pin, uint8_t millis)
+{
+	if (pin >= 32)
+		return;
+
+	if (millis > DEBOUNCE_MAX_MILLIS)
+		millis = DEBOUNCE_MAX_MILLIS;
+
+	uint32_t mask = 1U << pin;
+	for (int i = 0; i < DEBOUNCE_COUNTER_BITS; i++)
+	{
+		if (millis & (1 << i))
+			window[i] |= mask;
+		else
+			window[i] &= ~mask;
+	}
+
+	if (millis == 0)
+		immediate |= mask;
+	else
+		immediate &= ~mask;
+
+	active &= ~mask;
+	clear(mask);
+}
+
+/**
+ * @brief Filter a new sample of the GPIO word, returns the debounced word.
+ */
+uint32_t GamepadDebouncer::update(uint32_t values, uint32_t millis)
+{
+	uint32_t ticks = millis - lastMillis;
+	lastMillis = millis;
+
+	// Every window has expired after this many ticks, no need to count further
+	if (ticks > DEBOUNCE_MAX_MILLIS)
+		ticks = DEBOUNCE_MAX_MILLIS;
+
+	if (mode == DEBOUNCE_MODE_EAGER)
+	{
+		while (ticks-- > 0 && active)
+		{
+			increment(active);
+			uint32_t done = active & expired();
+			active &= ~done;
+			clear(done);
+		}
+
+		uint32_t edges = (values ^ state) & ~active & ~immediate;
+		state ^= edges;
+		active |= edges;
+	}
+	else
+	{
+		// Any pin that bounced back to its debounced level restarts its window
+		uint32_t changed = (values ^ state) & ~immediate;
+		uint32_t fresh = changed & ~active;
+		active = changed;
+		clear(~active | fresh);
+
+		// A pin first seen in this sample has only been held since it, so it gets one tick at most
+		// however long ago the last update was. Pins already waiting count every tick they missed.
+		uint32_t counting = active;
+		while (ticks-- > 0 && counting)
+		{
+			increment(counting);
+			uint32_t done = counting & expired();
+			state ^= done;
+			active &= ~done;
+			clear(done);
+			counting = active & ~fresh;
+		}
+	}
+
+	state = (state & ~immediate) | (values & immediate);
+	return state;
+}
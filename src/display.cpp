@@ -6,6 +6,7 @@
 #include <string>
 #include "display.h"
 #include "storage.h"
+#include "usb_driver.h"
 #include "pico/stdlib.h"
 #include "OneBitDisplay.h"
 
@@ -100,6 +101,10 @@ void setStatusBar(Gamepad *gamepad)
 		case INPUT_MODE_SWITCH: statusBar += "SWITCH"; break;
 		case INPUT_MODE_XINPUT: statusBar += "XINPUT"; break;
 		case INPUT_MODE_CONFIG: statusBar += "CONFIG"; break;
+		default:
+			if (gamepad->options.inputMode == INPUT_MODE_KEYBOARD)
+				statusBar += "KEYBRD";
+			break;
 	}
 
 	switch (gamepad->options.dpadMode)
@@ -142,6 +147,17 @@ void DisplayModule::setup()
 	}
 }
 
+// The panel keeps its RAM while off, so the last screen is back as soon as it is on again
+void DisplayModule::suspend()
+{
+	obdPower(&obd, 0);
+}
+
+void DisplayModule::resume()
+{
+	obdPower(&obd, 1);
+}
+
 void DisplayModule::loop()
 {
 	// All screen updates should be handled in process() as they need to display ASAP
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "edgecapture.h"
+
+#define EDGE_CAPTURE_EVENTS (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
+
+EdgeCapture edgeCapture;
+
+static void edgeCallback(uint gpio, uint32_t events)
+{
+	InputEdge edge =
+	{
+		.timestamp = time_us_64(),
+		.values = ~gpio_get_all(),
+		.pin = static_cast<uint8_t>(gpio),
+		.events = static_cast<uint8_t>(events),
+	};
+
+	if (!edgeCapture.edges.push(edge))
+		edgeCapture.dropped++;
+}
+
+void EdgeCapture::start(uint32_t pinMask)
+{
+	stop();
+
+	this->pinMask = pinMask;
+	for (uint8_t pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+		if (pinMask & (1U << pin))
+			gpio_set_irq_enabled_with_callback(pin, EDGE_CAPTURE_EVENTS, true, &edgeCallback);
+}
+
+void EdgeCapture::stop()
+{
+	for (uint8_t pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+		if (pinMask & (1U << pin))
+			gpio_set_irq_enabled(pin, EDGE_CAPTURE_EVENTS, false);
+
+	pinMask = 0;
+	edges.clear();
+}
+
+/**
+ * @brief Consume all queued edges, returns the mask of pins that had an edge.
+ *
+ * The ring is in IRQ order, so the first edge popped is the earliest since the last drain. That is
+ * where the change the next report carries started, the same as the PIO sampler's edgeTime.
+ */
+uint32_t EdgeCapture::drain()
+{
+	uint32_t changed = 0;
+	InputEdge edge;
+
+	while (edges.pop(edge))
+	{
+		if (!changed)
+			edgeTime = edge.timestamp;
+
+		changed |= (1U << edge.pin);
+	}
+
+	return changed;
+}
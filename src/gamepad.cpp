@@ -7,16 +7,20 @@
 #include "gamepad.h"
 #include "display.h"
 #include "storage.h"
+#include "savescheduler.h"
 #include "display.h"
 #include "OneBitDisplay.h"
 
+// Maps the gathered dpad bits to their final value, indexed by [invertYAxis][dpad]
+static uint8_t dpadLookup[2][16];
+
 void Gamepad::setup()
 {
 	load();
 
 	// Configure pin mapping
 	f2Mask = (GAMEPAD_MASK_A1 | GAMEPAD_MASK_S2);
-	BoardOptions boardOptions = getBoardOptions();
+	BoardOptions boardOptions = (player == 0) ? getBoardOptions() : getPlayerBoardOptions(player);
 
 	mapDpadUp    = new GamepadButtonMapping(boardOptions.pinDpadUp,    GAMEPAD_MASK_UP);
 	mapDpadDown  = new GamepadButtonMapping(boardOptions.pinDpadDown,  GAMEPAD_MASK_DOWN);
@@ -48,6 +52,9 @@ void Gamepad::setup()
 
 	for (int i = 0; i < GAMEPAD_DIGITAL_INPUT_COUNT; i++)
 	{
+		if (gamepadMappings[i]->pin >= NUM_BANK0_GPIOS)
+			continue;
+
 		gpio_init(gamepadMappings[i]->pin);             // Initialize pin
 		gpio_set_dir(gamepadMappings[i]->pin, GPIO_IN); // Set as INPUT
 		gpio_pull_up(gamepadMappings[i]->pin);          // Set as PULLUP
@@ -58,43 +65,287 @@ void Gamepad::setup()
 		gpio_set_dir(PIN_SETTINGS, GPIO_IN); // Set as INPUT
 		gpio_pull_up(PIN_SETTINGS);          // Set as PULLUP
 	#endif
+
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		dpadLookup[0][i] = i;
+		dpadLookup[1][i] = (i & ~(GAMEPAD_MASK_UP | GAMEPAD_MASK_DOWN))
+			| ((i & GAMEPAD_MASK_UP)   ? GAMEPAD_MASK_DOWN : 0)
+			| ((i & GAMEPAD_MASK_DOWN) ? GAMEPAD_MASK_UP   : 0)
+		;
+	}
+
+	debounceOptions = getDebounceOptions();
+	if (primary == this)
+		debouncer.setup(debounceOptions.debounceMode, ~gpio_get_all(), to_ms_since_boot(get_absolute_time()));
+
+	mapPins();
+	if (primary == this)
+	{
+		inputSourceOptions = getInputSourceOptions();
+		setInputSource(inputSourceOptions.inputSource);
+	}
 }
 
-void Gamepad::read()
+void Gamepad::load()
 {
-	// Need to invert since we're using pullups
-	uint32_t values = ~gpio_get_all();
+	if (player == 0)
+		MPGS::load();
+	else
+		options = getPlayerOptions(player);
+}
+
+void Gamepad::save()
+{
+	if (player == 0)
+	{
+		MPGS::save();
+	}
+	else
+	{
+		setPlayerOptions(player, options);
+		mpgStorage->save();
+	}
+}
+
+void Gamepad::setInputSource(InputSource source)
+{
+	if (inputSource == INPUT_SOURCE_GPIO_IRQ)
+		edgeCapture.stop();
+	else if (inputSource == INPUT_SOURCE_PIO)
+		inputSampler.stop();
+
+	if (source == INPUT_SOURCE_GPIO_IRQ)
+		edgeCapture.start(inputMask);
+	else if (source == INPUT_SOURCE_PIO && !inputSampler.start(inputMask))
+		source = INPUT_SOURCE_GPIO; // No free state machine or DMA channel, fall back to polling
+
+	inputSource = source;
+}
+
+/**
+ * @brief The gamepad library's hotkeys, plus F2 with L1, R1 or L2 to read the pins by polling, edge IRQs
+ * or the PIO sampler from then on. The pick is saved like any other hotkey, and kept even when the PIO
+ * sampler falls back to polling, so holding the buttons doesn't retry it every cycle.
+ */
+GamepadHotkey Gamepad::hotkey()
+{
+	GamepadHotkey action = MPGS::hotkey();
+	if (primary != this || !pressedF2())
+		return action;
+
+	InputSource source = inputSourceOptions.inputSource;
+	if (pressedL1())
+		source = INPUT_SOURCE_GPIO;
+	else if (pressedR1())
+		source = INPUT_SOURCE_GPIO_IRQ;
+	else if (pressedL2())
+		source = INPUT_SOURCE_PIO;
+
+	if (source != inputSourceOptions.inputSource)
+	{
+		inputSourceOptions.inputSource = source;
+		setInputSourceOptions(inputSourceOptions);
+		mpgStorage->save();
+		setInputSource(source);
+	}
+
+	return action;
+}
+
+/**
+ * @brief Take new debounce settings without a reboot. The primary restarts its counters from the
+ * levels it last reported, and mapPins() hands it this player's windows again.
+ */
+void Gamepad::applyDebounceOptions(const DebounceOptions &options)
+{
+	debounceOptions = options;
+	if (primary == this)
+		debouncer.setup(options.debounceMode, debouncer.state, to_ms_since_boot(get_absolute_time()));
+
+	mapPins();
+}
+
+/**
+ * @brief Build the GPIO lookup tables used by read(). Must be called again whenever a mapping pin changes.
+ *
+ * Each table covers one byte of the GPIO word, and each entry holds the combined button, dpad and aux bits
+ * for that byte value, so read() only needs four loads and a few ORs. The pins and their debounce windows
+ * are handed to the primary, which reads them for this player.
+ */
+void Gamepad::mapPins()
+{
+	if (pinLookup == nullptr)
+		pinLookup = new uint32_t[GAMEPAD_PIN_LOOKUP_SLICES][GAMEPAD_PIN_LOOKUP_SIZE];
+
+	memset(pinLookup, 0, sizeof(uint32_t) * GAMEPAD_PIN_LOOKUP_SLICES * GAMEPAD_PIN_LOOKUP_SIZE);
+
+	pinMask = 0;
+
+	auto addPin = [this](uint8_t pin, uint32_t value)
+	{
+		if (pin >= NUM_BANK0_GPIOS)
+			return;
+
+		pinMask |= (1U << pin);
+
+		uint32_t *slice = pinLookup[pin / 8];
+		uint8_t bit = 1 << (pin % 8);
+		for (int i = 0; i < GAMEPAD_PIN_LOOKUP_SIZE; i++)
+			if (i & bit)
+				slice[i] |= value;
+	};
+
+	// Same order as gamepadMappings
+
+	// The first four mappings are the dpad directions
+	for (int i = 0; i < GAMEPAD_DIGITAL_INPUT_COUNT; i++)
+	{
+		uint32_t value = gamepadMappings[i]->buttonMask;
+		if (i < 4)
+			value <<= GAMEPAD_LOOKUP_DPAD_SHIFT;
+
+		addPin(gamepadMappings[i]->pin, value);
+		primary->debouncer.setWindow(gamepadMappings[i]->pin, debounceOptions.debounceMillis[i]);
+	}
 
 	#ifdef PIN_SETTINGS
-	state.aux = 0
-		| ((values & (1 << PIN_SETTINGS)) ? (1 << 0) : 0)
-	;
+		if (player == 0)
+			addPin(PIN_SETTINGS, 1 << GAMEPAD_LOOKUP_AUX_SHIFT);
 	#endif
 
-	state.dpad = 0
-		| ((values & mapDpadUp->pinMask)    ? (options.invertYAxis ? mapDpadDown->buttonMask : mapDpadUp->buttonMask) : 0)
-		| ((values & mapDpadDown->pinMask)  ? (options.invertYAxis ? mapDpadUp->buttonMask : mapDpadDown->buttonMask) : 0)
-		| ((values & mapDpadLeft->pinMask)  ? mapDpadLeft->buttonMask  : 0)
-		| ((values & mapDpadRight->pinMask) ? mapDpadRight->buttonMask : 0)
-	;
+	primary->setPlayerPins(player, pinMask);
+}
+
+void Gamepad::setPlayerPins(uint8_t index, uint32_t mask)
+{
+	playerPinMasks[index] = mask;
+
+	inputMask = 0;
+	for (uint8_t i = 0; i < GAMEPAD_PLAYERS_MAX; i++)
+		inputMask |= playerPinMasks[i];
+
+	if (inputSource == INPUT_SOURCE_GPIO_IRQ)
+		edgeCapture.start(inputMask);
+	else if (inputSource == INPUT_SOURCE_PIO)
+		inputSampler.setPinMask(inputMask);
+}
+
+void Gamepad::getFrame(InputFrame &frame)
+{
+	frame.buttons = state.buttons;
+	frame.aux     = state.aux;
+	frame.lx      = state.lx;
+	frame.ly      = state.ly;
+	frame.rx      = state.rx;
+	frame.ry      = state.ry;
+	frame.dpad    = state.dpad;
+	frame.lt      = state.lt;
+	frame.rt      = state.rt;
+}
+
+void Gamepad::setFrame(const InputFrame &frame)
+{
+	state.buttons = frame.buttons;
+	state.aux     = frame.aux;
+	state.lx      = frame.lx;
+	state.ly      = frame.ly;
+	state.rx      = frame.rx;
+	state.ry      = frame.ry;
+	state.dpad    = frame.dpad;
+	state.lt      = frame.lt;
+	state.rt      = frame.rt;
+}
+
+void GamepadChannel::publish(Gamepad &gamepad)
+{
+	InputFrame frame;
+
+	if (generation == 0 || memcmp(&publishedOptions, &gamepad.options, sizeof(GamepadOptions)) != 0)
+	{
+		publishedOptions = gamepad.options;
+		options.write(publishedOptions);
+		generation++;
+	}
+
+	gamepad.getFrame(frame);
+	frame.optionsGeneration = generation;
+	frames.write(frame);
+}
+
+bool GamepadChannel::receive(Gamepad &gamepad)
+{
+	InputFrame frame;
+
+	if (!frames.read(frame, frameSequence))
+		return false;
 
-	state.buttons = 0
-		| ((values & mapButtonB1->pinMask)  ? mapButtonB1->buttonMask  : 0)
-		| ((values & mapButtonB2->pinMask)  ? mapButtonB2->buttonMask  : 0)
-		| ((values & mapButtonB3->pinMask)  ? mapButtonB3->buttonMask  : 0)
-		| ((values & mapButtonB4->pinMask)  ? mapButtonB4->buttonMask  : 0)
-		| ((values & mapButtonL1->pinMask)  ? mapButtonL1->buttonMask  : 0)
-		| ((values & mapButtonR1->pinMask)  ? mapButtonR1->buttonMask  : 0)
-		| ((values & mapButtonL2->pinMask)  ? mapButtonL2->buttonMask  : 0)
-		| ((values & mapButtonR2->pinMask)  ? mapButtonR2->buttonMask  : 0)
-		| ((values & mapButtonS1->pinMask)  ? mapButtonS1->buttonMask  : 0)
-		| ((values & mapButtonS2->pinMask)  ? mapButtonS2->buttonMask  : 0)
-		| ((values & mapButtonL3->pinMask)  ? mapButtonL3->buttonMask  : 0)
-		| ((values & mapButtonR3->pinMask)  ? mapButtonR3->buttonMask  : 0)
-		| ((values & mapButtonA1->pinMask)  ? mapButtonA1->buttonMask  : 0)
-		| ((values & mapButtonA2->pinMask)  ? mapButtonA2->buttonMask  : 0)
+	if (frame.optionsGeneration != appliedGeneration)
+	{
+		options.read(gamepad.options, optionsSequence);
+		appliedGeneration = frame.optionsGeneration;
+	}
+
+	gamepad.setFrame(frame);
+	return true;
+}
+
+// The players after the first only map the primary's last read, so they must be read after it
+void Gamepad::read()
+{
+	if (primary != this)
+	{
+		map();
+		return;
+	}
+
+	uint64_t now = time_us_64();
+
+	// Need to invert since we're using pullups
+	uint32_t raw = (inputSource == INPUT_SOURCE_PIO) ? ~inputSampler.read(now) : ~gpio_get_all();
+
+	// Trace from the edge timestamp when there is one, otherwise from the first read that saw the change
+	if (inputSource == INPUT_SOURCE_PIO && inputSampler.edgeMask)
+		latencyTracer.begin(inputSampler.edgeTime);
+	else if (inputSource == INPUT_SOURCE_GPIO_IRQ && (edgeCapture.drain() & inputMask))
+		latencyTracer.begin(edgeCapture.edgeTime);
+	else if ((raw ^ rawValues) & inputMask)
+		latencyTracer.begin(now);
+
+	if ((raw ^ rawValues) & inputMask)
+		inputTrace.record(now, raw & inputMask);
+
+	rawValues = raw;
+	latencyTracer.mark(LATENCY_STAGE_READ, now);
+
+	uint32_t values = debouncer.update(raw, to_ms_since_boot(get_absolute_time()));
+	if ((values ^ debouncedValues) & inputMask)
+		latencyTracer.mark(LATENCY_STAGE_DEBOUNCE, time_us_64());
+
+	debouncedValues = values;
+	saveScheduler.pressed(values & inputMask);
+
+	map();
+}
+
+// Turns the primary's debounced GPIO word into this player's state
+void Gamepad::map()
+{
+	uint32_t values = primary->debouncedValues;
+	uint32_t mapped = 0
+		| pinLookup[0][(values >>  0) & 0xFF]
+		| pinLookup[1][(values >>  8) & 0xFF]
+		| pinLookup[2][(values >> 16) & 0xFF]
+		| pinLookup[3][(values >> 24) & 0xFF]
 	;
 
+	#ifdef PIN_SETTINGS
+	state.aux = mapped >> GAMEPAD_LOOKUP_AUX_SHIFT;
+	#endif
+
+	state.dpad = dpadLookup[options.invertYAxis][(mapped >> GAMEPAD_LOOKUP_DPAD_SHIFT) & 0x0F];
+	state.buttons = mapped & 0xFFFF;
+
 	state.lx = GAMEPAD_JOYSTICK_MID;
 	state.ly = GAMEPAD_JOYSTICK_MID;
 	state.rx = GAMEPAD_JOYSTICK_MID;
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "inputsampler.h"
+#include "inputsampler.pio.h"
+
+// DMA ring wrapping needs the buffer aligned to its size in bytes
+#define INPUT_SAMPLER_RING_BYTES (INPUT_SAMPLER_RING_SIZE * sizeof(uint32_t))
+
+static volatile uint32_t samples[INPUT_SAMPLER_RING_SIZE] __attribute__((aligned(INPUT_SAMPLER_RING_BYTES)));
+static const uint32_t reloadCount = 0xFFFFFFFF;
+
+InputSampler inputSampler;
+
+bool InputSampler::start(uint32_t pinMask, uint32_t rateHz)
+{
+	stop();
+
+	if (!pio_can_add_program(pio, &input_sampler_program))
+		return false;
+
+	sm = pio_claim_unused_sm(pio, false);
+	dataChannel = dma_claim_unused_channel(false);
+	reloadChannel = dma_claim_unused_channel(false);
+	if (sm < 0 || dataChannel < 0 || reloadChannel < 0)
+	{
+		stop();
+		return false;
+	}
+
+	offset = pio_add_program(pio, &input_sampler_program);
+	running = true;
+
+	this->pinMask = pinMask;
+	this->rateHz = rateHz;
+	periodNs = 1000000000 / rateHz;
+	ringUs = (INPUT_SAMPLER_RING_SIZE * periodNs) / 1000;
+	previous = gpio_get_all();
+	for (int i = 0; i < INPUT_SAMPLER_RING_SIZE; i++)
+		samples[i] = previous;
+
+	readIndex = 0;
+	lastRead = time_us_64();
+
+	// Drain the RX FIFO into the ring, wrapping the write address
+	dma_channel_config dataConfig = dma_channel_get_default_config(dataChannel);
+	channel_config_set_transfer_data_size(&dataConfig, DMA_SIZE_32);
+	channel_config_set_read_increment(&dataConfig, false);
+	channel_config_set_write_increment(&dataConfig, true);
+	channel_config_set_ring(&dataConfig, true, INPUT_SAMPLER_RING_BITS + 2);
+	channel_config_set_dreq(&dataConfig, pio_get_dreq(pio, sm, false));
+	channel_config_set_chain_to(&dataConfig, reloadChannel);
+	dma_channel_configure(dataChannel, &dataConfig, samples, &pio->rxf[sm], reloadCount, false);
+
+	// Restart the data channel whenever its transfer count runs out
+	dma_channel_config reloadConfig = dma_channel_get_default_config(reloadChannel);
+	channel_config_set_transfer_data_size(&reloadConfig, DMA_SIZE_32);
+	channel_config_set_read_increment(&reloadConfig, false);
+	channel_config_set_write_increment(&reloadConfig, false);
+	dma_channel_configure(reloadChannel, &reloadConfig, &dma_hw->ch[dataChannel].al1_transfer_count_trig, &reloadCount, 1, false);
+
+	dma_channel_start(dataChannel);
+	input_sampler_program_init(pio, sm, offset, rateHz);
+
+	return true;
+}
+
+// The clock divider was worked out from clk_sys, so periodNs and ringUs only hold while it is kept up to date
+void InputSampler::retime()
+{
+	if (running)
+		pio_sm_set_clkdiv(pio, sm, (float)clock_get_hz(clk_sys) / rateHz);
+}
+
+void InputSampler::stop()
+{
+	if (running)
+	{
+		pio_sm_set_enabled(pio, sm, false);
+		pio_remove_program(pio, &input_sampler_program, offset);
+		running = false;
+	}
+
+	if (sm >= 0)
+	{
+		pio_sm_clear_fifos(pio, sm);
+		pio_sm_unclaim(pio, sm);
+		sm = -1;
+	}
+
+	// Abort the reload channel on both sides so an abort of the data channel can't re-arm it
+	if (reloadChannel >= 0)
+		dma_channel_abort(reloadChannel);
+
+	if (dataChannel >= 0)
+	{
+		dma_channel_abort(dataChannel);
+		dma_channel_unclaim(dataChannel);
+		dataChannel = -1;
+	}
+
+	if (reloadChannel >= 0)
+	{
+		dma_channel_abort(reloadChannel);
+		dma_channel_unclaim(reloadChannel);
+		reloadChannel = -1;
+	}
+}
+
+/**
+ * @brief Scan the samples written since the last call, returns the newest GPIO word.
+ *
+ * Edge times are worked back from now by the sample period, so they resolve to one sample.
+ */
+uint32_t InputSampler::read(uint64_t now)
+{
+	uint32_t writeIndex = ((dma_hw->ch[dataChannel].write_addr - (uintptr_t)samples) / sizeof(uint32_t)) & INPUT_SAMPLER_RING_MASK;
+	uint32_t count = (writeIndex - readIndex) & INPUT_SAMPLER_RING_MASK;
+
+	// The ring has wrapped since the last read, only the newest sample is still meaningful
+	if (now - lastRead >= ringUs)
+	{
+		overruns++;
+		readIndex = (writeIndex - 1) & INPUT_SAMPLER_RING_MASK;
+		count = 1;
+	}
+
+	edgeMask = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t sample = samples[(readIndex + i) & INPUT_SAMPLER_RING_MASK];
+		uint32_t changed = (sample ^ previous) & pinMask;
+		if (changed)
+		{
+			if (!edgeMask)
+				edgeTime = now - ((count - 1 - i) * periodNs) / 1000;
+
+			edgeMask |= changed;
+		}
+
+		previous = sample;
+	}
+
+	readIndex = writeIndex;
+	lastRead = now;
+
+	return previous;
+}
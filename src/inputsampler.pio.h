@@ -0,0 +1,48 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------------- //
+// input_sampler //
+// ------------- //
+
+#define input_sampler_wrap_target 0
+#define input_sampler_wrap 0
+
+static const uint16_t input_sampler_program_instructions[] = {
+            //     .wrap_target
+    0x4000, //  0: in     pins, 32                   
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program input_sampler_program = {
+    .instructions = input_sampler_program_instructions,
+    .length = 1,
+    .origin = -1,
+};
+
+static inline pio_sm_config input_sampler_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + input_sampler_wrap_target, offset + input_sampler_wrap);
+    return c;
+}
+
+#include "hardware/clocks.h"
+static inline void input_sampler_program_init(PIO pio, uint sm, uint offset, float freq) {
+    pio_sm_config c = input_sampler_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, 0);
+    sm_config_set_in_shift(&c, false, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    float div = clock_get_hz(clk_sys) / freq;
+    sm_config_set_clkdiv(&c, div);
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif
+
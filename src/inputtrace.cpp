@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include "gamepad.h"
+#include "inputtrace.h"
+
+static_assert(INPUT_TRACE_PINS == GAMEPAD_DIGITAL_INPUT_COUNT, "one trace pin per gamepad mapping");
+static_assert(INPUT_TRACE_RECORDS <= UINT16_MAX, "the record count must fit the dump header");
+
+// Not cleared by the C runtime, validated by the header in setup()
+static InputTraceDump inputTraceDump __attribute__((section(".uninitialized_data.inputtrace")));
+
+InputTrace inputTrace;
+
+/**
+ * @brief Keep a trace from before a soft reboot as long as it was recorded on the same pins, so the
+ * settings at the start of the trace still describe it.
+ */
+void InputTrace::setup(Gamepad &gamepad)
+{
+	this->gamepad = &gamepad;
+	dump = &inputTraceDump;
+
+	InputTraceConfig config;
+	captureConfig(gamepad, config);
+
+	if (
+		dump->magic != INPUT_TRACE_MAGIC ||
+		dump->version != INPUT_TRACE_VERSION ||
+		dump->capacity != INPUT_TRACE_RECORDS ||
+		dump->head >= INPUT_TRACE_RECORDS ||
+		memcmp(dump->config.pins, config.pins, sizeof(config.pins)) != 0 ||
+		dump->config.settingsPin != config.settingsPin
+	) {
+		reset();
+	}
+}
+
+// Starts a new trace with the current settings
+void InputTrace::reset()
+{
+	memset(dump, 0, sizeof(InputTraceDump));
+	dump->magic = INPUT_TRACE_MAGIC;
+	dump->version = INPUT_TRACE_VERSION;
+	dump->capacity = INPUT_TRACE_RECORDS;
+	captureConfig(*gamepad, dump->config);
+}
+
+void InputTrace::captureConfig(Gamepad &gamepad, InputTraceConfig &config)
+{
+	memset(&config, 0, sizeof(InputTraceConfig));
+
+	for (int i = 0; i < INPUT_TRACE_PINS; i++)
+	{
+		config.pins[i] = gamepad.gamepadMappings[i]->pin;
+		config.debounceWindows[i] = gamepad.debounceOptions.debounceMillis[i];
+	}
+
+	config.debounceMode = gamepad.debounceOptions.debounceMode;
+	config.dpadMode     = gamepad.options.dpadMode;
+	config.socdMode     = gamepad.options.socdMode;
+	config.invertXAxis  = gamepad.options.invertXAxis;
+	config.invertYAxis  = gamepad.options.invertYAxis;
+	config.inputSource  = gamepad.inputSource;
+#ifdef PIN_SETTINGS
+	config.settingsPin  = PIN_SETTINGS;
+#else
+	config.settingsPin  = INPUT_TRACE_NO_PIN;
+#endif
+}
+
+/**
+ * @brief Put the recorded options and debounce settings back on a gamepad, for replay. The pins and
+ * input source stay as they are, the replay drives the pins through the current mapping.
+ */
+void InputTrace::applyConfig(Gamepad &gamepad, const InputTraceConfig &config)
+{
+	for (int i = 0; i < INPUT_TRACE_PINS; i++)
+		gamepad.debounceOptions.debounceMillis[i] = config.debounceWindows[i];
+
+	gamepad.debounceOptions.debounceMode = (DebounceMode)config.debounceMode;
+	gamepad.debouncer.mode = (DebounceMode)config.debounceMode;
+
+	gamepad.options.dpadMode    = (DpadMode)config.dpadMode;
+	gamepad.options.socdMode    = (SOCDMode)config.socdMode;
+	gamepad.options.invertXAxis = config.invertXAxis;
+	gamepad.options.invertYAxis = config.invertYAxis;
+	gamepad.mapPins();
+}
@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <stddef.h>
+#include "keyboard.h"
+
+KeyboardMapper keyboardMapper;
+
+// Modifiers have their own byte, every other key has a bit in the bitmap after it
+static void pressKey(uint32_t *words, uint8_t key)
+{
+	uint8_t *report = reinterpret_cast<uint8_t *>(words);
+	if (key >= KEYBOARD_MODIFIER_MIN && key <= KEYBOARD_MODIFIER_MAX)
+		report[offsetof(KeyboardReport, modifiers)] |= 1 << (key - KEYBOARD_MODIFIER_MIN);
+	else if (key != 0 && key <= KEYBOARD_KEY_MAX)
+		report[offsetof(KeyboardReport, keys) + key / 8] |= 1 << (key % 8);
+}
+
+void KeyboardMapper::setup(const KeyboardMapping &mapping)
+{
+	const struct
+	{
+		uint32_t input;
+		uint8_t key;
+	} inputKeys[KEYBOARD_INPUT_COUNT] =
+	{
+		{ GAMEPAD_MASK_UP,    mapping.keyDpadUp },
+		{ GAMEPAD_MASK_DOWN,  mapping.keyDpadDown },
+		{ GAMEPAD_MASK_LEFT,  mapping.keyDpadLeft },
+		{ GAMEPAD_MASK_RIGHT, mapping.keyDpadRight },
+		{ GAMEPAD_MASK_B1 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonB1 },
+		{ GAMEPAD_MASK_B2 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonB2 },
+		{ GAMEPAD_MASK_B3 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonB3 },
+		{ GAMEPAD_MASK_B4 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonB4 },
+		{ GAMEPAD_MASK_L1 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonL1 },
+		{ GAMEPAD_MASK_R1 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonR1 },
+		{ GAMEPAD_MASK_L2 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonL2 },
+		{ GAMEPAD_MASK_R2 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonR2 },
+		{ GAMEPAD_MASK_S1 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonS1 },
+		{ GAMEPAD_MASK_S2 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonS2 },
+		{ GAMEPAD_MASK_L3 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonL3 },
+		{ GAMEPAD_MASK_R3 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonR3 },
+		{ GAMEPAD_MASK_A1 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonA1 },
+		{ GAMEPAD_MASK_A2 << KEYBOARD_INPUT_BUTTON_SHIFT, mapping.keyButtonA2 },
+	};
+
+	memset(lookup, 0, sizeof(lookup));
+	for (uint8_t slice = 0; slice < KEYBOARD_LOOKUP_SLICES; slice++)
+	{
+		for (uint8_t value = 0; value < KEYBOARD_LOOKUP_SIZE; value++)
+		{
+			uint32_t inputs = (uint32_t)value << (slice * KEYBOARD_LOOKUP_BITS);
+			for (auto &inputKey : inputKeys)
+			{
+				if (inputs & inputKey.input)
+					pressKey(lookup[slice][value], inputKey.key);
+			}
+		}
+	}
+}
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "latency.h"
+#include "modeswitch.h"
+#include "pollstats.h"
+#include "savescheduler.h"
+#include "usb_driver.h"
+
+#define LATENCY_BUCKET_SUB_COUNT (1 << LATENCY_BUCKET_SUB_BITS)
+
+// Not cleared by the C runtime, validated by the header in setup()
+static LatencyStats latencyStats __attribute__((section(".uninitialized_data.latency")));
+
+LatencyTracer latencyTracer;
+
+void LatencyTracer::setup()
+{
+	stats = &latencyStats;
+
+	if (
+		stats->magic != LATENCY_STATS_MAGIC ||
+		stats->version != LATENCY_STATS_VERSION ||
+		stats->stageCount != LATENCY_STAGE_COUNT ||
+		stats->bucketCount != LATENCY_BUCKET_COUNT
+	) {
+		reset();
+	}
+}
+
+void LatencyTracer::reset()
+{
+	memset(stats, 0, sizeof(LatencyStats));
+	stats->magic = LATENCY_STATS_MAGIC;
+	stats->version = LATENCY_STATS_VERSION;
+	stats->stageCount = LATENCY_STAGE_COUNT;
+	stats->bucketCount = LATENCY_BUCKET_COUNT;
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+		stats->stages[i].minUs = UINT32_MAX;
+
+	nextStage = LATENCY_STAGE_COUNT;
+}
+
+void LatencyTracer::begin(uint64_t origin)
+{
+	if (active())
+	{
+		if (origin - this->origin < LATENCY_TRACE_TIMEOUT_US)
+			return;
+
+		stats->abandoned++;
+	}
+
+	this->origin = origin;
+	nextStage = LATENCY_STAGE_READ;
+}
+
+void LatencyTracer::record(LatencyStage stage, uint64_t now)
+{
+	add(stats->stages[stage], (now > origin) ? (now - origin) : 0);
+
+	if (++nextStage == LATENCY_STAGE_COUNT)
+		stats->traces++;
+}
+
+void LatencyTracer::add(LatencyStageStats &stageStats, uint32_t us)
+{
+	stageStats.count++;
+	stageStats.buckets[bucketIndex(us)]++;
+	if (us < stageStats.minUs)
+		stageStats.minUs = us;
+	if (us > stageStats.maxUs)
+		stageStats.maxUs = us;
+}
+
+uint32_t LatencyTracer::percentile(LatencyStage stage, uint16_t permille)
+{
+	return percentile(stats->stages[stage], permille);
+}
+
+/**
+ * @brief Estimate a percentile from the histogram, returns the upper bound of the matching bucket.
+ */
+uint32_t LatencyTracer::percentile(const LatencyStageStats &stageStats, uint16_t permille)
+{
+	if (stageStats.count == 0)
+		return 0;
+
+	uint32_t target = ((uint64_t)stageStats.count * permille + 999) / 1000;
+	uint32_t seen = 0;
+	for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+	{
+		seen += stageStats.buckets[i];
+		if (seen >= target)
+		{
+			uint32_t upper = (i + 1 < LATENCY_BUCKET_COUNT) ? bucketLowerBound(i + 1) - 1 : stageStats.maxUs;
+			if (upper > stageStats.maxUs)
+				upper = stageStats.maxUs;
+			if (upper < stageStats.minUs)
+				upper = stageStats.minUs;
+			return upper;
+		}
+	}
+
+	return stageStats.maxUs;
+}
+
+/**
+ * @brief Log-linear bucketing: exact below 8us, then 8 equal buckets per power of two.
+ */
+uint8_t LatencyTracer::bucketIndex(uint32_t us)
+{
+	if (us < LATENCY_BUCKET_SUB_COUNT)
+		return us;
+
+	uint8_t msb = 31 - __builtin_clz(us);
+	uint32_t index = LATENCY_BUCKET_SUB_COUNT * (msb - LATENCY_BUCKET_SUB_BITS + 1)
+		+ ((us >> (msb - LATENCY_BUCKET_SUB_BITS)) & (LATENCY_BUCKET_SUB_COUNT - 1));
+
+	return (index < LATENCY_BUCKET_COUNT) ? index : LATENCY_BUCKET_COUNT - 1;
+}
+
+uint32_t LatencyTracer::bucketLowerBound(uint8_t index)
+{
+	if (index < LATENCY_BUCKET_SUB_COUNT)
+		return index;
+
+	uint8_t msb = index / LATENCY_BUCKET_SUB_COUNT + LATENCY_BUCKET_SUB_BITS - 1;
+	return (LATENCY_BUCKET_SUB_COUNT + index % LATENCY_BUCKET_SUB_COUNT) << (msb - LATENCY_BUCKET_SUB_BITS);
+}
+
+/* USB driver hooks */
+
+// A traced edge or a mode switch can finish on any player's report, but the polling stats follow the first player's endpoint
+void report_queued_cb(uint8_t instance)
+{
+	uint64_t now = time_us_64();
+	latencyTracer.mark(LATENCY_STAGE_SEND, now);
+	saveScheduler.queued(instance, now);
+}
+
+void report_complete_cb(uint8_t instance)
+{
+	uint64_t now = time_us_64();
+	latencyTracer.mark(LATENCY_STAGE_COMPLETE, now);
+	inputModeSwitch.complete(now);
+	saveScheduler.complete(instance);
+	if (instance == 0)
+		pollTracker.complete(now, get_usb_frame());
+}
@@ -331,6 +331,22 @@ void LEDModule::process(Gamepad *gamepad)
 	queue_try_add(&buttonAnimationQueue, &buttonState);
 }
 
+void LEDModule::suspend()
+{
+	if (neopico != nullptr)
+		neopico->Off();
+}
+
+// Put the last frame back straight away, the animation carries on from it on the next loop
+void LEDModule::resume()
+{
+	if (neopico != nullptr)
+	{
+		neopico->SetFrame(frame);
+		neopico->Show();
+	}
+}
+
 void LEDModule::loop()
 {
 	if (ledOptions.dataPin < 0 || !time_reached(this->nextRunTime))
@@ -339,8 +355,9 @@ void LEDModule::loop()
 	AnimationHotkey action;
 	if (queue_try_remove(&baseAnimationQueue, &action))
 	{
+		int saveValue = 0;
 		as.HandleEvent(action);
-		queue_try_add(&animationSaveQueue, 0);
+		queue_try_add(&animationSaveQueue, &saveValue);
 	}
 
 	uint32_t buttonState;
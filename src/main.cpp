@@ -3,30 +3,49 @@
  * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
  */
 
-#define GAMEPAD_DEBOUNCE_MILLIS 5
-
 #include "BoardConfig.h"
 
 #include <vector>
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "pico/bootrom.h"
-#include "pico/util/queue.h"
+#include "hardware/watchdog.h"
 #include "tusb.h"
 
 #include "rndis/rndis.h"
 #include "usb_driver.h"
 #include "gp2040.h"
 #include "gamepad.h"
+#include "keyboard.h"
 #include "leds.h"
 #include "pleds.h"
 #include "display.h"
+#include "scheduler.h"
+#include "latency.h"
+#include "modeswitch.h"
+#include "power.h"
+#include "reportpipeline.h"
+#include "savescheduler.h"
+#include "telemetry.h"
 
 uint32_t getMillis() { return to_ms_since_boot(get_absolute_time()); }
 
 Gamepad gamepad(GAMEPAD_DEBOUNCE_MILLIS);
+#if GAMEPAD_PLAYERS > 1
+static Gamepad player2(GAMEPAD_DEBOUNCE_MILLIS, &GamepadStore, 1, &gamepad);
+#endif
+static Gamepad *players[GAMEPAD_PLAYERS] =
+{
+	&gamepad,
+#if GAMEPAD_PLAYERS > 1
+	&player2,
+#endif
+};
+static uint8_t playerCount = 1;
+static uint8_t playersReady = 1;
 static InputMode inputMode;
-queue_t gamepadQueue;
+static uint16_t lastFrame = 0; // Shared by the loops of every input mode, so a mode switch doesn't count a frame twice
+GamepadChannel gamepadChannel;
 
 DisplayModule displayModule;
 LEDModule ledModule;
@@ -38,8 +57,37 @@ std::vector<GPModule*> modules =
 	&pledModule,
 };
 
+template <InputMode Mode>
+static ReportPipeline<Mode> pipelines[GAMEPAD_PLAYERS];
+
+/**
+ * Runs in the USB service IRQ. On schedule, the next cycle queues a fresher report before the host's
+ * next poll, and a report pushed out from here would only block it, so the waiting report is only
+ * flushed once the loop has let its slot go by.
+ */
+template <InputMode Mode>
+static void flushReport()
+{
+	if (scheduler.isBehind(time_us_64()))
+	{
+		for (uint8_t i = 0; i < GAMEPAD_PLAYERS && i < playerCount; i++)
+			pipelines<Mode>[i].flush();
+	}
+}
+
+static usb_service_cb_t reportFlusher(InputMode mode)
+{
+	switch (static_cast<uint8_t>(mode))
+	{
+		case INPUT_MODE_KEYBOARD: return flushReport<INPUT_MODE_KEYBOARD>;
+		case INPUT_MODE_XINPUT:   return flushReport<INPUT_MODE_XINPUT>;
+		case INPUT_MODE_SWITCH:   return flushReport<INPUT_MODE_SWITCH>;
+		default:                  return flushReport<INPUT_MODE_HID>;
+	}
+}
+
 void setup();
-void loop();
+template <InputMode Mode> void loop();
 void core1();
 void webserver();
 
@@ -48,40 +96,109 @@ int main()
 	setup();
 	multicore_launch_core1(core1);
 
-	if (inputMode == INPUT_MODE_CONFIG)
+	// Pick the report pipeline per input mode, the loop never dispatches on it. An input mode switch
+	// in play ends the running loop, and the one for the new mode takes over.
+	while (1)
 	{
-		webserver();
+		InputMode mode = inputMode;
+		switch (static_cast<uint8_t>(mode))
+		{
+			case INPUT_MODE_CONFIG:
+				webserver();
+				break;
+
+			case INPUT_MODE_XINPUT:
+				while (inputMode == mode)
+					loop<INPUT_MODE_XINPUT>();
+				break;
+
+			case INPUT_MODE_SWITCH:
+				while (inputMode == mode)
+					loop<INPUT_MODE_SWITCH>();
+				break;
+
+			case INPUT_MODE_KEYBOARD:
+				while (inputMode == mode)
+					loop<INPUT_MODE_KEYBOARD>();
+				break;
+
+			default:
+				while (inputMode == mode)
+					loop<INPUT_MODE_HID>();
+				break;
+		}
 	}
-	else
+
+	return 0;
+}
+
+// Only HID mode takes extra players, and they share the first player's reads, so they are set up after it
+static void setupPlayers()
+{
+	playerCount = get_player_count();
+	for (; playersReady < GAMEPAD_PLAYERS && playersReady < playerCount; playersReady++)
 	{
-		while (1)
-			loop();
+		players[playersReady]->setup();
+		pipelines<INPUT_MODE_HID>[playersReady].instance = playersReady;
 	}
+}
 
-	return 0;
+// Re-enumerate in another input mode without a reboot, every pipeline starts over on the new connection
+static void switchInputMode(InputMode mode)
+{
+	if (USB_SERVICE_IRQ)
+		start_usb_service_irq(reportFlusher(mode));
+
+	for (uint8_t i = 0; i < GAMEPAD_PLAYERS; i++)
+	{
+		pipelines<INPUT_MODE_XINPUT>[i].reset();
+		pipelines<INPUT_MODE_SWITCH>[i].reset();
+		pipelines<INPUT_MODE_HID>[i].reset();
+		pipelines<INPUT_MODE_KEYBOARD>[i].reset();
+	}
+
+	saveScheduler.reset();
+
+	if (!inputModeSwitch.run(gamepad, mode))
+	{
+		if (USB_SERVICE_IRQ)
+			start_usb_service_irq(reportFlusher(inputMode));
+		return;
+	}
+
+	inputMode = mode;
+	setupPlayers();
 }
 
 void setup()
 {
 	// Start storage before anything else
 	GamepadStore.start();
+	latencyTracer.setup();
+	pollTracker.setup();
 	gamepad.setup();
+	inputTrace.setup(gamepad);
+	keyboardMapper.setup(getKeyboardMapping());
 
 	// Check for input mode override
 	gamepad.read();
 	inputMode = gamepad.options.inputMode;
 	if (gamepad.pressedS2())
 		inputMode = INPUT_MODE_CONFIG;
+	else if (watchdog_caused_reboot() && watchdog_hw->scratch[0] == LATENCY_CONFIG_REBOOT_MAGIC)
+		inputMode = INPUT_MODE_CONFIG;
 	else if (gamepad.pressedB3())
 		inputMode = INPUT_MODE_HID;
 	else if (gamepad.pressedB1())
 		inputMode = INPUT_MODE_SWITCH;
 	else if (gamepad.pressedB2())
 		inputMode = INPUT_MODE_XINPUT;
+	else if (gamepad.pressedB4())
+		inputMode = INPUT_MODE_KEYBOARD;
 	else if (gamepad.pressedF1() && gamepad.pressedUp())
 		reset_usb_boot(0, 0);
 
-	queue_init(&gamepadQueue, sizeof(Gamepad), 1);
+	watchdog_hw->scratch[0] = 0;
 
 	for (auto it = modules.begin(); it != modules.end();)
 	{
@@ -101,55 +218,104 @@ void setup()
 		gamepad.save();
 	}
 
-	initialize_driver(inputMode);
+	// The web configurator serves the trace as it was before the reboot, so only record in play
+	if (!configMode)
+	{
+		inputTrace.start();
+		telemetry.setup();
+		saveScheduler.setup(SAVE_IDLE_MS);
+	}
+
+	initialize_driver(inputMode, telemetry.isEnabled(), GAMEPAD_PLAYERS);
+	setupPlayers();
+
+	if (USB_SERVICE_IRQ)
+		start_usb_service_irq(reportFlusher(inputMode));
+
+	scheduler.setup(SCHEDULER_LEAD_US);
 }
 
+template <InputMode Mode>
 void loop()
 {
-	static void *report;
-	static const uint16_t reportSize = gamepad.getReportSize();
-	static const uint32_t intervalMS = 1;
-	static uint32_t nextRuntime = 0;
-	static uint8_t featureData[32] = { };
-	static Gamepad snapshot;
+	usb_task();
+	powerManager.task();
 
-	if (getMillis() - nextRuntime < 0)
+	uint64_t now = time_us_64();
+	uint16_t frame = get_usb_frame();
+	if (frame != lastFrame)
+	{
+		lastFrame = frame;
+		scheduler.onFrame(now);
+		pollTracker.frame(frame);
+	}
+
+	// An edge IRQ means fresh input, so don't wait for the scheduled slot
+	if (!scheduler.ready(now) && !gamepad.hasPendingInput())
 		return;
 
+	scheduler.begin(now);
+
 	gamepad.read();
-#if GAMEPAD_DEBOUNCE_MILLIS > 0
-	gamepad.debounce();
-#endif
 	gamepad.hotkey();
 	gamepad.process();
-	report = gamepad.getReport();
-	send_report(report, reportSize);
+	pipelines<Mode>[0].run(gamepad, now);
+
+	// The other players map the same debounced read, so each only adds its lookups, process() and report
+	for (uint8_t i = 1; i < GAMEPAD_PLAYERS && i < playerCount; i++)
+	{
+		players[i]->read();
+		players[i]->process();
+		pipelines<Mode>[i].run(*players[i], now);
+	}
 
-	memset(featureData, 0, sizeof(featureData));
-	receive_report(featureData);
-	if (featureData[0])
-		queue_try_add(&pledModule.featureQueue, featureData);
+	scheduler.complete(time_us_64());
 
-	tud_task();
+	// Reboot into the web configurator without losing the latency stats
+	if (gamepad.pressedF1() && gamepad.pressedA2())
+	{
+		watchdog_hw->scratch[0] = LATENCY_CONFIG_REBOOT_MAGIC;
+		watchdog_reboot(0, SRAM_END, 10);
+		while (1);
+	}
 
-	if (queue_is_empty(&gamepadQueue))
+	InputMode requestedMode = inputModeSwitch.hotkey(gamepad, Mode);
+	if (requestedMode != Mode)
 	{
-		memcpy(&snapshot, &gamepad, sizeof(Gamepad));
-		queue_try_add(&gamepadQueue, &snapshot);
+		switchInputMode(requestedMode);
+		return;
 	}
 
-	nextRuntime = getMillis() + intervalMS;
+	gamepadChannel.publish(gamepad);
+
+	// The report is queued, so the rest of the cycle is free for telemetry
+	if (telemetry.isEnabled())
+		telemetry.task(time_us_64());
 }
 
 void core1()
 {
 	multicore_lockout_victim_init();
 
+	// core1 keeps its own Gamepad, only the state and options are updated from core0 after this
+	static Gamepad snapshot;
+	snapshot.f1Mask = gamepad.f1Mask;
+	snapshot.f2Mask = gamepad.f2Mask;
+
 	while (1)
 	{
-		static Gamepad snapshot;
+		if (powerManager.isSuspended())
+		{
+			for (auto module : modules)
+				module->suspend();
+
+			powerManager.park();
 
-		if (queue_try_remove(&gamepadQueue, &snapshot))
+			for (auto module : modules)
+				module->resume();
+		}
+
+		if (gamepadChannel.receive(snapshot))
 		{
 			for (auto module : modules)
 				module->process(&snapshot);
@@ -162,23 +328,14 @@ void core1()
 
 void webserver()
 {
-	static Gamepad snapshot;
-
 	rndis_init();
 	while (1)
 	{
 		gamepad.read();
-#if GAMEPAD_DEBOUNCE_MILLIS > 0
-		gamepad.debounce();
-#endif
 		gamepad.hotkey();
 		gamepad.process();
 
-		if (queue_is_empty(&gamepadQueue))
-		{
-			memcpy(&snapshot, &gamepad, sizeof(Gamepad));
-			queue_try_add(&gamepadQueue, &snapshot);
-		}
+		gamepadChannel.publish(gamepad);
 
 		rndis_task();
 	}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "modeswitch.h"
+#include "pico/stdlib.h"
+#include "usb_driver.h"
+
+InputModeSwitch inputModeSwitch;
+
+// Same buttons as at boot, with F2 held: B1 for Switch, B2 for XInput, B3 for DirectInput/PS3 and B4 for keyboard
+InputMode InputModeSwitch::hotkey(Gamepad &gamepad, InputMode current)
+{
+	if (!gamepad.pressedF2())
+		return current;
+	else if (gamepad.pressedB1())
+		return INPUT_MODE_SWITCH;
+	else if (gamepad.pressedB2())
+		return INPUT_MODE_XINPUT;
+	else if (gamepad.pressedB3())
+		return INPUT_MODE_HID;
+	else if (gamepad.pressedB4())
+		return INPUT_MODE_KEYBOARD;
+	else
+		return current;
+}
+
+// Returns false when the USB mode can't be switched in place, as in the web configurator
+bool InputModeSwitch::run(Gamepad &gamepad, InputMode mode)
+{
+	startUs = time_us_64();
+	waiting = false;
+
+	usb_service_lock();
+	bool disconnected = disconnect_driver();
+	usb_service_unlock();
+
+	if (!disconnected)
+		return false;
+
+	// Saving only updates the cache, FlashPROM writes it out EEPROM_WRITE_WAIT later. That lands in
+	// the host's 100ms attach debounce after the reconnect, when nothing is asked of the device.
+	gamepad.options.inputMode = mode;
+	gamepad.save();
+
+	uint64_t elapsedUs = time_us_64() - startUs;
+	if (elapsedUs < USB_DETACH_MS * 1000)
+		sleep_us(USB_DETACH_MS * 1000 - elapsedUs);
+
+	stats.switches++;
+	waiting = true;
+
+	usb_service_lock();
+	reconnect_driver(mode);
+	usb_service_unlock();
+
+	return true;
+}
+
+void InputModeSwitch::finish(uint64_t now)
+{
+	waiting = false;
+	stats.completed++;
+	stats.lastUs = now - startUs;
+	if (stats.lastUs > stats.maxUs)
+		stats.maxUs = stats.lastUs;
+}
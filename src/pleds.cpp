@@ -4,12 +4,12 @@
  */
 
 #include <vector>
-#include "pico/util/queue.h"
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
 #include "GamepadEnums.h"
 #include "Animation.hpp"
 #include "pleds.h"
+#include "usb_driver.h"
 #include "xinput_driver.h"
 
 const int PLED_PINS[] = {PLED1_PIN, PLED2_PIN, PLED3_PIN, PLED4_PIN};
@@ -23,7 +23,7 @@ void setRGBPLEDs(uint32_t *frame)
 			frame[PLED_PINS[i]] = rgbPLEDValues[i];
 }
 
-PLEDAnimationState getXInputAnimation(uint8_t *data)
+PLEDAnimationState getXInputAnimation(uint8_t pattern)
 {
 	PLEDAnimationState animationState =
 	{
@@ -32,52 +32,48 @@ PLEDAnimationState getXInputAnimation(uint8_t *data)
 		.speed = PLED_SPEED_OFF,
 	};
 
-	// Check first byte for LED payload
-	if (data[0] == 0x01)
+	switch (pattern)
 	{
-		switch (data[2])
-		{
-			case XINPUT_PLED_BLINKALL:
-			case XINPUT_PLED_ROTATE:
-			case XINPUT_PLED_BLINK:
-			case XINPUT_PLED_SLOWBLINK:
-			case XINPUT_PLED_ALTERNATE:
-				animationState.state = (PLED_STATE_LED1 | PLED_STATE_LED2 | PLED_STATE_LED3 | PLED_STATE_LED4);
-				animationState.animation = PLED_ANIM_BLINK;
-				animationState.speed = PLED_SPEED_FAST;
-				break;
+		case XINPUT_PLED_BLINKALL:
+		case XINPUT_PLED_ROTATE:
+		case XINPUT_PLED_BLINK:
+		case XINPUT_PLED_SLOWBLINK:
+		case XINPUT_PLED_ALTERNATE:
+			animationState.state = (PLED_STATE_LED1 | PLED_STATE_LED2 | PLED_STATE_LED3 | PLED_STATE_LED4);
+			animationState.animation = PLED_ANIM_BLINK;
+			animationState.speed = PLED_SPEED_FAST;
+			break;
 
-			case XINPUT_PLED_FLASH1:
-			case XINPUT_PLED_ON1:
-				animationState.state = PLED_STATE_LED1;
-				animationState.animation = PLED_ANIM_SOLID;
-				animationState.speed = PLED_SPEED_OFF;
-				break;
+		case XINPUT_PLED_FLASH1:
+		case XINPUT_PLED_ON1:
+			animationState.state = PLED_STATE_LED1;
+			animationState.animation = PLED_ANIM_SOLID;
+			animationState.speed = PLED_SPEED_OFF;
+			break;
 
-			case XINPUT_PLED_FLASH2:
-			case XINPUT_PLED_ON2:
-				animationState.state = PLED_STATE_LED2;
-				animationState.animation = PLED_ANIM_SOLID;
-				animationState.speed = PLED_SPEED_OFF;
-				break;
+		case XINPUT_PLED_FLASH2:
+		case XINPUT_PLED_ON2:
+			animationState.state = PLED_STATE_LED2;
+			animationState.animation = PLED_ANIM_SOLID;
+			animationState.speed = PLED_SPEED_OFF;
+			break;
 
-			case XINPUT_PLED_FLASH3:
-			case XINPUT_PLED_ON3:
-				animationState.state = PLED_STATE_LED3;
-				animationState.animation = PLED_ANIM_SOLID;
-				animationState.speed = PLED_SPEED_OFF;
-				break;
+		case XINPUT_PLED_FLASH3:
+		case XINPUT_PLED_ON3:
+			animationState.state = PLED_STATE_LED3;
+			animationState.animation = PLED_ANIM_SOLID;
+			animationState.speed = PLED_SPEED_OFF;
+			break;
 
-			case XINPUT_PLED_FLASH4:
-			case XINPUT_PLED_ON4:
-				animationState.state = PLED_STATE_LED4;
-				animationState.animation = PLED_ANIM_SOLID;
-				animationState.speed = PLED_SPEED_OFF;
-				break;
+		case XINPUT_PLED_FLASH4:
+		case XINPUT_PLED_ON4:
+			animationState.state = PLED_STATE_LED4;
+			animationState.animation = PLED_ANIM_SOLID;
+			animationState.speed = PLED_SPEED_OFF;
+			break;
 
-			default:
-				break;
-		}
+		default:
+			break;
 	}
 
 	return animationState;
@@ -134,8 +130,6 @@ void RGBPlayerLEDs::display()
 
 void PLEDModule::setup()
 {
-	queue_init(&featureQueue, PLED_REPORT_SIZE, 20);
-
 	enabled = PLED_TYPE != PLED_TYPE_NONE;
 	if (enabled)
 	{
@@ -156,25 +150,29 @@ void PLEDModule::setup()
 
 void PLEDModule::loop()
 {
-	if (pleds != nullptr)
-		pleds->display();
-}
+	OutputReport report;
 
-void PLEDModule::process(Gamepad *gamepad)
-{
-	static uint8_t featureData[PLED_REPORT_SIZE];
-
-	if (queue_try_remove(&featureQueue, featureData))
+	while (receive_output_report(&report))
 	{
-		inputMode = gamepad->options.inputMode;
+		if (report.type != OUTPUT_REPORT_LED)
+			continue;
+
 		switch (inputMode)
 		{
 			case INPUT_MODE_XINPUT:
-				animationState = getXInputAnimation(featureData);
+				animationState = getXInputAnimation(report.values[0]);
 				break;
 		}
 
 		if (pleds != nullptr && animationState.animation != PLED_ANIM_NONE)
 			pleds->animate(animationState);
 	}
+
+	if (pleds != nullptr)
+		pleds->display();
+}
+
+void PLEDModule::process(Gamepad *gamepad)
+{
+	inputMode = gamepad->options.inputMode;
 }
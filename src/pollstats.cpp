@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include "pollstats.h"
+
+// Not cleared by the C runtime, validated by the header in setup()
+static PollStats pollStats __attribute__((section(".uninitialized_data.pollstats")));
+
+PollTracker pollTracker;
+
+void PollTracker::setup()
+{
+	stats = &pollStats;
+
+	if (
+		stats->magic != POLL_STATS_MAGIC ||
+		stats->version != POLL_STATS_VERSION ||
+		stats->histogramCount != POLL_HISTOGRAM_COUNT ||
+		stats->bucketCount != LATENCY_BUCKET_COUNT
+	) {
+		reset();
+	}
+}
+
+void PollTracker::reset()
+{
+	memset(stats, 0, sizeof(PollStats));
+	stats->magic = POLL_STATS_MAGIC;
+	stats->version = POLL_STATS_VERSION;
+	stats->histogramCount = POLL_HISTOGRAM_COUNT;
+	stats->bucketCount = LATENCY_BUCKET_COUNT;
+	for (int i = 0; i < POLL_HISTOGRAM_COUNT; i++)
+		stats->histograms[i].minUs = UINT32_MAX;
+
+	armed = false;
+	completed = false;
+}
+
+// Called by the main loop whenever it sees the frame number change
+void PollTracker::frame(uint16_t frame)
+{
+	uint16_t elapsed = (frame - lastFrame) & POLL_FRAME_MASK;
+	if (framed && elapsed <= POLL_FRAME_GAP_MAX)
+	{
+		stats->frames += elapsed;
+		stats->framesSkipped += elapsed - 1;
+	}
+
+	lastFrame = frame;
+	framed = true;
+}
+
+// A report built from the input sampled at sampleUs went onto the IN endpoint
+void PollTracker::queued(uint64_t sampleUs, uint16_t frame)
+{
+	this->sampleUs = sampleUs;
+
+	// The endpoint is busy until a completion, so queueing in the same frame means it was armed for the next poll
+	armed = completed && frame == completeFrame;
+}
+
+void PollTracker::complete(uint64_t now, uint16_t frame)
+{
+	stats->completions++;
+	LatencyTracer::add(stats->histograms[POLL_HISTOGRAM_STALENESS], (now > sampleUs) ? (now - sampleUs) : 0);
+
+	if (armed)
+	{
+		uint32_t intervalUs = now - completeUs;
+		uint16_t frames = (frame - completeFrame) & POLL_FRAME_MASK;
+		uint32_t gridUs = frames * POLL_FRAME_US;
+
+		stats->intervals++;
+		stats->intervalFrames[(frames < POLL_INTERVAL_FRAMES_MAX) ? frames : POLL_INTERVAL_FRAMES_MAX]++;
+		LatencyTracer::add(stats->histograms[POLL_HISTOGRAM_INTERVAL], intervalUs);
+		LatencyTracer::add(stats->histograms[POLL_HISTOGRAM_JITTER], (intervalUs > gridUs) ? intervalUs - gridUs : gridUs - intervalUs);
+	}
+
+	armed = false;
+	completed = true;
+	completeFrame = frame;
+	completeUs = now;
+}
@@ -0,0 +1,121 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "power.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include "inputsampler.h"
+#include "usb_driver.h"
+
+PowerManager powerManager;
+
+void PowerManager::suspend(bool remoteWakeup)
+{
+	remoteWakeupEnabled = remoteWakeup;
+	wakeSignalled = false;
+	suspendRequested = true;
+}
+
+void PowerManager::resume()
+{
+	resumeUs = time_us_64();
+	suspendRequested = false;
+}
+
+void PowerManager::task()
+{
+	if (suspendRequested)
+	{
+		if (state == POWER_ACTIVE)
+		{
+			state = POWER_SUSPENDING;
+			stats.suspends++;
+		}
+		else if (state == POWER_SUSPENDING && core1Parked)
+		{
+			lowerClock();
+			state = POWER_SUSPENDED;
+		}
+	}
+	else if (state != POWER_ACTIVE)
+	{
+		if (state == POWER_SUSPENDED)
+			restoreClock();
+
+		state = POWER_ACTIVE;
+		__sev();
+
+		// A suspend straight after would otherwise lower the clock under core1 on its way out
+		while (core1Parked)
+			tight_loop_contents();
+
+		stats.lastResumeUs = time_us_64() - resumeUs;
+		if (stats.lastResumeUs > stats.maxResumeUs)
+			stats.maxResumeUs = stats.lastResumeUs;
+	}
+}
+
+// Once per suspend, a held button doesn't need to ask again every cycle
+void PowerManager::wake()
+{
+	if (wakeSignalled || !remoteWakeupEnabled)
+		return;
+
+	if (tud_remote_wakeup())
+	{
+		wakeSignalled = true;
+		stats.wakeups++;
+	}
+}
+
+void PowerManager::park()
+{
+	core1Parked = true;
+	while (state != POWER_ACTIVE)
+		__wfe();
+	core1Parked = false;
+}
+
+// The USB controller needs clk_sys at least as fast as clk_usb, so the USB PLL's 48MHz is as low as it goes.
+// clk_peri runs from clk_sys out of reset, so it drops with it.
+void PowerManager::lowerClock()
+{
+	sysClockHz = clock_get_hz(clk_sys);
+	sysPllRefDiv = (pll_sys->cs & PLL_CS_REFDIV_BITS) >> PLL_CS_REFDIV_LSB;
+	sysPllPostDiv1 = (pll_sys->prim & PLL_PRIM_POSTDIV1_BITS) >> PLL_PRIM_POSTDIV1_LSB;
+	sysPllPostDiv2 = (pll_sys->prim & PLL_PRIM_POSTDIV2_BITS) >> PLL_PRIM_POSTDIV2_LSB;
+	sysPllVcoHz = XOSC_MHZ * MHZ / sysPllRefDiv * (pll_sys->fbdiv_int & PLL_FBDIV_INT_BITS);
+	periClockHz = clock_get_hz(clk_peri);
+	periAuxSrc = (clocks_hw->clk[clk_peri].ctrl & CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS) >> CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB;
+
+	uint32_t usbClockHz = clock_get_hz(clk_usb);
+	clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+		usbClockHz, usbClockHz);
+	pll_deinit(pll_sys);
+	inputSampler.retime();
+}
+
+// Not set_sys_clock_khz(), which would also move clk_peri over to the USB PLL's 48MHz
+void PowerManager::restoreClock()
+{
+	pll_init(pll_sys, sysPllRefDiv, sysPllVcoHz, sysPllPostDiv1, sysPllPostDiv2);
+	clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+		sysClockHz, sysClockHz);
+	clock_configure(clk_peri, 0, periAuxSrc, periClockHz, periClockHz);
+	inputSampler.retime();
+}
+
+void usb_suspend_cb(bool remote_wakeup_en)
+{
+	powerManager.suspend(remote_wakeup_en);
+}
+
+void usb_resume_cb(void)
+{
+	powerManager.resume();
+}
@@ -0,0 +1,36 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "savescheduler.h"
+#include "pico/stdlib.h"
+#include "FlashPROM.h"
+#include "scheduler.h"
+
+SaveScheduler saveScheduler;
+
+static bool saveGate(uint32_t us)
+{
+	return saveScheduler.allows(us);
+}
+
+void SaveScheduler::setup(uint32_t idleMs)
+{
+	idleUs = idleMs * 1000;
+	lastInputUs = time_us_32();
+	inFlight = 0;
+	EEPROM.setWriteGate(saveGate);
+}
+
+bool SaveScheduler::allows(uint32_t us)
+{
+	uint64_t now = time_us_64();
+	if (inFlight || static_cast<uint32_t>(now) - lastInputUs < idleUs)
+		return false;
+
+	if (us >= SCHEDULER_FRAME_US)
+		return pressedPins == 0;
+
+	return !scheduler.isBusy(now, us);
+}
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "scheduler.h"
+
+Scheduler scheduler;
+
+void Scheduler::setup(uint32_t leadUs)
+{
+	if (leadUs >= SCHEDULER_FRAME_US)
+		leadUs = SCHEDULER_FRAME_US - 1;
+
+	this->leadUs = leadUs;
+	locked = false;
+	nextRun = 0;
+	stats = { };
+	stats.minSlackUs = SCHEDULER_FRAME_US;
+}
+
+/**
+ * @brief Record a start-of-frame. SOFs are detected by polling, so they are only ever seen late:
+ * an earlier than predicted SOF is taken as-is, a later one only nudges the prediction.
+ */
+void Scheduler::onFrame(uint64_t now)
+{
+	uint64_t predicted = lastSof + SCHEDULER_FRAME_US;
+	if (!locked || now < predicted || (now - predicted) > (SCHEDULER_FRAME_US / 2))
+		lastSof = now;
+	else
+		lastSof = predicted + ((now - predicted) >> 3);
+
+	locked = true;
+	nextRun = lastSof + SCHEDULER_FRAME_US - leadUs;
+}
+
+bool Scheduler::ready(uint64_t now)
+{
+	if (!isLocked(now) && now >= nextRun)
+	{
+		// No SOF to follow, run once per frame from the timer
+		nextRun = now;
+		stats.unlocked++;
+	}
+
+	return now >= nextRun;
+}
+
+void Scheduler::begin(uint64_t now)
+{
+	running = true;
+	cycleStart = now;
+	deadline = isLocked(now) ? nextFrame() : now + leadUs;
+
+	// Only one cycle per frame unless an input edge forces an early one
+	if (now >= nextRun)
+		nextRun += SCHEDULER_FRAME_US;
+}
+
+void Scheduler::complete(uint64_t now)
+{
+	running = false;
+	int32_t slack = static_cast<int32_t>(static_cast<int64_t>(deadline) - static_cast<int64_t>(now));
+
+	stats.cycles++;
+	stats.lastRunUs = now - cycleStart;
+	if (stats.lastRunUs > stats.maxRunUs)
+		stats.maxRunUs = stats.lastRunUs;
+
+	stats.lastSlackUs = slack;
+	if (slack < stats.minSlackUs)
+		stats.minSlackUs = slack;
+
+	if (slack < 0)
+		stats.missed++;
+	else
+		stats.totalSlackUs += slack;
+}
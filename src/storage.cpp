@@ -80,6 +80,256 @@ void setLEDOptions(LEDOptions options)
 	EEPROM.set(LED_STORAGE_INDEX, options);
 }
 
+/* Debounce stuffs */
+
+DebounceOptions getDebounceOptions()
+{
+	DebounceOptions options;
+	EEPROM.get(DEBOUNCE_STORAGE_INDEX, options);
+
+	uint32_t lastCRC = options.checksum;
+	options.checksum = 0;
+	if (CRC32::calculate(&options) != lastCRC)
+	{
+		options.debounceMode = GAMEPAD_DEBOUNCE_MODE;
+		for (auto &millis : options.debounceMillis)
+			millis = GAMEPAD_DEBOUNCE_MILLIS;
+	}
+
+	return options;
+}
+
+void setDebounceOptions(DebounceOptions options)
+{
+	options.checksum = 0;
+	options.checksum = CRC32::calculate(&options);
+	EEPROM.set(DEBOUNCE_STORAGE_INDEX, options);
+}
+
+/* Player stuffs */
+
+#ifndef PIN_P2_DPAD_UP
+#define PIN_P2_DPAD_UP    0xFF
+#endif
+#ifndef PIN_P2_DPAD_DOWN
+#define PIN_P2_DPAD_DOWN  0xFF
+#endif
+#ifndef PIN_P2_DPAD_LEFT
+#define PIN_P2_DPAD_LEFT  0xFF
+#endif
+#ifndef PIN_P2_DPAD_RIGHT
+#define PIN_P2_DPAD_RIGHT 0xFF
+#endif
+#ifndef PIN_P2_BUTTON_B1
+#define PIN_P2_BUTTON_B1  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_B2
+#define PIN_P2_BUTTON_B2  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_B3
+#define PIN_P2_BUTTON_B3  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_B4
+#define PIN_P2_BUTTON_B4  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_L1
+#define PIN_P2_BUTTON_L1  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_R1
+#define PIN_P2_BUTTON_R1  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_L2
+#define PIN_P2_BUTTON_L2  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_R2
+#define PIN_P2_BUTTON_R2  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_S1
+#define PIN_P2_BUTTON_S1  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_S2
+#define PIN_P2_BUTTON_S2  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_L3
+#define PIN_P2_BUTTON_L3  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_R3
+#define PIN_P2_BUTTON_R3  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_A1
+#define PIN_P2_BUTTON_A1  0xFF
+#endif
+#ifndef PIN_P2_BUTTON_A2
+#define PIN_P2_BUTTON_A2  0xFF
+#endif
+
+// Unmapped pins are left at 0xFF, which the gamepad skips. Only a second player has pins so far.
+BoardOptions getPlayerBoardOptions(uint8_t player)
+{
+	(void)player;
+
+	BoardOptions options = getBoardOptions();
+	options.hasBoardOptions = false;
+	options.pinDpadUp       = PIN_P2_DPAD_UP;
+	options.pinDpadDown     = PIN_P2_DPAD_DOWN;
+	options.pinDpadLeft     = PIN_P2_DPAD_LEFT;
+	options.pinDpadRight    = PIN_P2_DPAD_RIGHT;
+	options.pinButtonB1     = PIN_P2_BUTTON_B1;
+	options.pinButtonB2     = PIN_P2_BUTTON_B2;
+	options.pinButtonB3     = PIN_P2_BUTTON_B3;
+	options.pinButtonB4     = PIN_P2_BUTTON_B4;
+	options.pinButtonL1     = PIN_P2_BUTTON_L1;
+	options.pinButtonR1     = PIN_P2_BUTTON_R1;
+	options.pinButtonL2     = PIN_P2_BUTTON_L2;
+	options.pinButtonR2     = PIN_P2_BUTTON_R2;
+	options.pinButtonS1     = PIN_P2_BUTTON_S1;
+	options.pinButtonS2     = PIN_P2_BUTTON_S2;
+	options.pinButtonL3     = PIN_P2_BUTTON_L3;
+	options.pinButtonR3     = PIN_P2_BUTTON_R3;
+	options.pinButtonA1     = PIN_P2_BUTTON_A1;
+	options.pinButtonA2     = PIN_P2_BUTTON_A2;
+	return options;
+}
+
+// Each player starts out with the first player's options until its own are saved
+GamepadOptions getPlayerOptions(uint8_t player)
+{
+	GamepadOptions options;
+	EEPROM.get(PLAYER_STORAGE_INDEX + (player - 1) * sizeof(GamepadOptions), options);
+
+	uint32_t lastCRC = options.checksum;
+	options.checksum = 0;
+	if (CRC32::calculate(&options) != lastCRC)
+		options = GamepadStore.getGamepadOptions();
+
+	return options;
+}
+
+void setPlayerOptions(uint8_t player, GamepadOptions options)
+{
+	options.checksum = 0;
+	options.checksum = CRC32::calculate(&options);
+	EEPROM.set(PLAYER_STORAGE_INDEX + (player - 1) * sizeof(GamepadOptions), options);
+}
+
+/* Keyboard stuffs */
+
+#ifndef KEY_DPAD_UP
+#define KEY_DPAD_UP     0x52 // Up Arrow
+#endif
+#ifndef KEY_DPAD_DOWN
+#define KEY_DPAD_DOWN   0x51 // Down Arrow
+#endif
+#ifndef KEY_DPAD_LEFT
+#define KEY_DPAD_LEFT   0x50 // Left Arrow
+#endif
+#ifndef KEY_DPAD_RIGHT
+#define KEY_DPAD_RIGHT  0x4F // Right Arrow
+#endif
+#ifndef KEY_BUTTON_B1
+#define KEY_BUTTON_B1   0x1D // Z
+#endif
+#ifndef KEY_BUTTON_B2
+#define KEY_BUTTON_B2   0x1B // X
+#endif
+#ifndef KEY_BUTTON_B3
+#define KEY_BUTTON_B3   0x04 // A
+#endif
+#ifndef KEY_BUTTON_B4
+#define KEY_BUTTON_B4   0x16 // S
+#endif
+#ifndef KEY_BUTTON_L1
+#define KEY_BUTTON_L1   0x07 // D
+#endif
+#ifndef KEY_BUTTON_R1
+#define KEY_BUTTON_R1   0x09 // F
+#endif
+#ifndef KEY_BUTTON_L2
+#define KEY_BUTTON_L2   0x06 // C
+#endif
+#ifndef KEY_BUTTON_R2
+#define KEY_BUTTON_R2   0x19 // V
+#endif
+#ifndef KEY_BUTTON_S1
+#define KEY_BUTTON_S1   0x2B // Tab
+#endif
+#ifndef KEY_BUTTON_S2
+#define KEY_BUTTON_S2   0x28 // Enter
+#endif
+#ifndef KEY_BUTTON_L3
+#define KEY_BUTTON_L3   0x14 // Q
+#endif
+#ifndef KEY_BUTTON_R3
+#define KEY_BUTTON_R3   0x1A // W
+#endif
+#ifndef KEY_BUTTON_A1
+#define KEY_BUTTON_A1   0x29 // Escape
+#endif
+#ifndef KEY_BUTTON_A2
+#define KEY_BUTTON_A2   0x2C // Space
+#endif
+
+KeyboardMapping getKeyboardMapping()
+{
+	KeyboardMapping mapping;
+	EEPROM.get(KEYBOARD_STORAGE_INDEX, mapping);
+
+	uint32_t lastCRC = mapping.checksum;
+	mapping.checksum = 0;
+	if (CRC32::calculate(&mapping) != lastCRC)
+	{
+		mapping.keyDpadUp    = KEY_DPAD_UP;
+		mapping.keyDpadDown  = KEY_DPAD_DOWN;
+		mapping.keyDpadLeft  = KEY_DPAD_LEFT;
+		mapping.keyDpadRight = KEY_DPAD_RIGHT;
+		mapping.keyButtonB1  = KEY_BUTTON_B1;
+		mapping.keyButtonB2  = KEY_BUTTON_B2;
+		mapping.keyButtonB3  = KEY_BUTTON_B3;
+		mapping.keyButtonB4  = KEY_BUTTON_B4;
+		mapping.keyButtonL1  = KEY_BUTTON_L1;
+		mapping.keyButtonR1  = KEY_BUTTON_R1;
+		mapping.keyButtonL2  = KEY_BUTTON_L2;
+		mapping.keyButtonR2  = KEY_BUTTON_R2;
+		mapping.keyButtonS1  = KEY_BUTTON_S1;
+		mapping.keyButtonS2  = KEY_BUTTON_S2;
+		mapping.keyButtonL3  = KEY_BUTTON_L3;
+		mapping.keyButtonR3  = KEY_BUTTON_R3;
+		mapping.keyButtonA1  = KEY_BUTTON_A1;
+		mapping.keyButtonA2  = KEY_BUTTON_A2;
+	}
+
+	return mapping;
+}
+
+void setKeyboardMapping(KeyboardMapping mapping)
+{
+	mapping.checksum = 0;
+	mapping.checksum = CRC32::calculate(&mapping);
+	EEPROM.set(KEYBOARD_STORAGE_INDEX, mapping);
+}
+
+/* Input source stuffs */
+
+InputSourceOptions getInputSourceOptions()
+{
+	InputSourceOptions options;
+	EEPROM.get(INPUT_SOURCE_STORAGE_INDEX, options);
+
+	uint32_t lastCRC = options.checksum;
+	options.checksum = 0;
+	if (CRC32::calculate(&options) != lastCRC)
+		options.inputSource = GAMEPAD_INPUT_SOURCE;
+
+	return options;
+}
+
+void setInputSourceOptions(InputSourceOptions options)
+{
+	options.checksum = 0;
+	options.checksum = CRC32::calculate(&options);
+	EEPROM.set(INPUT_SOURCE_STORAGE_INDEX, options);
+}
+
 /* Gamepad stuffs */
 
 void GamepadStorage::start()
@@ -0,0 +1,139 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "telemetry.h"
+#include "telemetry_driver.h"
+#include "latency.h"
+#include "pollstats.h"
+#include "scheduler.h"
+
+static_assert(sizeof(TelemetryHeader) + sizeof(TelemetryMetrics) <= TELEMETRY_PACKET_SIZE, "metrics must fit one packet");
+static_assert(sizeof(TelemetryHeader) + sizeof(TelemetryTrace) <= TELEMETRY_PACKET_SIZE, "trace records must fit one packet");
+static_assert(sizeof(TelemetryHeader) + sizeof(TelemetryStats) <= TELEMETRY_PACKET_SIZE, "stats chunks must fit one packet");
+
+Telemetry telemetry;
+
+void Telemetry::setup()
+{
+	enabled = HAS_USB_TELEMETRY;
+	traceSent = inputTrace.dump->written; // Stream from now on, the web configurator serves the rest
+}
+
+void Telemetry::task(uint64_t now)
+{
+	if (!enabled || !telemetry_ready())
+		return;
+
+	if (sendTrace())
+		return;
+
+	if (now >= nextMetrics)
+	{
+		sendMetrics(now);
+		nextMetrics = now + TELEMETRY_METRICS_INTERVAL_US;
+		return;
+	}
+
+	if (now >= nextStats)
+	{
+		latencyOffset = 0;
+		pollOffset = 0;
+		nextStats = now + TELEMETRY_STATS_INTERVAL_US;
+	}
+
+	if (sendStats(TELEMETRY_PACKET_LATENCY, latencyTracer.stats, sizeof(LatencyStats), latencyOffset))
+		return;
+
+	sendStats(TELEMETRY_PACKET_POLL, pollTracker.stats, sizeof(PollStats), pollOffset);
+}
+
+bool Telemetry::send(TelemetryPacketType type, const void *payload, uint8_t length)
+{
+	uint8_t packet[TELEMETRY_PACKET_SIZE];
+	TelemetryHeader header = { (uint8_t)type, length, sequence };
+
+	memcpy(packet, &header, sizeof(header));
+	memcpy(packet + sizeof(header), payload, length);
+	if (!send_telemetry_packet(packet, sizeof(header) + length))
+		return false;
+
+	sequence++;
+	return true;
+}
+
+// Trace records go first, they are the only data that can be lost by waiting
+bool Telemetry::sendTrace()
+{
+	InputTraceDump *dump = inputTrace.dump;
+	uint32_t pending = dump->written - traceSent;
+	if (pending == 0)
+		return false;
+
+	if (pending > INPUT_TRACE_RECORDS)
+	{
+		traceSkipped += pending - INPUT_TRACE_RECORDS;
+		traceSent = dump->written - INPUT_TRACE_RECORDS;
+		pending = INPUT_TRACE_RECORDS;
+	}
+
+	TelemetryTrace trace;
+	uint8_t count = (pending < TELEMETRY_TRACE_RECORDS) ? pending : TELEMETRY_TRACE_RECORDS;
+	trace.first = traceSent;
+	for (uint8_t i = 0; i < count; i++)
+		trace.records[i] = dump->records[(traceSent + i) % INPUT_TRACE_RECORDS];
+
+	if (!send(TELEMETRY_PACKET_TRACE, &trace, sizeof(trace.first) + count * sizeof(InputTraceRecord)))
+		return false;
+
+	traceSent += count;
+	return true;
+}
+
+void Telemetry::sendMetrics(uint64_t now)
+{
+	LatencyStats *stats = latencyTracer.stats;
+	TelemetryMetrics metrics =
+	{
+		.timeMs            = (uint32_t)(now / 1000),
+		.cycles            = scheduler.stats.cycles,
+		.missed            = scheduler.stats.missed,
+		.unlocked          = scheduler.stats.unlocked,
+		.maxRunUs          = scheduler.stats.maxRunUs,
+		.minSlackUs        = scheduler.stats.minSlackUs,
+		.latencyTraces     = stats->traces,
+		.latencyAbandoned  = stats->abandoned,
+		.latencyP50Us      = latencyTracer.percentile(LATENCY_STAGE_COMPLETE, 500),
+		.latencyP99Us      = latencyTracer.percentile(LATENCY_STAGE_COMPLETE, 990),
+		.traceWritten      = inputTrace.dump->written,
+		.traceSkipped      = traceSkipped,
+		.pollIntervalP50Us = pollTracker.percentile(POLL_HISTOGRAM_INTERVAL, 500),
+		.pollJitterP99Us   = pollTracker.percentile(POLL_HISTOGRAM_JITTER, 990),
+		.stalenessP99Us    = pollTracker.percentile(POLL_HISTOGRAM_STALENESS, 990),
+	};
+
+	send(TELEMETRY_PACKET_METRICS, &metrics, sizeof(metrics));
+}
+
+// Returns false once the whole struct has gone out, so the next one can start
+bool Telemetry::sendStats(TelemetryPacketType type, const void *stats, uint16_t size, uint32_t &offset)
+{
+	if (offset >= size)
+		return false;
+
+	TelemetryStats chunk;
+	uint32_t remaining = size - offset;
+	uint8_t length = (remaining < TELEMETRY_STATS_CHUNK) ? remaining : TELEMETRY_STATS_CHUNK;
+
+	chunk.offset = offset;
+	chunk.total = size;
+	memcpy(chunk.bytes, reinterpret_cast<const uint8_t *>(stats) + offset, length);
+
+	if (send(type, &chunk, offsetof(TelemetryStats, bytes) + length))
+		offset += length;
+
+	return true;
+}
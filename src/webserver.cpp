@@ -24,6 +24,10 @@
 #include "gamepad.h"
 #include "storage.h"
 #include "leds.h"
+#include "latency.h"
+#include "pollstats.h"
+#include "inputtrace.h"
+#include "keyboard.h"
 #include "GamepadStorage.h"
 
 #define PATH_CGI_ACTION "/cgi/action"
@@ -37,6 +41,19 @@
 #define API_SET_LED_OPTIONS "/api/setLedOptions"
 #define API_GET_PIN_MAPPINGS "/api/getPinMappings"
 #define API_SET_PIN_MAPPINGS "/api/setPinMappings"
+#define API_GET_KEY_MAPPINGS "/api/getKeyMappings"
+#define API_SET_KEY_MAPPINGS "/api/setKeyMappings"
+#define API_GET_DEBOUNCE_OPTIONS "/api/getDebounceOptions"
+#define API_SET_DEBOUNCE_OPTIONS "/api/setDebounceOptions"
+#define API_GET_LATENCY_STATS "/api/getLatencyStats"
+#define API_GET_LATENCY_DUMP "/api/getLatencyDump"
+#define API_RESET_LATENCY_STATS "/api/resetLatencyStats"
+#define API_GET_POLL_STATS "/api/getPollStats"
+#define API_GET_POLL_DUMP "/api/getPollDump"
+#define API_RESET_POLL_STATS "/api/resetPollStats"
+#define API_GET_INPUT_TRACE "/api/getInputTrace"
+#define API_GET_FLASH_STATS "/api/getFlashStats"
+#define API_RESET_INPUT_TRACE "/api/resetInputTrace"
 
 #define LWIP_HTTPD_POST_MAX_URI_LEN 128
 #define LWIP_HTTPD_POST_MAX_PAYLOAD_LEN 2048
@@ -353,10 +370,233 @@ string setPinMappings()
 	gamepad.mapButtonR3->setPin(options.pinButtonR3);
 	gamepad.mapButtonA1->setPin(options.pinButtonA1);
 	gamepad.mapButtonA2->setPin(options.pinButtonA2);
+	gamepad.mapPins();
 
 	return serialize_json(doc);
 }
 
+string getKeyMappings()
+{
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+
+	KeyboardMapping mapping = getKeyboardMapping();
+	doc["Up"]    = mapping.keyDpadUp;
+	doc["Down"]  = mapping.keyDpadDown;
+	doc["Left"]  = mapping.keyDpadLeft;
+	doc["Right"] = mapping.keyDpadRight;
+	doc["B1"]    = mapping.keyButtonB1;
+	doc["B2"]    = mapping.keyButtonB2;
+	doc["B3"]    = mapping.keyButtonB3;
+	doc["B4"]    = mapping.keyButtonB4;
+	doc["L1"]    = mapping.keyButtonL1;
+	doc["R1"]    = mapping.keyButtonR1;
+	doc["L2"]    = mapping.keyButtonL2;
+	doc["R2"]    = mapping.keyButtonR2;
+	doc["S1"]    = mapping.keyButtonS1;
+	doc["S2"]    = mapping.keyButtonS2;
+	doc["L3"]    = mapping.keyButtonL3;
+	doc["R3"]    = mapping.keyButtonR3;
+	doc["A1"]    = mapping.keyButtonA1;
+	doc["A2"]    = mapping.keyButtonA2;
+
+	return serialize_json(doc);
+}
+
+string setKeyMappings()
+{
+	DynamicJsonDocument doc = get_post_data();
+
+	KeyboardMapping mapping;
+	mapping.keyDpadUp    = doc["Up"];
+	mapping.keyDpadDown  = doc["Down"];
+	mapping.keyDpadLeft  = doc["Left"];
+	mapping.keyDpadRight = doc["Right"];
+	mapping.keyButtonB1  = doc["B1"];
+	mapping.keyButtonB2  = doc["B2"];
+	mapping.keyButtonB3  = doc["B3"];
+	mapping.keyButtonB4  = doc["B4"];
+	mapping.keyButtonL1  = doc["L1"];
+	mapping.keyButtonR1  = doc["R1"];
+	mapping.keyButtonL2  = doc["L2"];
+	mapping.keyButtonR2  = doc["R2"];
+	mapping.keyButtonS1  = doc["S1"];
+	mapping.keyButtonS2  = doc["S2"];
+	mapping.keyButtonL3  = doc["L3"];
+	mapping.keyButtonR3  = doc["R3"];
+	mapping.keyButtonA1  = doc["A1"];
+	mapping.keyButtonA2  = doc["A2"];
+
+	setKeyboardMapping(mapping);
+	GamepadStore.save();
+
+	keyboardMapper.setup(mapping);
+
+	return serialize_json(doc);
+}
+
+// Names of the debounce windows in the JSON, in the order of DebounceOptions::debounceMillis
+static const char *debounceButtonNames[GAMEPAD_DIGITAL_INPUT_COUNT] =
+{
+	"Up", "Down", "Left", "Right",
+	"B1", "B2", "B3", "B4",
+	"L1", "R1", "L2", "R2",
+	"S1", "S2", "L3", "R3",
+	"A1", "A2",
+};
+
+string getDebounceSettings()
+{
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+
+	DebounceOptions &options = gamepad.debounceOptions;
+	doc["debounceMode"] = options.debounceMode;
+
+	auto windows = doc.createNestedObject("debounceMillis");
+	for (int i = 0; i < GAMEPAD_DIGITAL_INPUT_COUNT; i++)
+		windows[debounceButtonNames[i]] = options.debounceMillis[i];
+	doc["maxMillis"] = DEBOUNCE_MAX_MILLIS;
+
+	return serialize_json(doc);
+}
+
+string setDebounceSettings()
+{
+	DynamicJsonDocument doc = get_post_data();
+
+	uint8_t mode = doc["debounceMode"];
+
+	DebounceOptions options;
+	options.debounceMode = (mode == DEBOUNCE_MODE_DEFERRED) ? DEBOUNCE_MODE_DEFERRED : DEBOUNCE_MODE_EAGER;
+
+	// The debouncer caps each window at DEBOUNCE_MAX_MILLIS, save what it will really use
+	for (int i = 0; i < GAMEPAD_DIGITAL_INPUT_COUNT; i++)
+	{
+		uint8_t millis = doc["debounceMillis"][debounceButtonNames[i]];
+		options.debounceMillis[i] = (millis > DEBOUNCE_MAX_MILLIS) ? DEBOUNCE_MAX_MILLIS : millis;
+	}
+
+	setDebounceOptions(options);
+	GamepadStore.save();
+	gamepad.applyDebounceOptions(options);
+
+	return serialize_json(doc);
+}
+
+string getLatencyStats()
+{
+	static const char *stageNames[LATENCY_STAGE_COUNT] = { "read", "debounce", "process", "send", "complete" };
+
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+
+	doc["traces"]    = latencyTracer.stats->traces;
+	doc["abandoned"] = latencyTracer.stats->abandoned;
+
+	auto stages = doc.createNestedObject("stages");
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+	{
+		LatencyStage stage = static_cast<LatencyStage>(i);
+		LatencyStageStats &stageStats = latencyTracer.stats->stages[i];
+
+		auto stageDoc = stages.createNestedObject(stageNames[i]);
+		stageDoc["count"] = stageStats.count;
+		stageDoc["min"]   = stageStats.count ? stageStats.minUs : 0;
+		stageDoc["max"]   = stageStats.maxUs;
+		stageDoc["p50"]   = latencyTracer.percentile(stage, 500);
+		stageDoc["p99"]   = latencyTracer.percentile(stage, 990);
+	}
+
+	return serialize_json(doc);
+}
+
+// The raw LatencyStats struct, including the full histograms
+string getLatencyDump()
+{
+	return string(reinterpret_cast<const char *>(latencyTracer.stats), sizeof(LatencyStats));
+}
+
+string resetLatencyStats()
+{
+	latencyTracer.reset();
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	doc["success"] = true;
+	return serialize_json(doc);
+}
+
+string getPollStats()
+{
+	static const char *histogramNames[POLL_HISTOGRAM_COUNT] = { "interval", "jitter", "staleness" };
+
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+
+	doc["frames"]        = pollTracker.stats->frames;
+	doc["framesSkipped"] = pollTracker.stats->framesSkipped;
+	doc["completions"]   = pollTracker.stats->completions;
+	doc["intervals"]     = pollTracker.stats->intervals;
+
+	auto intervalFrames = doc.createNestedArray("intervalFrames");
+	for (int i = 0; i <= POLL_INTERVAL_FRAMES_MAX; i++)
+		intervalFrames.add(pollTracker.stats->intervalFrames[i]);
+
+	auto histograms = doc.createNestedObject("histograms");
+	for (int i = 0; i < POLL_HISTOGRAM_COUNT; i++)
+	{
+		PollHistogram histogram = static_cast<PollHistogram>(i);
+		LatencyStageStats &histogramStats = pollTracker.stats->histograms[i];
+
+		auto histogramDoc = histograms.createNestedObject(histogramNames[i]);
+		histogramDoc["count"] = histogramStats.count;
+		histogramDoc["min"]   = histogramStats.count ? histogramStats.minUs : 0;
+		histogramDoc["max"]   = histogramStats.maxUs;
+		histogramDoc["p50"]   = pollTracker.percentile(histogram, 500);
+		histogramDoc["p99"]   = pollTracker.percentile(histogram, 990);
+	}
+
+	return serialize_json(doc);
+}
+
+// The raw PollStats struct, including the full histograms
+string getPollDump()
+{
+	return string(reinterpret_cast<const char *>(pollTracker.stats), sizeof(PollStats));
+}
+
+string resetPollStats()
+{
+	pollTracker.reset();
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	doc["success"] = true;
+	return serialize_json(doc);
+}
+
+string getFlashStats()
+{
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	doc["commits"]      = FlashPROM::stats.commits;
+	doc["records"]      = FlashPROM::stats.records;
+	doc["relocations"]  = FlashPROM::stats.relocations;
+	doc["erases"]       = FlashPROM::stats.erases;
+	doc["lastStallUs"]  = FlashPROM::stats.lastStallUs;
+	doc["maxStallUs"]   = FlashPROM::stats.maxStallUs;
+	doc["missedFrames"] = FlashPROM::stats.missedFrames;
+	doc["deferred"]     = FlashPROM::stats.deferred;
+	doc["forced"]       = FlashPROM::stats.forced;
+	return serialize_json(doc);
+}
+
+// The raw InputTraceDump struct, for replay with the simulator
+string getInputTrace()
+{
+	return string(reinterpret_cast<const char *>(inputTrace.dump), sizeof(InputTraceDump));
+}
+
+string resetInputTrace()
+{
+	inputTrace.reset();
+	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	doc["success"] = true;
+	return serialize_json(doc);
+}
+
 /*************************
  * LWIP implementation
  *************************/
@@ -440,6 +680,10 @@ int fs_open_custom(struct fs_file *file, const char *name)
 			return set_file_data(file, setLedOptions());
 		if (!memcmp(http_post_uri, API_SET_PIN_MAPPINGS, sizeof(API_SET_PIN_MAPPINGS)))
 			return set_file_data(file, setPinMappings());
+		if (!memcmp(http_post_uri, API_SET_KEY_MAPPINGS, sizeof(API_SET_KEY_MAPPINGS)))
+			return set_file_data(file, setKeyMappings());
+		if (!memcmp(http_post_uri, API_SET_DEBOUNCE_OPTIONS, sizeof(API_SET_DEBOUNCE_OPTIONS)))
+			return set_file_data(file, setDebounceSettings());
 	}
 	else
 	{
@@ -451,8 +695,30 @@ int fs_open_custom(struct fs_file *file, const char *name)
 			return set_file_data(file, getLedOptions());
 		if (!memcmp(name, API_GET_PIN_MAPPINGS, sizeof(API_GET_PIN_MAPPINGS)))
 			return set_file_data(file, getPinMappings());
+		if (!memcmp(name, API_GET_KEY_MAPPINGS, sizeof(API_GET_KEY_MAPPINGS)))
+			return set_file_data(file, getKeyMappings());
+		if (!memcmp(name, API_GET_DEBOUNCE_OPTIONS, sizeof(API_GET_DEBOUNCE_OPTIONS)))
+			return set_file_data(file, getDebounceSettings());
 		if (!memcmp(name, API_RESET_SETTINGS, sizeof(API_RESET_SETTINGS)))
 			return set_file_data(file, resetSettings());
+		if (!memcmp(name, API_GET_LATENCY_STATS, sizeof(API_GET_LATENCY_STATS)))
+			return set_file_data(file, getLatencyStats());
+		if (!memcmp(name, API_GET_LATENCY_DUMP, sizeof(API_GET_LATENCY_DUMP)))
+			return set_file_data(file, getLatencyDump());
+		if (!memcmp(name, API_RESET_LATENCY_STATS, sizeof(API_RESET_LATENCY_STATS)))
+			return set_file_data(file, resetLatencyStats());
+		if (!memcmp(name, API_GET_POLL_STATS, sizeof(API_GET_POLL_STATS)))
+			return set_file_data(file, getPollStats());
+		if (!memcmp(name, API_GET_POLL_DUMP, sizeof(API_GET_POLL_DUMP)))
+			return set_file_data(file, getPollDump());
+		if (!memcmp(name, API_RESET_POLL_STATS, sizeof(API_RESET_POLL_STATS)))
+			return set_file_data(file, resetPollStats());
+		if (!memcmp(name, API_GET_FLASH_STATS, sizeof(API_GET_FLASH_STATS)))
+			return set_file_data(file, getFlashStats());
+		if (!memcmp(name, API_GET_INPUT_TRACE, sizeof(API_GET_INPUT_TRACE)))
+			return set_file_data(file, getInputTrace());
+		if (!memcmp(name, API_RESET_INPUT_TRACE, sizeof(API_RESET_INPUT_TRACE)))
+			return set_file_data(file, resetInputTrace());
 	}
 
 	bool isExclude = false;
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# Reads the GP2040 telemetry stream, see include/telemetry.h for the packet formats.
+#
+#   python3 tools/telemetry.py              read from a controller built with HAS_USB_TELEMETRY, needs pyusb
+#   python3 tools/telemetry.py events.log   decode the "usb <t> in 83" lines of a simulator event log
+
+import struct
+import sys
+
+TELEMETRY_SUBCLASS = 0x47
+TELEMETRY_PROTOCOL = 0x01
+TELEMETRY_EPNUM_IN = 0x83
+TELEMETRY_PACKET_SIZE = 64
+
+PACKET_METRICS = 1
+PACKET_TRACE = 2
+PACKET_LATENCY = 3
+PACKET_POLL = 4
+
+METRICS_FIELDS = ("timeMs", "cycles", "missed", "unlocked", "maxRunUs", "minSlackUs",
+  "latencyTraces", "latencyAbandoned", "latencyP50Us", "latencyP99Us", "traceWritten", "traceSkipped",
+  "pollIntervalP50Us", "pollJitterP99Us", "stalenessP99Us")
+METRICS_FORMAT = "<5Ii9I"
+
+LATENCY_MAGIC = 0x544C5047
+LATENCY_STAGES = ("read", "debounce", "process", "send", "complete")
+LATENCY_SUB_BITS = 3
+
+POLL_MAGIC = 0x4C505047
+POLL_HISTOGRAMS = ("interval", "jitter", "staleness")
+POLL_INTERVAL_FRAMES_MAX = 8
+
+def bucket_lower_bound(index):
+  sub_count = 1 << LATENCY_SUB_BITS
+  if index < sub_count:
+    return index
+  msb = index // sub_count + LATENCY_SUB_BITS - 1
+  return (sub_count + index % sub_count) << (msb - LATENCY_SUB_BITS)
+
+def percentile(count, min_us, max_us, buckets, permille):
+  if count == 0:
+    return 0
+  target = (count * permille + 999) // 1000
+  seen = 0
+  for i, bucket in enumerate(buckets):
+    seen += bucket
+    if seen >= target:
+      upper = bucket_lower_bound(i + 1) - 1 if i + 1 < len(buckets) else max_us
+      return max(min(upper, max_us), min_us)
+  return max_us
+
+def print_histograms(data, offset, count, bucket_count, names):
+  for index in range(count):
+    samples, min_us, max_us = struct.unpack_from("<III", data, offset)
+    buckets = struct.unpack_from("<%dI" % bucket_count, data, offset + 12)
+    offset += 12 + 4 * bucket_count
+    name = names[index] if index < len(names) else str(index)
+    print("  %-9s count %u min %u p50 %u p99 %u max %u" % (name, samples, min_us if samples else 0,
+      percentile(samples, min_us, max_us, buckets, 500), percentile(samples, min_us, max_us, buckets, 990), max_us))
+
+def print_latency(data):
+  magic, version, stage_count, bucket_count, traces, abandoned = struct.unpack_from("<IHBBII", data)
+  if magic != LATENCY_MAGIC:
+    print("latency: bad magic")
+    return
+  print("latency traces %u abandoned %u" % (traces, abandoned))
+  print_histograms(data, 16, stage_count, bucket_count, LATENCY_STAGES)
+
+def print_poll(data):
+  magic, version, histogram_count, bucket_count, frames, skipped, completions, intervals = struct.unpack_from("<IHBB4I", data)
+  if magic != POLL_MAGIC:
+    print("poll: bad magic")
+    return
+  interval_frames = struct.unpack_from("<%dI" % (POLL_INTERVAL_FRAMES_MAX + 1), data, 24)
+  print("poll frames %u skipped %u completions %u intervals %u by frames %s" % (frames, skipped, completions, intervals,
+    " ".join(str(count) for count in interval_frames[1:])))
+  print_histograms(data, 24 + 4 * len(interval_frames), histogram_count, bucket_count, POLL_HISTOGRAMS)
+
+class Decoder:
+  def __init__(self):
+    self.sequence = None
+    self.dropped = 0
+    self.stats = {}
+    self.previous = 0
+
+  def packet(self, data):
+    if len(data) < 4:
+      return
+    packet_type, length, sequence = struct.unpack_from("<BBH", data)
+    payload = bytes(data[4:4 + length])
+
+    if self.sequence is not None and sequence != (self.sequence + 1) & 0xFFFF:
+      self.dropped += (sequence - self.sequence - 1) & 0xFFFF
+      print("dropped %u packets" % self.dropped)
+    self.sequence = sequence
+
+    if packet_type == PACKET_METRICS:
+      values = dict(zip(METRICS_FIELDS, struct.unpack_from(METRICS_FORMAT, payload)))
+      print("metrics " + " ".join("%s %d" % (name, values[name]) for name in METRICS_FIELDS))
+    elif packet_type == PACKET_TRACE:
+      first, = struct.unpack_from("<I", payload)
+      for i in range((len(payload) - 4) // 8):
+        time_us, values = struct.unpack_from("<II", payload, 4 + 8 * i)
+        changed = values ^ self.previous
+        self.previous = values
+        print("trace %u %u %08x%s" % (first + i, time_us, values,
+          "".join(" %s%u" % ("+" if values & (1 << pin) else "-", pin) for pin in range(30) if changed & (1 << pin))))
+    elif packet_type in (PACKET_LATENCY, PACKET_POLL):
+      offset, total = struct.unpack_from("<HH", payload)
+      if offset == 0:
+        self.stats[packet_type] = bytearray()
+      stats = self.stats.get(packet_type)
+      if stats is not None and offset == len(stats):
+        stats += payload[4:]
+        if len(stats) == total:
+          (print_latency if packet_type == PACKET_LATENCY else print_poll)(stats)
+    else:
+      print("unknown packet type %u" % packet_type)
+
+def read_log(file, decoder):
+  with open(file) as log:
+    for line in log:
+      fields = line.split()
+      if len(fields) > 4 and fields[0] == "usb" and fields[2] == "in" and int(fields[3], 16) == TELEMETRY_EPNUM_IN:
+        decoder.packet(bytes(int(byte, 16) for byte in fields[4:]))
+
+def read_device(decoder):
+  import usb.core
+  import usb.util
+
+  for device in usb.core.find(find_all=True):
+    try:
+      config = device.get_active_configuration()
+    except usb.core.USBError:
+      continue
+    for interface in config:
+      if (interface.bInterfaceClass == 0xFF and interface.bInterfaceSubClass == TELEMETRY_SUBCLASS and
+          interface.bInterfaceProtocol == TELEMETRY_PROTOCOL):
+        print("reading %04x:%04x interface %u" % (device.idVendor, device.idProduct, interface.bInterfaceNumber))
+        usb.util.claim_interface(device, interface.bInterfaceNumber)
+        while True:
+          try:
+            decoder.packet(device.read(TELEMETRY_EPNUM_IN, TELEMETRY_PACKET_SIZE, timeout=1000))
+          except usb.core.USBTimeoutError:
+            pass
+
+  print("no controller with a telemetry interface found")
+  return 1
+
+def main():
+  decoder = Decoder()
+  if len(sys.argv) > 1:
+    read_log(sys.argv[1], decoder)
+    return 0
+  try:
+    return read_device(decoder)
+  except KeyboardInterrupt:
+    return 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -110,6 +110,71 @@ app.get('/api/getPinMappings', (req, res) => {
 	return res.send(mappings);
 });
 
+app.get('/api/getDebounceOptions', (req, res) => {
+	console.log('/api/getDebounceOptions');
+	let debounceMillis = {};
+	for (let prop of Object.keys(baseButtonMappings))
+		debounceMillis[prop] = 5;
+
+	return res.send({
+		debounceMode: 1,
+		debounceMillis,
+		maxMillis: 15,
+	});
+});
+
+app.get('/api/getKeyMappings', (req, res) => {
+	console.log('/api/getKeyMappings');
+	return res.send({
+		Up:    0x52, Down:  0x51, Left:  0x50, Right: 0x4F,
+		B1:    0x1D, B2:    0x1B, B3:    0x04, B4:    0x16,
+		L1:    0x07, R1:    0x09, L2:    0x06, R2:    0x19,
+		S1:    0x2B, S2:    0x28, L3:    0x14, R3:    0x1A,
+		A1:    0x29, A2:    0x2C,
+	});
+});
+
+app.get('/api/getLatencyStats', (req, res) => {
+	console.log('/api/getLatencyStats');
+	return res.send({
+		traces: 1532,
+		abandoned: 4,
+		stages: {
+			read:     { count: 1536, min: 3,   max: 41,   p50: 9,   p99: 35 },
+			debounce: { count: 1536, min: 5,   max: 44,   p50: 11,  p99: 39 },
+			process:  { count: 1534, min: 18,  max: 71,   p50: 27,  p99: 63 },
+			send:     { count: 1532, min: 22,  max: 83,   p50: 31,  p99: 71 },
+			complete: { count: 1532, min: 240, max: 1190, p50: 767, p99: 1087 },
+		},
+	});
+});
+
+app.get('/api/resetLatencyStats', (req, res) => {
+	console.log('/api/resetLatencyStats');
+	return res.send({ success: true });
+});
+
+app.get('/api/getPollStats', (req, res) => {
+	console.log('/api/getPollStats');
+	return res.send({
+		frames: 60211,
+		framesSkipped: 3,
+		completions: 1532,
+		intervals: 388,
+		intervalFrames: [0, 361, 27, 0, 0, 0, 0, 0, 0],
+		histograms: {
+			interval:  { count: 388,  min: 996, max: 2011, p50: 1007, p99: 2011 },
+			jitter:    { count: 388,  min: 0,   max: 14,   p50: 4,    p99: 12 },
+			staleness: { count: 1532, min: 242, max: 1271, p50: 263,  p99: 1087 },
+		},
+	});
+});
+
+app.get('/api/resetPollStats', (req, res) => {
+	console.log('/api/resetPollStats');
+	return res.send({ success: true });
+});
+
 app.post('/api/*', (req, res) => {
 	console.log(req.url);
 	return res.send(req.body);
@@ -9,6 +9,8 @@ import ResetSettingsPage from './Pages/ResetSettingsPage';
 import SettingsPage from './Pages/SettingsPage';
 import DisplayConfigPage from './Pages/DisplayConfig';
 import LEDConfigPage from './Pages/LEDConfigPage';
+import DebounceConfigPage from './Pages/DebounceConfig';
+import KeyboardMappingPage from './Pages/KeyboardMapping';
 
 import { loadButtonLabels } from './Services/Storage';
 import './App.scss';
@@ -45,6 +47,12 @@ const App = () => {
 						<Route path="/display-config">
 							<DisplayConfigPage />
 						</Route>
+						<Route path="/debounce-config">
+							<DebounceConfigPage />
+						</Route>
+						<Route path="/keyboard-mapping">
+							<KeyboardMappingPage />
+						</Route>
 					</Switch>
 				</div>
 			</Router>
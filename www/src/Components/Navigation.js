@@ -28,6 +28,8 @@ const Navigation = (props) => {
 						<NavDropdown.Item as={NavLink} exact={true} to="/pin-mapping">Pin Mapping</NavDropdown.Item>
 						<NavDropdown.Item as={NavLink} exact={true} to="/led-config">LED Configuration</NavDropdown.Item>
 						<NavDropdown.Item as={NavLink} exact={true} to="/display-config">Display Configuration</NavDropdown.Item>
+						<NavDropdown.Item as={NavLink} exact={true} to="/debounce-config">Debounce Configuration</NavDropdown.Item>
+						<NavDropdown.Item as={NavLink} exact={true} to="/keyboard-mapping">Keyboard Mapping</NavDropdown.Item>
 					</NavDropdown>
 					<NavDropdown title="Links">
 						<NavDropdown.Item as={NavLink} to="https://gp2040.info/">Documentation</NavDropdown.Item>
@@ -0,0 +1,103 @@
+import React, { useContext, useEffect, useState } from 'react';
+import { Button, Form } from 'react-bootstrap';
+import { AppContext } from '../Contexts/AppContext';
+import Section from '../Components/Section';
+import FormSelect from '../Components/FormSelect';
+import WebApi, { baseDebounceOptions } from '../Services/WebApi';
+import BUTTONS from '../Data/Buttons.json';
+import './PinMappings.scss';
+
+const DEBOUNCE_MODES = [
+	{ label: 'Deferred', value: 0 },
+	{ label: 'Eager', value: 1 },
+];
+
+export default function DebounceConfigPage() {
+	const { buttonLabels } = useContext(AppContext);
+	const [saveMessage, setSaveMessage] = useState('');
+	const [debounceOptions, setDebounceOptions] = useState(baseDebounceOptions);
+
+	useEffect(() => {
+		async function fetchData() {
+			setDebounceOptions(await WebApi.getDebounceOptions());
+		}
+
+		fetchData();
+	}, [setDebounceOptions]);
+
+	const handleModeChange = (e) => {
+		setDebounceOptions({ ...debounceOptions, debounceMode: parseInt(e.target.value) });
+	};
+
+	const handleMillisChange = (e, button) => {
+		const debounceMillis = { ...debounceOptions.debounceMillis };
+		debounceMillis[button] = e.target.value === '' ? '' : parseInt(e.target.value);
+		setDebounceOptions({ ...debounceOptions, debounceMillis });
+	};
+
+	const isInvalid = (millis) => millis === '' || isNaN(millis) || millis < 0 || millis > debounceOptions.maxMillis;
+
+	const handleSubmit = async (e) => {
+		e.preventDefault();
+		e.stopPropagation();
+
+		if (Object.keys(debounceOptions.debounceMillis).filter(b => isInvalid(debounceOptions.debounceMillis[b])).length) {
+			setSaveMessage('Validation errors, see above');
+			return;
+		}
+
+		const success = await WebApi.setDebounceOptions(debounceOptions);
+		setSaveMessage(success ? 'Saved!' : 'Unable to Save');
+	};
+
+	return (
+		<Section title="Debounce Configuration">
+			<Form noValidate onSubmit={handleSubmit}>
+				<p>
+					Eager mode sends a press or release the moment the pin changes, then ignores the pin for its window.
+					Deferred mode only sends a change once the pin has held its new level for the whole window.
+					A window of 0 sends every change straight away.
+				</p>
+				<FormSelect
+					label="Debounce Mode"
+					name="debounceMode"
+					className="form-select-sm"
+					groupClassName="col-sm-3 mb-3"
+					value={debounceOptions.debounceMode}
+					onChange={handleModeChange}
+				>
+					{DEBOUNCE_MODES.map((o, i) => <option key={`debounceMode-option-${i}`} value={o.value}>{o.label}</option>)}
+				</FormSelect>
+				<table className="table table-sm pin-mapping-table">
+					<thead className="table">
+						<tr>
+							<th className="table-header-button-label">{BUTTONS[buttonLabels].label}</th>
+							<th>Window (ms)</th>
+						</tr>
+					</thead>
+					<tbody>
+						{Object.keys(BUTTONS[buttonLabels])?.filter(p => p !== 'label' && p !== 'value').map((button, i) =>
+							<tr key={`button-debounce-${i}`} className={isInvalid(debounceOptions.debounceMillis[button]) ? "table-danger" : ""}>
+								<td>{BUTTONS[buttonLabels][button]}</td>
+								<td>
+									<Form.Control
+										type="number"
+										className="pin-input form-control-sm"
+										value={debounceOptions.debounceMillis[button]}
+										min={0}
+										max={debounceOptions.maxMillis}
+										isInvalid={isInvalid(debounceOptions.debounceMillis[button])}
+										onChange={(e) => handleMillisChange(e, button)}
+									></Form.Control>
+									<Form.Control.Feedback type="invalid">{`0 to ${debounceOptions.maxMillis}ms`}</Form.Control.Feedback>
+								</td>
+							</tr>
+						)}
+					</tbody>
+				</table>
+				<Button type="submit">Save</Button>
+				{saveMessage ? <span className="alert">{saveMessage}</span> : null}
+			</Form>
+		</Section>
+	);
+}
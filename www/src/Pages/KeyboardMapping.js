@@ -0,0 +1,68 @@
+import React, { useContext, useEffect, useState } from 'react';
+import { Button, Form } from 'react-bootstrap';
+import { AppContext } from '../Contexts/AppContext';
+import Section from '../Components/Section';
+import WebApi, { baseKeyMappings } from '../Services/WebApi';
+import BUTTONS from '../Data/Buttons.json';
+import KEYBOARD_KEYS from '../Data/KeyboardKeys.json';
+import './PinMappings.scss';
+
+export default function KeyboardMappingPage() {
+	const { buttonLabels } = useContext(AppContext);
+	const [saveMessage, setSaveMessage] = useState('');
+	const [keyMappings, setKeyMappings] = useState(baseKeyMappings);
+
+	useEffect(() => {
+		async function fetchData() {
+			setKeyMappings(await WebApi.getKeyMappings());
+		}
+
+		fetchData();
+	}, [setKeyMappings]);
+
+	const handleKeyChange = (e, button) => {
+		setKeyMappings({ ...keyMappings, [button]: parseInt(e.target.value) });
+	};
+
+	const handleSubmit = async (e) => {
+		e.preventDefault();
+		e.stopPropagation();
+
+		const success = await WebApi.setKeyMappings(keyMappings);
+		setSaveMessage(success ? 'Saved!' : 'Unable to Save');
+	};
+
+	return (
+		<Section title="Keyboard Mapping">
+			<Form noValidate onSubmit={handleSubmit}>
+				<p>Select the key each button sends while the controller is in Keyboard mode.</p>
+				<table className="table table-sm pin-mapping-table">
+					<thead className="table">
+						<tr>
+							<th className="table-header-button-label">{BUTTONS[buttonLabels].label}</th>
+							<th>Key</th>
+						</tr>
+					</thead>
+					<tbody>
+						{Object.keys(BUTTONS[buttonLabels])?.filter(p => p !== 'label' && p !== 'value').map((button, i) =>
+							<tr key={`button-key-${i}`}>
+								<td>{BUTTONS[buttonLabels][button]}</td>
+								<td>
+									<Form.Select
+										className="form-select-sm"
+										value={keyMappings[button]}
+										onChange={(e) => handleKeyChange(e, button)}
+									>
+										{KEYBOARD_KEYS.map((o, j) => <option key={`key-option-${i}-${j}`} value={o.value}>{o.label}</option>)}
+									</Form.Select>
+								</td>
+							</tr>
+						)}
+					</tbody>
+				</table>
+				<Button type="submit">Save</Button>
+				{saveMessage ? <span className="alert">{saveMessage}</span> : null}
+			</Form>
+		</Section>
+	);
+}
@@ -23,6 +23,20 @@ export const baseButtonMappings = {
 	A2:    { pin: -1, error: null },
 };
 
+export const baseDebounceOptions = {
+	debounceMode: 1,
+	debounceMillis: Object.keys(baseButtonMappings).reduce((p, n) => { p[n] = 5; return p }, {}),
+	maxMillis: 15,
+};
+
+export const baseKeyMappings = {
+	Up:    0x52, Down:  0x51, Left:  0x50, Right: 0x4F,
+	B1:    0x1D, B2:    0x1B, B3:    0x04, B4:    0x16,
+	L1:    0x07, R1:    0x09, L2:    0x06, R2:    0x19,
+	S1:    0x2B, S2:    0x28, L3:    0x14, R3:    0x1A,
+	A1:    0x29, A2:    0x2C,
+};
+
 async function resetSettings() {
 	return axios.get(`${baseUrl}/api/resetSettings`)
 		.then((response) => response.data)
@@ -117,6 +131,42 @@ async function setPinMappings(mappings) {
 		});
 }
 
+async function getDebounceOptions() {
+	return axios.get(`${baseUrl}/api/getDebounceOptions`)
+		.then((response) => response.data)
+		.catch(console.error);
+}
+
+async function setDebounceOptions(options) {
+	return axios.post(`${baseUrl}/api/setDebounceOptions`, options)
+		.then((response) => {
+			console.log(response.data);
+			return true;
+		})
+		.catch((err) => {
+			console.error(err);
+			return false;
+		});
+}
+
+async function getKeyMappings() {
+	return axios.get(`${baseUrl}/api/getKeyMappings`)
+		.then((response) => response.data)
+		.catch(console.error);
+}
+
+async function setKeyMappings(mappings) {
+	return axios.post(`${baseUrl}/api/setKeyMappings`, mappings)
+		.then((response) => {
+			console.log(response.data);
+			return true;
+		})
+		.catch((err) => {
+			console.error(err);
+			return false;
+		});
+}
+
 const WebApi = {
 	resetSettings,
 	getDisplayOptions,
@@ -127,6 +177,10 @@ const WebApi = {
 	setLedOptions,
 	getPinMappings,
 	setPinMappings,
+	getDebounceOptions,
+	setDebounceOptions,
+	getKeyMappings,
+	setKeyMappings,
 };
 
 export default WebApi;